@@ -0,0 +1,112 @@
+#include "AssetLoader.h"
+#include "ThreadPool.h"
+#include "Dependencies/stb_image.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <iostream>
+
+const double AssetLoader::FrameUploadBudgetMilliseconds = 2.0;
+
+AssetLoader::AssetLoader()
+    : stopping(false), pendingCount(0), batchCount(0), batchUploadMilliseconds(0.0)
+{
+    // Created first so the pool is destroyed after the loader has waited for its jobs
+    ThreadPool::shared();
+}
+
+AssetLoader::~AssetLoader() {
+    // Jobs that have not started are skipped; running ones finish into the queue
+    stopping = true;
+    for (auto& decode : decodes) {
+        decode.wait();
+    }
+}
+
+AssetLoader& AssetLoader::instance() {
+    static AssetLoader loader;
+    return loader;
+}
+
+void AssetLoader::load(const std::string& name, Decode decode) {
+    if (pendingCount == 0) {
+        batchStart = std::chrono::high_resolution_clock::now();
+        batchCount = 0;
+        batchUploadMilliseconds = 0.0;
+    }
+    ++pendingCount;
+
+    decodes.push_back(ThreadPool::shared().submit([this, name, decode]() {
+        Completed job;
+        job.name = name;
+        if (!stopping) {
+            try {
+                job.upload = decode();
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to load " << name << ": " << e.what() << std::endl;
+            }
+        }
+        completed.push(std::move(job));
+    }));
+}
+
+size_t AssetLoader::processUploads(double budgetMilliseconds) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    size_t processed = 0;
+    Completed job;
+    while ((processed == 0 || millisecondsSince(start) < budgetMilliseconds) && completed.pop(job)) {
+        if (job.upload) {
+            job.upload();
+        }
+        job = Completed();
+        ++processed;
+        --pendingCount;
+    }
+
+    if (processed > 0) {
+        batchCount += processed;
+        batchUploadMilliseconds += millisecondsSince(start);
+        if (pendingCount == 0) {
+            std::cout << "Loaded " << batchCount << " assets in background: " << millisecondsSince(batchStart)
+                << " ms total, " << batchUploadMilliseconds << " ms of GL uploads" << std::endl;
+        }
+    }
+
+    // Forget decodes that have finished
+    decodes.erase(std::remove_if(decodes.begin(), decodes.end(), [](const std::future<void>& decode) {
+        return decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), decodes.end());
+
+    return processed;
+}
+
+bool AssetLoader::decodeImage(const std::string& path, bool flipVertically, ImageData& image) {
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+
+    int width, height, channels;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!data) {
+        image = ImageData();
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+    stbi_image_free(data);
+    return true;
+}
+
+void AssetLoader::uploadPlaceholderTexel(GLenum target, GLsizei layers) {
+    static const unsigned char grey[4] = { 128, 128, 128, 255 };
+    if (target == GL_TEXTURE_2D_ARRAY) {
+        std::vector<unsigned char> texels;
+        for (GLsizei layer = 0; layer < layers; ++layer) {
+            texels.insert(texels.end(), grey, grey + 4);
+        }
+        glTexImage3D(target, 0, GL_RGBA, 1, 1, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        return;
+    }
+    glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+}
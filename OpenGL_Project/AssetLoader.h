@@ -0,0 +1,89 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <glew.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+#include "MpscQueue.h"
+
+// Decoded 8-bit image as stb_image returns it
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+
+    // Levels 1.. of pixels when a mip chain was generated on the CPU (see MipGenerator)
+    std::vector<std::vector<unsigned char>> mipLevels;
+
+    // Cooked textures carry their block-compressed mip chain (level 0 first) instead of pixels
+    GLenum compressedFormat = 0;
+    std::vector<std::vector<unsigned char>> compressedLevels;
+
+    bool isCompressed() const { return compressedFormat != 0; }
+    bool isValid() const { return !pixels.empty() || !compressedLevels.empty(); }
+};
+
+// Background asset loading. File reads, OBJ parsing and image decoding run on the
+// shared ThreadPool; each finished job pushes its GL upload onto a lock-free queue
+// that the render loop drains once per frame within a time budget, so the first frame
+// waits for nothing and no frame stalls for long. Owners show placeholders until
+// their upload has run.
+// Uploads run on the GL thread and write into the objects that queued them, so those
+// owners must outlive the main loop (every scene and loader in Main does).
+class AssetLoader {
+public:
+    // GL-thread half of a job
+    typedef std::function<void()> Upload;
+
+    // Worker half of a job; returns the upload that finishes it (may be empty)
+    typedef std::function<Upload()> Decode;
+
+    // GL time per frame spent on uploads
+    static const double FrameUploadBudgetMilliseconds;
+
+    static AssetLoader& instance();
+
+    // Queues a job; the name is only used for logging. GL thread.
+    void load(const std::string& name, Decode decode);
+
+    // Runs finished uploads until the budget is spent, at least one per call so loading
+    // always progresses. Returns how many ran. GL thread, once per frame.
+    size_t processUploads(double budgetMilliseconds = FrameUploadBudgetMilliseconds);
+
+    // Jobs queued and not uploaded yet
+    size_t getPendingCount() const { return pendingCount; }
+
+    // Blocking decode, safe on any thread (flipping is set per thread)
+    static bool decodeImage(const std::string& path, bool flipVertically, ImageData& image);
+
+    // Fills the bound texture's target (every layer of an array) with one grey texel until
+    // the real image arrives
+    static void uploadPlaceholderTexel(GLenum target, GLsizei layers = 1);
+
+private:
+    struct Completed {
+        std::string name;
+        Upload upload;
+    };
+
+    AssetLoader();
+    ~AssetLoader();
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    MpscQueue<Completed> completed;
+    std::vector<std::future<void>> decodes; // In flight on the pool, GL thread only
+    std::atomic<bool> stopping;
+
+    size_t pendingCount;
+    size_t batchCount; // Jobs finished since the queue was last empty
+    std::chrono::high_resolution_clock::time_point batchStart;
+    double batchUploadMilliseconds;
+};
+
+#endif
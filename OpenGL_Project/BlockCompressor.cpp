@@ -0,0 +1,536 @@
+#include "BlockCompressor.h"
+#include "ThreadPool.h"
+#include "Dependencies/glm/glm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace {
+    // Interpolation weights (of 64) of BC7's 4-bit indices
+    const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Weight of endpoint 0 for each BC1 index in four-colour mode
+    const float Bc1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    // Dominant direction of a point set, by power iteration on its covariance
+    template <typename Vec, typename Mat>
+    Vec principalAxis(const Vec* points, int count, const Vec& mean) {
+        Mat covariance(0.0f);
+        Vec low = points[0], high = points[0];
+        for (int i = 0; i < count; ++i) {
+            const Vec d = points[i] - mean;
+            for (int column = 0; column < Vec::length(); ++column) {
+                covariance[column] += d * d[column];
+            }
+            low = glm::min(low, points[i]);
+            high = glm::max(high, points[i]);
+        }
+
+        Vec axis = high - low;
+        if (glm::dot(axis, axis) < 1e-6f) {
+            return Vec(0.0f);
+        }
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            const Vec next = covariance * axis;
+            const float length = glm::length(next);
+            if (length < 1e-6f) {
+                break;
+            }
+            axis = next / length;
+        }
+        return glm::normalize(axis);
+    }
+
+    // Projects the points on the axis through the mean and returns the extreme points
+    template <typename Vec>
+    void axisExtent(const Vec* points, int count, const Vec& mean, const Vec& axis, Vec& high, Vec& low) {
+        float minT = 0.0f, maxT = 0.0f;
+        for (int i = 0; i < count; ++i) {
+            const float t = glm::dot(points[i] - mean, axis);
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        high = mean + axis * maxT;
+        low = mean + axis * minT;
+    }
+
+    uint16_t packRgb565(const glm::vec3& color) {
+        const int r = std::min(std::max(static_cast<int>(color.r * 31.0f / 255.0f + 0.5f), 0), 31);
+        const int g = std::min(std::max(static_cast<int>(color.g * 63.0f / 255.0f + 0.5f), 0), 63);
+        const int b = std::min(std::max(static_cast<int>(color.b * 31.0f / 255.0f + 0.5f), 0), 31);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    glm::vec3 unpackRgb565(uint16_t packed) {
+        const int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+        return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    float distanceSquared(const glm::vec3& a, const glm::vec3& b) {
+        const glm::vec3 d = a - b;
+        return glm::dot(d, d);
+    }
+
+    struct ColorFit {
+        uint16_t color0, color1;
+        uint32_t indices;
+        float error;
+    };
+
+    // Quantizes the endpoints (colour 0 above colour 1, so four-colour mode) and picks the nearest palette entries
+    ColorFit fitColors(const glm::vec3* colors, const glm::vec3& endpoint0, const glm::vec3& endpoint1) {
+        ColorFit fit;
+        fit.color0 = packRgb565(endpoint0);
+        fit.color1 = packRgb565(endpoint1);
+        if (fit.color0 < fit.color1) {
+            std::swap(fit.color0, fit.color1);
+        }
+        fit.indices = 0;
+        fit.error = 0.0f;
+
+        const glm::vec3 p0 = unpackRgb565(fit.color0), p1 = unpackRgb565(fit.color1);
+        const glm::vec3 palette[4] = { p0, p1, (p0 * 2.0f + p1) / 3.0f, (p0 + p1 * 2.0f) / 3.0f };
+        const int paletteSize = fit.color0 == fit.color1 ? 1 : 4; // Equal endpoints decode in three-colour mode
+
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            float bestError = distanceSquared(colors[i], palette[0]);
+            for (int p = 1; p < paletteSize; ++p) {
+                const float error = distanceSquared(colors[i], palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            fit.indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+            fit.error += bestError;
+        }
+        return fit;
+    }
+
+    struct Bc7Fit {
+        int endpoints[2][4]; // 7-bit values
+        int pbits[2];
+        int indices[16];
+        float error;
+    };
+
+    // Tries the four p-bit combinations for the endpoints and keeps the best palette fit
+    Bc7Fit fitBc7(const glm::vec4* pixels, const glm::vec4& endpoint0, const glm::vec4& endpoint1) {
+        Bc7Fit best;
+        best.error = -1.0f;
+
+        for (int pbitCombination = 0; pbitCombination < 4; ++pbitCombination) {
+            Bc7Fit fit;
+            fit.pbits[0] = pbitCombination & 1;
+            fit.pbits[1] = pbitCombination >> 1;
+
+            glm::vec4 reconstructed[2];
+            const glm::vec4* endpoints[2] = { &endpoint0, &endpoint1 };
+            for (int e = 0; e < 2; ++e) {
+                for (int c = 0; c < 4; ++c) {
+                    const int value = static_cast<int>(std::floor(((*endpoints[e])[c] - fit.pbits[e]) * 0.5f + 0.5f));
+                    fit.endpoints[e][c] = std::min(std::max(value, 0), 127);
+                    reconstructed[e][c] = static_cast<float>((fit.endpoints[e][c] << 1) | fit.pbits[e]);
+                }
+            }
+
+            // Index from the projection on the endpoint segment, then the closest weight
+            const glm::vec4 direction = reconstructed[1] - reconstructed[0];
+            const float lengthSquared = glm::dot(direction, direction);
+            fit.error = 0.0f;
+            for (int i = 0; i < 16; ++i) {
+                const float t = lengthSquared > 0.0f ? glm::dot(pixels[i] - reconstructed[0], direction) / lengthSquared : 0.0f;
+                const float weight = t * 64.0f;
+
+                // The weights are almost evenly spaced, so the closest is next to the rounded guess
+                const int guess = std::min(std::max(static_cast<int>(t * 15.0f + 0.5f), 0), 15);
+                int index = guess;
+                for (int w = std::max(guess - 1, 0); w <= std::min(guess + 1, 15); ++w) {
+                    if (std::fabs(Bc7Weights[w] - weight) < std::fabs(Bc7Weights[index] - weight)) {
+                        index = w;
+                    }
+                }
+                fit.indices[i] = index;
+
+                glm::vec4 decoded;
+                for (int c = 0; c < 4; ++c) {
+                    const int e0 = static_cast<int>(reconstructed[0][c]), e1 = static_cast<int>(reconstructed[1][c]);
+                    decoded[c] = static_cast<float>(((64 - Bc7Weights[index]) * e0 + Bc7Weights[index] * e1 + 32) >> 6);
+                }
+                const glm::vec4 d = decoded - pixels[i];
+                fit.error += glm::dot(d, d);
+            }
+
+            if (best.error < 0.0f || fit.error < best.error) {
+                best = fit;
+            }
+        }
+        return best;
+    }
+
+    // LSB-first bit packing of a 128-bit BC7 block
+    struct BitWriter {
+        unsigned char* bytes;
+        int position;
+
+        void write(uint32_t value, int count) {
+            for (int i = 0; i < count; ++i, ++position) {
+                if ((value >> i) & 1) {
+                    bytes[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+                }
+            }
+        }
+    };
+
+    struct BitReader {
+        const unsigned char* bytes;
+        int position;
+
+        uint32_t read(int count) {
+            uint32_t value = 0;
+            for (int i = 0; i < count; ++i, ++position) {
+                value |= static_cast<uint32_t>((bytes[position >> 3] >> (position & 7)) & 1) << i;
+            }
+            return value;
+        }
+    };
+
+    unsigned char toByte(float value) {
+        return static_cast<unsigned char>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+    }
+}
+
+size_t BlockCompressor::getBlockBytes(BlockFormat format) {
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+size_t BlockCompressor::getCompressedSize(BlockFormat format, int width, int height) {
+    const size_t blocksX = (std::max(width, 1) + 3) / 4;
+    const size_t blocksY = (std::max(height, 1) + 3) / 4;
+    return blocksX * blocksY * getBlockBytes(format);
+}
+
+const char* BlockCompressor::getName(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC4: return "BC4";
+    case BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+void BlockCompressor::compress(BlockFormat format, const unsigned char* rgba, int width, int height,
+    std::vector<unsigned char>& blocks, ThreadPool* pool) {
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    const size_t blockBytes = getBlockBytes(format);
+    blocks.assign(static_cast<size_t>(blocksX) * blocksY * blockBytes, 0);
+
+    auto encodeRow = [&](size_t blockY) {
+        unsigned char pixels[64];
+        for (int blockX = 0; blockX < blocksX; ++blockX) {
+            // Gather the 4x4 block, repeating the last row/column past the edge
+            for (int y = 0; y < 4; ++y) {
+                const int sourceY = std::min(static_cast<int>(blockY) * 4 + y, height - 1);
+                for (int x = 0; x < 4; ++x) {
+                    const int sourceX = std::min(blockX * 4 + x, width - 1);
+                    std::memcpy(&pixels[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4);
+                }
+            }
+
+            unsigned char* out = &blocks[(blockY * blocksX + blockX) * blockBytes];
+            switch (format) {
+            case BlockFormat::BC1:
+                encodeBC1(pixels, out);
+                break;
+            case BlockFormat::BC3:
+                encodeBC4(pixels, 3, out);
+                encodeBC1(pixels, out + 8);
+                break;
+            case BlockFormat::BC4:
+                encodeBC4(pixels, 0, out);
+                break;
+            case BlockFormat::BC7:
+                encodeBC7(pixels, out);
+                break;
+            }
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(blocksY, encodeRow);
+    } else {
+        for (int blockY = 0; blockY < blocksY; ++blockY) {
+            encodeRow(blockY);
+        }
+    }
+}
+
+void BlockCompressor::decompress(BlockFormat format, const unsigned char* blocks, int width, int height,
+    std::vector<unsigned char>& rgba) {
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    const size_t blockBytes = getBlockBytes(format);
+    rgba.assign(static_cast<size_t>(width) * height * 4, 0);
+
+    unsigned char pixels[64];
+    for (int blockY = 0; blockY < blocksY; ++blockY) {
+        for (int blockX = 0; blockX < blocksX; ++blockX) {
+            const unsigned char* block = &blocks[(static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes];
+            for (int i = 0; i < 16; ++i) {
+                pixels[i * 4 + 0] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = 0;
+                pixels[i * 4 + 3] = 255;
+            }
+
+            switch (format) {
+            case BlockFormat::BC1:
+                decodeBC1(block, pixels, false);
+                break;
+            case BlockFormat::BC3:
+                decodeBC1(block + 8, pixels, true);
+                decodeBC4(block, 3, pixels);
+                break;
+            case BlockFormat::BC4:
+                decodeBC4(block, 0, pixels);
+                break;
+            case BlockFormat::BC7:
+                decodeBC7(block, pixels);
+                break;
+            }
+
+            for (int y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+                for (int x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+                    const size_t target = (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4;
+                    std::memcpy(&rgba[target], &pixels[(y * 4 + x) * 4], 4);
+                }
+            }
+        }
+    }
+}
+
+void BlockCompressor::encodeBC1(const unsigned char* pixels, unsigned char* out) {
+    glm::vec3 colors[16];
+    glm::vec3 mean(0.0f);
+    for (int i = 0; i < 16; ++i) {
+        colors[i] = glm::vec3(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2]);
+        mean += colors[i];
+    }
+    mean /= 16.0f;
+
+    glm::vec3 endpoint0, endpoint1;
+    const glm::vec3 axis = principalAxis<glm::vec3, glm::mat3>(colors, 16, mean);
+    axisExtent(colors, 16, mean, axis, endpoint0, endpoint1);
+    ColorFit best = fitColors(colors, endpoint0, endpoint1);
+
+    // One least-squares pass: the endpoints that best reproduce the chosen indices
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    glm::vec3 ax(0.0f), bx(0.0f);
+    for (int i = 0; i < 16; ++i) {
+        const float a = Bc1Weights[(best.indices >> (2 * i)) & 3];
+        const float b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        ax += colors[i] * a;
+        bx += colors[i] * b;
+    }
+    const float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) > 1e-6f) {
+        const glm::vec3 refined0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+        const glm::vec3 refined1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+        const ColorFit refined = fitColors(colors, refined0, refined1);
+        if (refined.error < best.error) {
+            best = refined;
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(best.color0 & 0xFF);
+    out[1] = static_cast<unsigned char>(best.color0 >> 8);
+    out[2] = static_cast<unsigned char>(best.color1 & 0xFF);
+    out[3] = static_cast<unsigned char>(best.color1 >> 8);
+    for (int b = 0; b < 4; ++b) {
+        out[4 + b] = static_cast<unsigned char>((best.indices >> (8 * b)) & 0xFF);
+    }
+}
+
+void BlockCompressor::encodeBC4(const unsigned char* pixels, int channel, unsigned char* out) {
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; ++i) {
+        low = std::min(low, static_cast<int>(pixels[i * 4 + channel]));
+        high = std::max(high, static_cast<int>(pixels[i * 4 + channel]));
+    }
+
+    // Eight-value mode: endpoint 0 above endpoint 1
+    out[0] = static_cast<unsigned char>(high);
+    out[1] = static_cast<unsigned char>(low);
+
+    uint64_t indices = 0;
+    if (high > low) {
+        float palette[8];
+        palette[0] = static_cast<float>(high);
+        palette[1] = static_cast<float>(low);
+        for (int p = 2; p < 8; ++p) {
+            palette[p] = ((8 - p) * high + (p - 1) * low) / 7.0f;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            const float value = pixels[i * 4 + channel];
+            int bestIndex = 0;
+            for (int p = 1; p < 8; ++p) {
+                if (std::fabs(palette[p] - value) < std::fabs(palette[bestIndex] - value)) {
+                    bestIndex = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+        }
+    }
+
+    for (int b = 0; b < 6; ++b) {
+        out[2 + b] = static_cast<unsigned char>((indices >> (8 * b)) & 0xFF);
+    }
+}
+
+void BlockCompressor::encodeBC7(const unsigned char* pixels, unsigned char* out) {
+    glm::vec4 colors[16];
+    glm::vec4 mean(0.0f);
+    for (int i = 0; i < 16; ++i) {
+        colors[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3]);
+        mean += colors[i];
+    }
+    mean /= 16.0f;
+
+    glm::vec4 endpoint0, endpoint1;
+    const glm::vec4 axis = principalAxis<glm::vec4, glm::mat4>(colors, 16, mean);
+    axisExtent(colors, 16, mean, axis, endpoint1, endpoint0);
+    Bc7Fit best = fitBc7(colors, endpoint0, endpoint1);
+
+    // One least-squares pass over the chosen weights
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    glm::vec4 ax(0.0f), bx(0.0f);
+    for (int i = 0; i < 16; ++i) {
+        const float b = Bc7Weights[best.indices[i]] / 64.0f;
+        const float a = 1.0f - b;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        ax += colors[i] * a;
+        bx += colors[i] * b;
+    }
+    const float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) > 1e-6f) {
+        const glm::vec4 refined0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+        const glm::vec4 refined1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+        const Bc7Fit refined = fitBc7(colors, refined0, refined1);
+        if (refined.error < best.error) {
+            best = refined;
+        }
+    }
+
+    // The first index is stored with its top bit implied zero; swap the endpoints to make it so
+    if (best.indices[0] >= 8) {
+        for (int c = 0; c < 4; ++c) {
+            std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+        }
+        std::swap(best.pbits[0], best.pbits[1]);
+        for (int i = 0; i < 16; ++i) {
+            best.indices[i] = 15 - best.indices[i];
+        }
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer = { out, 0 };
+    writer.write(1 << 6, 7); // Mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(best.endpoints[0][c], 7);
+        writer.write(best.endpoints[1][c], 7);
+    }
+    writer.write(best.pbits[0], 1);
+    writer.write(best.pbits[1], 1);
+    writer.write(best.indices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        writer.write(best.indices[i], 4);
+    }
+}
+
+void BlockCompressor::decodeBC1(const unsigned char* block, unsigned char* pixels, bool alwaysFourColors) {
+    const uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    const uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    const glm::vec3 p0 = unpackRgb565(color0), p1 = unpackRgb565(color1);
+
+    glm::vec4 palette[4] = { glm::vec4(p0, 255.0f), glm::vec4(p1, 255.0f) };
+    if (alwaysFourColors || color0 > color1) {
+        palette[2] = glm::vec4((p0 * 2.0f + p1) / 3.0f, 255.0f);
+        palette[3] = glm::vec4((p0 + p1 * 2.0f) / 3.0f, 255.0f);
+    } else {
+        palette[2] = glm::vec4((p0 + p1) * 0.5f, 255.0f);
+        palette[3] = glm::vec4(0.0f);
+    }
+
+    const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        const glm::vec4& color = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 4; ++c) {
+            pixels[i * 4 + c] = toByte(color[c]);
+        }
+    }
+}
+
+void BlockCompressor::decodeBC4(const unsigned char* block, int channel, unsigned char* pixels) {
+    const int value0 = block[0], value1 = block[1];
+    float palette[8] = { static_cast<float>(value0), static_cast<float>(value1) };
+    if (value0 > value1) {
+        for (int p = 2; p < 8; ++p) {
+            palette[p] = ((8 - p) * value0 + (p - 1) * value1) / 7.0f;
+        }
+    } else {
+        for (int p = 2; p < 6; ++p) {
+            palette[p] = ((6 - p) * value0 + (p - 1) * value1) / 5.0f;
+        }
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; ++b) {
+        indices |= static_cast<uint64_t>(block[2 + b]) << (8 * b);
+    }
+    for (int i = 0; i < 16; ++i) {
+        pixels[i * 4 + channel] = toByte(palette[(indices >> (3 * i)) & 7]);
+    }
+    if (channel == 0) {
+        // Single-channel formats read back as red
+        for (int i = 0; i < 16; ++i) {
+            pixels[i * 4 + 1] = pixels[i * 4 + 2] = 0;
+        }
+    }
+}
+
+void BlockCompressor::decodeBC7(const unsigned char* block, unsigned char* pixels) {
+    // Only mode 6, the one the encoder writes; other modes decode as black
+    BitReader reader = { block, 0 };
+    if (reader.read(7) != (1 << 6)) {
+        return;
+    }
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = reader.read(7);
+        endpoints[1][c] = reader.read(7);
+    }
+    const int pbit0 = reader.read(1), pbit1 = reader.read(1);
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = (endpoints[0][c] << 1) | pbit0;
+        endpoints[1][c] = (endpoints[1][c] << 1) | pbit1;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        const int index = reader.read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c) {
+            pixels[i * 4 + c] = static_cast<unsigned char>(((64 - Bc7Weights[index]) * endpoints[0][c] + Bc7Weights[index] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// GPU block-compression formats produced by the texture cooker
+enum class BlockFormat {
+    BC1, // Opaque RGB, 4 bpp
+    BC3, // RGBA with separately coded alpha, 8 bpp
+    BC4, // Single channel, 4 bpp (heightmaps)
+    BC7  // RGBA at higher quality than BC1/BC3, 8 bpp (mode 6 only)
+};
+
+// CPU encoders (and matching decoders, for error measurement) for 4x4-block formats.
+// Endpoints come from the principal axis of each block's colours, refined once by a
+// least-squares fit to the chosen indices. Images are tightly packed RGBA8; edge
+// blocks of sizes that are not a multiple of four repeat the last row/column.
+class BlockCompressor {
+public:
+    static size_t getBlockBytes(BlockFormat format);
+    static size_t getCompressedSize(BlockFormat format, int width, int height);
+    static const char* getName(BlockFormat format);
+
+    // Blocks are written row by row; rows of blocks are spread over the pool when one is given
+    static void compress(BlockFormat format, const unsigned char* rgba, int width, int height,
+        std::vector<unsigned char>& blocks, ThreadPool* pool = nullptr);
+
+    static void decompress(BlockFormat format, const unsigned char* blocks, int width, int height,
+        std::vector<unsigned char>& rgba);
+
+private:
+    static void encodeBC1(const unsigned char* pixels, unsigned char* out);
+    static void encodeBC4(const unsigned char* pixels, int channel, unsigned char* out);
+    static void encodeBC7(const unsigned char* pixels, unsigned char* out);
+
+    static void decodeBC1(const unsigned char* block, unsigned char* pixels, bool alwaysFourColors);
+    static void decodeBC4(const unsigned char* block, int channel, unsigned char* pixels);
+    static void decodeBC7(const unsigned char* block, unsigned char* pixels);
+};
+
+#endif
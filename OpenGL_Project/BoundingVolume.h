@@ -0,0 +1,49 @@
+#ifndef BOUNDINGVOLUME_H
+#define BOUNDINGVOLUME_H
+
+#include <algorithm>
+#include <cmath>
+#include "Dependencies/glm/glm.hpp"
+
+// Axis-aligned bounding box
+struct Aabb {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+    // Box around the transformed box (Arvo): exact for the center, conservative for rotations
+    Aabb transformed(const glm::mat4& matrix) const {
+        const glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+        const glm::vec3 extents = getExtents();
+        glm::vec3 worldExtents;
+        for (int axis = 0; axis < 3; ++axis) {
+            worldExtents[axis] = std::fabs(matrix[0][axis]) * extents.x + std::fabs(matrix[1][axis]) * extents.y +
+                std::fabs(matrix[2][axis]) * extents.z;
+        }
+
+        Aabb result;
+        result.min = center - worldExtents;
+        result.max = center + worldExtents;
+        return result;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Sphere around the transformed sphere, scaled by the largest axis scale
+    BoundingSphere transformed(const glm::mat4& matrix) const {
+        const float scaleSquared = std::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+            std::max(glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+
+        BoundingSphere result;
+        result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        result.radius = radius * std::sqrt(scaleSquared);
+        return result;
+    }
+};
+
+#endif
@@ -1,78 +1,205 @@
 #include "DeferredScene.h"
 #include "ShaderLoader.h"
+#include "ProgramCompiler.h"
+#include <cmath>
 #include <iostream>
 #include "Dependencies/glm/gtc/type_ptr.hpp"
 
+namespace {
+    // Edge length of the light gizmo cubes
+    const float GizmoSize = 0.2f;
+
+    // Stencil: the top bit marks geometry, the others count light volume faces
+    const GLuint GeometryStencilBit = 0x80;
+    const GLuint VolumeStencilBits = 0x7F;
+
+    // Light volume sphere, a UV sphere scaled out so its flat faces still enclose the light's range
+    const unsigned SphereSegments = 16;
+    const unsigned SphereRings = 8;
+    const float Pi = 3.14159265f;
+    const float SphereScale = 1.0f / (std::cos(Pi / SphereSegments) * std::cos(Pi / (2 * SphereRings)));
+}
+
 DeferredScene::DeferredScene(unsigned int screenWidth, unsigned int screenHeight)
-    : screenWidth(screenWidth), screenHeight(screenHeight)
+    : screenWidth(screenWidth), screenHeight(screenHeight), gBufferLayout(GBufferLayout::Thin), lightingMode(LightingMode::Clustered)
 {
 }
 
-void DeferredScene::init(ShaderLoader& shaderLoader)
+void DeferredScene::init(ShaderLoader& shaderLoader, const LightManager& lightManager)
 {
-    initGBuffer();
     initScreenQuad();
     initLightVAO();
+    initSphereVAO();
+    initLightFramebuffer();
 
     // Initialize and load the plane
     plane.loadPlane();
 
-    // Use ShaderLoader to create shader programs
-    shaderGeometryPass = shaderLoader.CreateProgram("geometry_pass_vertex.txt", "geometry_pass_fragment.txt");
-    shaderLightingPass = shaderLoader.CreateProgram("lighting_pass_vertex.txt", "lighting_pass_fragment.txt");
-    shaderLightBox = shaderLoader.CreateProgram("lighting_box_vertex.txt", "lighting_box_fragment.txt");
+    // Clustered lighting reads the light lists from storage buffers
+    const ShaderDefines lightDefines = lightManager.getLightBufferDefines();
+    const bool clustered = lightDefines.empty();
+    if (clustered) {
+        clusters.init(shaderLoader);
+    }
+
+    // A G-buffer and the programs writing and reading it for each layout
+    for (GBufferLayout layout : { GBufferLayout::Wide, GBufferLayout::Thin }) {
+        LayoutPasses& passes = layouts[static_cast<int>(layout)];
+        const ShaderDefines layoutDefines = layout == GBufferLayout::Thin ? ShaderDefines{ "THIN_GBUFFER" } : ShaderDefines();
+        passes.gBuffer = initGBuffer(layout);
+
+        passes.geometryProgram = shaderLoader.GetVariant("geometry_pass_vertex.txt", "geometry_pass_fragment.txt", layoutDefines);
+        ProgramUniforms& geometryUniforms = ProgramUniforms::get(passes.geometryProgram);
+        passes.objectAlbedo = geometryUniforms.find("objectAlbedo");
+        passes.objectSpecular = geometryUniforms.find("objectSpecular");
+
+        ShaderDefines lightingDefines = layoutDefines;
+        lightingDefines.insert(lightingDefines.end(), lightDefines.begin(), lightDefines.end());
+        passes.lighting = initLightingProgram(shaderLoader.GetVariant("lighting_pass_vertex.txt", "lighting_pass_fragment.txt", lightingDefines));
 
-    // Check for shader compilation/linking errors
-    if (shaderGeometryPass == 0 || shaderLightingPass == 0 || shaderLightBox == 0)
+        ShaderDefines clusteredDefines = layoutDefines;
+        clusteredDefines.push_back("CLUSTERED");
+        passes.clusteredLighting = initLightingProgram(clustered ? shaderLoader.GetVariant("lighting_pass_vertex.txt", "lighting_pass_fragment.txt", clusteredDefines) : 0);
+
+        ShaderDefines volumeBaseDefines = lightingDefines;
+        volumeBaseDefines.push_back("NO_POINT_LIGHTS");
+        passes.volumeBase = initLightingProgram(shaderLoader.GetVariant("lighting_pass_vertex.txt", "lighting_pass_fragment.txt", volumeBaseDefines));
+
+        ShaderDefines volumeLightDefines = lightingDefines;
+        volumeLightDefines.push_back("LIGHT_VOLUME");
+        passes.volumeLight = initLightingProgram(shaderLoader.GetVariant("light_volume_vertex.txt", "lighting_pass_fragment.txt", volumeLightDefines));
+    }
+
+    // The gizmos read the light buffer from the vertex shader, which GL 4.3 need not allow
+    // for storage buffers
+    GLint vertexStorageBlocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexStorageBlocks);
+    if (clustered && vertexStorageBlocks == 0)
+    {
+        shaderLightBox = 0;
+        std::cout << "DeferredScene: no vertex shader storage buffers, light gizmos are off" << std::endl;
+    }
+    else
+    {
+        shaderLightBox = shaderLoader.GetVariant("lighting_box_vertex.txt", "lighting_box_fragment.txt", lightDefines);
+        lightBoxSize = ProgramUniforms::get(shaderLightBox).find("gizmoSize");
+    }
+
+    volumeStencilProgram = shaderLoader.CreateProgram("light_volume_vertex.txt", "light_volume_fragment.txt");
+
+    // Everything is submitted, so the driver built the programs side by side; a failed
+    // one is unusable although it has a name
+    ProgramCompiler& compiler = ProgramCompiler::instance();
+    bool failed = compiler.hasFailed(volumeStencilProgram);
+    for (const LayoutPasses& passes : layouts)
+    {
+        failed = compiler.hasFailed(passes.geometryProgram) || failed;
+        failed = compiler.hasFailed(passes.lighting.program) || failed;
+        failed = compiler.hasFailed(passes.volumeBase.program) || failed;
+        failed = compiler.hasFailed(passes.volumeLight.program) || failed;
+        failed = (clustered && compiler.hasFailed(passes.clusteredLighting.program)) || failed;
+    }
+    if (shaderLightBox != 0 && compiler.hasFailed(shaderLightBox))
+    {
+        shaderLightBox = 0;
+        failed = true;
+    }
+    if (failed)
     {
         std::cerr << "Error initializing one or more shaders in Deferred Rendering." << std::endl;
     }
 }
 
+DeferredScene::LightingProgram DeferredScene::initLightingProgram(unsigned int program)
+{
+    // Uniform handles; the locations resolve on first use
+    LightingProgram lighting = {};
+    lighting.program = program;
+    if (program != 0)
+    {
+        ProgramUniforms& uniforms = ProgramUniforms::get(program);
+        lighting.viewPos = uniforms.find("viewPos");
+        lighting.clusterTileScale = uniforms.find("clusterTileScale");
+        lighting.clusterDepthScaleBias = uniforms.find("clusterDepthScaleBias");
+        lighting.inverseProjection = uniforms.find("inverseProjection");
+        lighting.inverseView = uniforms.find("inverseView");
+        lighting.volumeLight = uniforms.find("volumeLight");
+        lighting.screenTexelSize = uniforms.find("screenTexelSize");
+    }
+    return lighting;
+}
 
-void DeferredScene::initGBuffer()
+DeferredScene::GBuffer DeferredScene::initGBuffer(GBufferLayout layout)
 {
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+    GBuffer gBuffer = {};
+    glGenFramebuffers(1, &gBuffer.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.framebuffer);
+
+    // One colour target; nearest sampling, since the lighting pass reads texel centres
+    auto addTarget = [this](unsigned int& texture, GLenum internalFormat, GLenum format, GLenum type, GLenum attachment) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, screenWidth, screenHeight, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    };
 
-    // Position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
+    if (layout == GBufferLayout::Wide)
+    {
+        // Position, normal, and color + specular color buffers
+        addTarget(gBuffer.textures[0], GL_RGB16F, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT0);
+        addTarget(gBuffer.textures[1], GL_RGB16F, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT1);
+        addTarget(gBuffer.textures[2], GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2);
+
+        // Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
+        unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers(3, attachments);
+
+        // Create and attach depth-stencil buffer (renderbuffer)
+        glGenRenderbuffers(1, &gBuffer.depthStencilRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, gBuffer.depthStencilRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screenWidth, screenHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, gBuffer.depthStencilRenderbuffer);
+    }
+    else
+    {
+        // Sampled depth (and stencil), octahedral normal in [0, 1], and color + specular color buffers
+        addTarget(gBuffer.textures[0], GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT);
+        addTarget(gBuffer.textures[1], GL_RG16, GL_RG, GL_UNSIGNED_SHORT, GL_COLOR_ATTACHMENT0);
+        addTarget(gBuffer.textures[2], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1);
 
-    // Normal color buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, screenWidth, screenHeight, 0, GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+        unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+    }
 
-    // Color + Specular color buffer
-    glGenTextures(1, &gAlbedoSpec);
-    glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, screenWidth, screenHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    // Check if framebuffer is complete
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "DeferredScene::initGBuffer - Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return gBuffer;
+}
+
+void DeferredScene::initLightFramebuffer()
+{
+    glGenFramebuffers(1, &lightFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFramebuffer);
+
+    glGenTextures(1, &lightTexture);
+    glBindTexture(GL_TEXTURE_2D, lightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, screenWidth, screenHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-
-    // Tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightTexture, 0);
 
-    // Create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, screenWidth, screenHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    // Same format as the G-buffers' depth-stencil, so it can be blitted
+    glGenRenderbuffers(1, &lightDepthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, lightDepthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screenWidth, screenHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, lightDepthStencil);
 
-    // Check if framebuffer is complete
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "DeferredScene::initGBuffer - Framebuffer not complete!" << std::endl;
+        std::cerr << "DeferredScene::initLightFramebuffer - Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -157,128 +284,376 @@ void DeferredScene::initLightVAO()
     // Position attribute
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+    // Light buffer index, one per instance; refilled every frame
+    glGenBuffers(1, &lightIndexVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, lightIndexVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(1, 1);
     glBindVertexArray(0);
 }
 
-void DeferredScene::geometryPass(const std::vector<ModelLoader*>& models, const glm::mat4& view, const glm::mat4& projection)
+void DeferredScene::initSphereVAO()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Unit sphere, rings from pole to pole
+    std::vector<float> vertices;
+    for (unsigned ring = 0; ring <= SphereRings; ++ring)
+    {
+        const float theta = Pi * ring / SphereRings;
+        for (unsigned segment = 0; segment <= SphereSegments; ++segment)
+        {
+            const float phi = 2.0f * Pi * segment / SphereSegments;
+            vertices.push_back(std::sin(theta) * std::cos(phi));
+            vertices.push_back(std::cos(theta));
+            vertices.push_back(std::sin(theta) * std::sin(phi));
+        }
+    }
 
-    glUseProgram(shaderGeometryPass);
+    // Two counter-clockwise triangles per quad, seen from outside
+    std::vector<unsigned int> indices;
+    for (unsigned ring = 0; ring < SphereRings; ++ring)
+    {
+        for (unsigned segment = 0; segment < SphereSegments; ++segment)
+        {
+            const unsigned int topLeft = ring * (SphereSegments + 1) + segment;
+            const unsigned int bottomLeft = topLeft + SphereSegments + 1;
+            indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft + 1 });
+            indices.insert(indices.end(), { topLeft, bottomLeft + 1, bottomLeft });
+        }
+    }
+    sphereIndexCount = static_cast<unsigned int>(indices.size());
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // Position attribute
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+}
 
-    // Render all 3D models
+void DeferredScene::geometryPass(const std::vector<ModelLoader*>& models, const glm::mat4& view, const glm::mat4& projection)
+{
+    const LayoutPasses& passes = getPasses();
+    geometryTimer.begin();
+    glBindFramebuffer(GL_FRAMEBUFFER, passes.gBuffer.framebuffer);
+    glStencilMask(0xFF);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // Mark the pixels with geometry, so the light volumes skip the background
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, GeometryStencilBit, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    glUseProgram(passes.geometryProgram);
+    ProgramUniforms& uniforms = ProgramUniforms::get(passes.geometryProgram);
+    uniforms.set(ProgramUniforms::View, view);
+    uniforms.set(ProgramUniforms::Projection, projection);
+
+    // Cull the models against the camera frustum
+    culler.clear();
     for (const auto& model : models)
     {
-        glm::mat4 modelMatrix = model->getModelMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shaderGeometryPass, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shaderGeometryPass, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderGeometryPass, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        culler.add(model->getWorldAabb());
+    }
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    culler.cull(&frustum, 1, modelVisibility);
+    geometryCullStats = FrustumCuller::countVisible(modelVisibility, 0);
+    FrustumCuller::logIfChanged("Deferred geometry pass", geometryCullStats, loggedGeometryCullStats);
+
+    // Render the visible 3D models
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        if (!modelVisibility[i])
+        {
+            continue;
+        }
+        ModelLoader* model = models[i];
 
         // Set material properties (example: you might want to set these per model)
-        glUniform3f(glGetUniformLocation(shaderGeometryPass, "objectAlbedo"), 0.5f, 0.0f, 0.0f); // Example color
-        glUniform1f(glGetUniformLocation(shaderGeometryPass, "objectSpecular"), 1.0f); // Example specular
+        uniforms.set(passes.objectAlbedo, glm::vec3(0.5f, 0.0f, 0.0f)); // Example color
+        uniforms.set(passes.objectSpecular, 1.0f); // Example specular
 
-        model->render(shaderGeometryPass, view, projection);
+        // Sets the model, view and projection matrices
+        model->render(passes.geometryProgram, view, projection);
     }
 
     // Render the plane
-    glm::mat4 planeModel = plane.getModelMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(shaderGeometryPass, "model"), 1, GL_FALSE, glm::value_ptr(planeModel));
-    glUniform3f(glGetUniformLocation(shaderGeometryPass, "objectAlbedo"), 0.3f, 0.3f, 0.3f); // Gray color
-    glUniform1f(glGetUniformLocation(shaderGeometryPass, "objectSpecular"), 0.5f); // Specular
+    uniforms.set(ProgramUniforms::Model, plane.getModelMatrix());
+    uniforms.set(passes.objectAlbedo, glm::vec3(0.3f, 0.3f, 0.3f)); // Gray color
+    uniforms.set(passes.objectSpecular, 0.5f); // Specular
 
-    plane.render(shaderGeometryPass, view, projection);
+    plane.render(passes.geometryProgram, view, projection);
 
+    glDisable(GL_STENCIL_TEST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    geometryTimer.end();
 }
 
-void DeferredScene::lightingPass(const std::vector<LightManager::Light>& pointLights,
-    const LightManager::DirectionalLight& dirLight,
-    const LightManager::SpotLight& spotLight,
-    const glm::vec3& viewPos)
+void DeferredScene::lightingPass(LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(shaderLightingPass);
+    // Uploads only the lights that changed
+    lightManager.bindLightBuffer();
 
-    // Pass point lights
-    glUniform1i(glGetUniformLocation(shaderLightingPass, "numLights"), pointLights.size());
-    for (unsigned int i = 0; i < pointLights.size(); ++i)
-    {
-        std::string posName = "pointLights[" + std::to_string(i) + "].Position";
-        std::string colorName = "pointLights[" + std::to_string(i) + "].Color";
-        std::string linearName = "pointLights[" + std::to_string(i) + "].Linear";
-        std::string quadraticName = "pointLights[" + std::to_string(i) + "].Quadratic";
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, posName.c_str()), 1, glm::value_ptr(pointLights[i].position));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, colorName.c_str()), 1, glm::value_ptr(pointLights[i].color));
-        glUniform1f(glGetUniformLocation(shaderLightingPass, linearName.c_str()), pointLights[i].linear);
-        glUniform1f(glGetUniformLocation(shaderLightingPass, quadraticName.c_str()), pointLights[i].quadratic);
+    const LayoutPasses& passes = getPasses();
+    const LightingMode mode = getLightingMode();
+    if (mode == LightingMode::Clustered) {
+        // List the lights of every cluster, then shade each pixel with its cluster's
+        lightAssignmentTimer.begin();
+        clusters.assignLights(view, projection);
+        lightAssignmentTimer.end();
     }
 
-    // Pass directional light
-    if (dirLight.color != glm::vec3(0.0f)) {
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "dirLight.direction"), 1, glm::value_ptr(dirLight.direction));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "dirLight.color"), 1, glm::value_ptr(dirLight.color));
-    }
-    else {
-        glm::vec3 zero = glm::vec3(0.0f);
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "dirLight.direction"), 1, glm::value_ptr(zero));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "dirLight.color"), 1, glm::value_ptr(zero));
-    }
+    lightingTimer.begin();
 
-    // Pass spotlight
-    if (spotLight.color != glm::vec3(0.0f)) {
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.position"), 1, glm::value_ptr(spotLight.position));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.direction"), 1, glm::value_ptr(spotLight.direction));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.color"), 1, glm::value_ptr(spotLight.color));
-        glUniform1f(glGetUniformLocation(shaderLightingPass, "spotLight.cutOff"), spotLight.cutOff);
-        glUniform1f(glGetUniformLocation(shaderLightingPass, "spotLight.outerCutOff"), spotLight.outerCutOff);
-    }
-    else {
-        glm::vec3 zero = glm::vec3(0.0f);
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.position"), 1, glm::value_ptr(zero));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.direction"), 1, glm::value_ptr(zero));
-        glUniform3fv(glGetUniformLocation(shaderLightingPass, "spotLight.color"), 1, glm::value_ptr(zero));
-        glUniform1f(glGetUniformLocation(shaderLightingPass, "spotLight.cutOff"), 0.0f);
-        glUniform1f(glGetUniformLocation(shaderLightingPass, "spotLight.outerCutOff"), 0.0f);
+    // Bind G-buffer textures
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, passes.gBuffer.textures[i]);
     }
 
-    glUniform3fv(glGetUniformLocation(shaderLightingPass, "viewPos"), 1, glm::value_ptr(viewPos));
-
-    // Bind G-buffer textures
+    if (mode == LightingMode::LightVolumes) {
+        lightVolumePass(lightManager, view, projection, viewPos);
+    } else {
+        const LightingProgram& lighting = mode == LightingMode::Clustered ? passes.clusteredLighting : passes.lighting;
+        ProgramUniforms& uniforms = useLightingProgram(lighting, view, projection, viewPos);
+        if (mode == LightingMode::Clustered) {
+            uniforms.set(lighting.clusterTileScale, clusters.getTileScale(screenWidth, screenHeight));
+            uniforms.set(lighting.clusterDepthScaleBias, clusters.getDepthScaleBias());
+        }
+
+        // Render screen quad
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+    }
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
+    lightingTimer.end();
+}
+
+ProgramUniforms& DeferredScene::useLightingProgram(const LightingProgram& lighting, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+{
+    glUseProgram(lighting.program);
+    ProgramUniforms& uniforms = ProgramUniforms::get(lighting.program);
+    uniforms.set(lighting.viewPos, viewPos);
+    uniforms.set(ProgramUniforms::View, view);
+    uniforms.set(lighting.inverseProjection, glm::inverse(projection));
+    uniforms.set(lighting.inverseView, glm::inverse(view));
+    return uniforms;
+}
 
-    // Render screen quad
+void DeferredScene::lightVolumePass(const LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+{
+    const LayoutPasses& passes = getPasses();
+
+    // Copy the G-buffer's depth and geometry bit, so the thin layout's depth texture is
+    // never sampled while attached to the target
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, passes.gBuffer.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, lightFramebuffer);
+    glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFramebuffer);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Ambient, directional and spot light on the geometry only
+    glEnable(GL_STENCIL_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glStencilMask(0x00);
+    glStencilFunc(GL_EQUAL, GeometryStencilBit, GeometryStencilBit);
+    useLightingProgram(passes.volumeBase, view, projection, viewPos);
     glBindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    // Cull the light spheres against the camera frustum
+    const std::vector<LightManager::Light>& lights = lightManager.getPointLights();
+    const size_t lightCount = lightManager.getBufferedLightCount();
+    lightRanges.resize(lightCount);
+    lightCuller.clear();
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        lightRanges[i] = LightManager::getLightRange(lights[i]) * SphereScale;
+        Aabb box;
+        box.min = lights[i].position - glm::vec3(lightRanges[i]);
+        box.max = lights[i].position + glm::vec3(lightRanges[i]);
+        lightCuller.add(box);
+    }
+    const glm::mat4 viewProjection = projection * view;
+    const Frustum frustum = Frustum::fromMatrix(viewProjection);
+    lightCuller.cull(&frustum, 1, lightVisibility);
+    lightVolumeCullStats = FrustumCuller::countVisible(lightVisibility, 0);
+    FrustumCuller::logIfChanged("Deferred light volumes", lightVolumeCullStats, loggedLightVolumeCullStats);
+
+    ProgramUniforms& stencilUniforms = ProgramUniforms::get(volumeStencilProgram);
+    glUseProgram(volumeStencilProgram);
+    stencilUniforms.set(ProgramUniforms::ViewProjectionMatrix, viewProjection);
+    ProgramUniforms& lightUniforms = useLightingProgram(passes.volumeLight, view, projection, viewPos);
+    lightUniforms.set(ProgramUniforms::ViewProjectionMatrix, viewProjection);
+    lightUniforms.set(passes.volumeLight.screenTexelSize, glm::vec2(1.0f / screenWidth, 1.0f / screenHeight));
+
+    // Spheres crossing the near or far plane are clamped rather than clipped open
+    glBindVertexArray(sphereVAO);
+    glEnable(GL_DEPTH_CLAMP);
+    glDepthMask(GL_FALSE);
+    glStencilMask(VolumeStencilBits);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        if (!lightVisibility[i] || lightRanges[i] <= 0.0f)
+        {
+            continue;
+        }
+        const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), lights[i].position), glm::vec3(lightRanges[i]));
+
+        // Back faces behind the geometry count up, front faces behind it count down: the
+        // count is non-zero where the geometry lies inside the sphere
+        glUseProgram(volumeStencilProgram);
+        stencilUniforms.set(ProgramUniforms::Model, model);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+        glStencilFunc(GL_ALWAYS, 0, 0);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+
+        // Shade the marked geometry pixels additively and reset their count. Back faces,
+        // so a camera inside the sphere still covers it.
+        glUseProgram(passes.volumeLight.program);
+        lightUniforms.set(ProgramUniforms::Model, model);
+        lightUniforms.set(passes.volumeLight.volumeLight, static_cast<int>(i));
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glStencilFunc(GL_LESS, GeometryStencilBit, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+    }
     glBindVertexArray(0);
+
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glDepthMask(GL_TRUE);
+    glStencilMask(0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, lightFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void DeferredScene::renderLights(const std::vector<LightManager::Light>& lights, const glm::mat4& view, const glm::mat4& projection)
+void DeferredScene::setGBufferLayout(GBufferLayout layout)
 {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glUseProgram(shaderLightBox);
-    for (const auto& light : lights)
+    printPassTimings();
+    gBufferLayout = layout;
+}
+
+bool DeferredScene::isLightingModeAvailable(LightingMode mode) const
+{
+    // Failed builds were resolved in init, so this waits for nothing
+    const LayoutPasses& passes = getPasses();
+    ProgramCompiler& compiler = ProgramCompiler::instance();
+    switch (mode)
     {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, light.position);
-        model = glm::scale(model, glm::vec3(0.2f));
+    case LightingMode::Clustered:
+        return clusters.isAvailable() && !compiler.hasFailed(passes.clusteredLighting.program);
+    case LightingMode::LightVolumes:
+        return !compiler.hasFailed(passes.volumeBase.program) && !compiler.hasFailed(passes.volumeLight.program) &&
+            !compiler.hasFailed(volumeStencilProgram);
+    default:
+        return true;
+    }
+}
 
-        glUniformMatrix4fv(glGetUniformLocation(shaderLightBox, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(shaderLightBox, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderLightBox, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniform3fv(glGetUniformLocation(shaderLightBox, "lightColor"), 1, glm::value_ptr(light.color));
+void DeferredScene::setLightingMode(LightingMode mode)
+{
+    printPassTimings();
+    lightingMode = mode;
+}
 
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
+void DeferredScene::printPassTimings()
+{
+    static const char* lightingModeNames[] = { "per-pixel", "clustered", "light volume" };
+
+    // Bytes a pixel: RGB16F x2 + RGBA8 + depth-stencil, or depth-stencil + RG16 + RGBA8
+    const bool thin = gBufferLayout == GBufferLayout::Thin;
+    const unsigned gBufferBytes = (thin ? 12 : 20) * screenWidth * screenHeight;
+    if (geometryTimer.getSampleCount() > 0) {
+        std::cout << "Deferred passes (" << (thin ? "thin" : "wide") << " G-buffer, " << gBufferBytes / (1024 * 1024) << " MB, "
+            << lightingModeNames[static_cast<int>(getLightingMode())] << " lighting), GPU ms over " << geometryTimer.getSampleCount()
+            << " frames: geometry " << geometryTimer.getAverageMs();
+        if (lightAssignmentTimer.getSampleCount() > 0) {
+            std::cout << ", light assignment " << lightAssignmentTimer.getAverageMs();
+        }
+        std::cout << ", lighting " << lightingTimer.getAverageMs() << std::endl;
     }
-    glDisable(GL_BLEND);
+    geometryTimer.reset();
+    lightAssignmentTimer.reset();
+    lightingTimer.reset();
+}
+
+void DeferredScene::renderLights(const LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection)
+{
+    if (shaderLightBox == 0)
+    {
+        return;
+    }
+
+    // Cull the gizmo cubes against the camera frustum
+    const std::vector<LightManager::Light>& lights = lightManager.getPointLights();
+    const size_t lightCount = lightManager.getBufferedLightCount();
+    gizmoCuller.clear();
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        Aabb box;
+        box.min = lights[i].position - glm::vec3(0.5f * GizmoSize);
+        box.max = lights[i].position + glm::vec3(0.5f * GizmoSize);
+        gizmoCuller.add(box);
+    }
+    const glm::mat4 viewProjection = projection * view;
+    const Frustum frustum = Frustum::fromMatrix(viewProjection);
+    gizmoCuller.cull(&frustum, 1, gizmoVisibility);
+    lightGizmoCullStats = FrustumCuller::countVisible(gizmoVisibility, 0);
+    FrustumCuller::logIfChanged("Deferred light gizmos", lightGizmoCullStats, loggedLightGizmoCullStats);
+
+    visibleGizmos.clear();
+    for (size_t i = 0; i < lightCount; ++i)
+    {
+        if (gizmoVisibility[i])
+        {
+            visibleGizmos.push_back(static_cast<GLuint>(i));
+        }
+    }
+    if (visibleGizmos.empty())
+    {
+        return;
+    }
+
+    // Orphaned every frame, so the upload never waits on last frame's draw
+    glBindBuffer(GL_ARRAY_BUFFER, lightIndexVBO);
+    glBufferData(GL_ARRAY_BUFFER, visibleGizmos.size() * sizeof(GLuint), visibleGizmos.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(shaderLightBox);
+    ProgramUniforms& uniforms = ProgramUniforms::get(shaderLightBox);
+    uniforms.set(ProgramUniforms::ViewProjectionMatrix, viewProjection);
+    uniforms.set(lightBoxSize, GizmoSize);
+
+    glBindVertexArray(lightVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(visibleGizmos.size()));
+    glBindVertexArray(0);
 }
@@ -7,37 +7,139 @@
 #include "LightManager.h"
 #include "ShaderLoader.h"
 #include "Plane.h" 
+#include "FrustumCuller.h"
+#include "LightClusters.h"
+#include "GpuTimer.h"
 
 class DeferredScene
 {
 public:
+    // G-buffer formats, both kept allocated so they can be switched at runtime.
+    // Wide: world position RGB16F, normal RGB16F, albedo/specular RGBA8 and a depth-stencil
+    // renderbuffer. Thin: a sampled depth-stencil texture the lighting pass reconstructs the
+    // position from, the normal octahedral-encoded in RG16 and albedo/specular RGBA8.
+    // The geometry pass sets a stencil bit wherever it draws.
+    enum class GBufferLayout { Wide, Thin };
+
+    // How the point lights are shaded. PerPixel: one full-screen pass looping every light.
+    // Clustered: the full-screen pass loops the lights of the pixel's cluster (LightClusters).
+    // LightVolumes: each light is drawn as a sphere of its range, shading only the pixels
+    // a stencil pre-pass finds inside it.
+    enum class LightingMode { PerPixel, Clustered, LightVolumes };
+
     DeferredScene(unsigned int screenWidth, unsigned int screenHeight);
-    void init(ShaderLoader& shaderLoader);
+    void init(ShaderLoader& shaderLoader, const LightManager& lightManager);
 
     // Update the geometryPass if necessary
     void geometryPass(const std::vector<ModelLoader*>& models, const glm::mat4& view, const glm::mat4& projection);
 
-    // Updated lightingPass with four parameters
-    void lightingPass(const std::vector<LightManager::Light>& pointLights,
-        const LightManager::DirectionalLight& dirLight,
-        const LightManager::SpotLight& spotLight,
-        const glm::vec3& viewPos);
+    // Lights from the light manager's light buffer, as the lighting mode shades them
+    void lightingPass(LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+
+    // A small cube at each point light in the light buffer, frustum-culled on the CPU and
+    // drawn in one instanced call. After lightingPass, which binds the light buffer.
+    void renderLights(const LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection);
+
+    // Prints the GPU pass timings measured with the current layout, then switches
+    void setGBufferLayout(GBufferLayout layout);
+    GBufferLayout getGBufferLayout() const { return gBufferLayout; }
+
+    // Average GPU time of the geometry, light assignment and lighting passes since the
+    // last layout or lighting switch
+    void printPassTimings();
 
-    void renderLights(const std::vector<LightManager::Light>& lights, const glm::mat4& view, const glm::mat4& projection);
+    // Clustered lighting needs a storage light buffer; an unavailable mode falls back to PerPixel
+    bool isLightingModeAvailable(LightingMode mode) const;
+    LightingMode getLightingMode() const { return isLightingModeAvailable(lightingMode) ? lightingMode : LightingMode::PerPixel; }
+    void setLightingMode(LightingMode mode);
+
+    // Compares the last cluster light lists with the CPU reference (LightClusters::validate)
+    size_t validateLightClusters(const LightManager& lightManager) { return clusters.validate(lightManager); }
+
+    // Models tested and left visible by the last geometry pass
+    const CullStats& getGeometryCullStats() const { return geometryCullStats; }
+
+    // Point lights tested and left visible by the last light volume pass
+    const CullStats& getLightVolumeCullStats() const { return lightVolumeCullStats; }
+
+    // Light gizmos tested and left visible by the last renderLights
+    const CullStats& getLightGizmoCullStats() const { return lightGizmoCullStats; }
 
 private:
+    struct GBuffer {
+        unsigned int framebuffer;
+        unsigned int textures[3];       // Bound to units 0-2 for the lighting pass
+        unsigned int depthStencilRenderbuffer; // Wide only; Thin samples textures[0]
+    };
+
+    struct LightingProgram {
+        unsigned int program;
+        ProgramUniforms::Handle viewPos, clusterTileScale, clusterDepthScaleBias, inverseProjection, inverseView;
+        ProgramUniforms::Handle volumeLight, screenTexelSize;
+    };
+
+    // Everything that differs between the G-buffer layouts
+    struct LayoutPasses {
+        GBuffer gBuffer;
+        unsigned int geometryProgram;
+        ProgramUniforms::Handle objectAlbedo, objectSpecular;
+        LightingProgram lighting, clusteredLighting;
+        LightingProgram volumeBase, volumeLight; // Full-screen pass without point lights, one light's volume
+    };
+
     unsigned int screenWidth, screenHeight;
-    unsigned int gBuffer, gPosition, gNormal, gAlbedoSpec;
     unsigned int quadVAO, quadVBO;
     unsigned int lightVAO, lightVBO;
-    unsigned int shaderGeometryPass, shaderLightingPass, shaderLightBox;
+    unsigned int lightIndexVBO; // Per-instance light buffer indices of the visible gizmos
+    unsigned int sphereVAO, sphereVBO, sphereEBO;
+    unsigned int sphereIndexCount;
+    unsigned int shaderLightBox;
+    ProgramUniforms::Handle lightBoxSize;
+
+    // Light gizmos left by the frustum, uploaded as instance indices
+    FrustumCuller gizmoCuller;
+    std::vector<unsigned char> gizmoVisibility;
+    std::vector<GLuint> visibleGizmos;
+    CullStats lightGizmoCullStats, loggedLightGizmoCullStats;
+
+    LayoutPasses layouts[2]; // By GBufferLayout
+    GBufferLayout gBufferLayout;
+
+    // Light lists per cluster for the clustered lighting programs
+    LightClusters clusters;
+    LightingMode lightingMode;
+
+    // Light volumes shade into their own target, with a copy of the G-buffer's depth and
+    // stencil, and the result is blitted to the default framebuffer
+    unsigned int lightFramebuffer, lightTexture, lightDepthStencil;
+    unsigned int volumeStencilProgram;
+    FrustumCuller lightCuller;
+    std::vector<unsigned char> lightVisibility;
+    std::vector<float> lightRanges;
+    CullStats lightVolumeCullStats, loggedLightVolumeCullStats;
+
+    GpuTimer geometryTimer, lightAssignmentTimer, lightingTimer;
 
     // Add Plane
     Plane plane;
 
-    void initGBuffer();
+    // Frustum culling of the geometry pass models
+    FrustumCuller culler;
+    std::vector<unsigned char> modelVisibility;
+    CullStats geometryCullStats, loggedGeometryCullStats;
+
+    const LayoutPasses& getPasses() const { return layouts[static_cast<int>(gBufferLayout)]; }
+
+    static LightingProgram initLightingProgram(unsigned int program);
+    GBuffer initGBuffer(GBufferLayout layout);
+    void initLightFramebuffer();
     void initScreenQuad();
     void initLightVAO();
+    void initSphereVAO();
+
+    // Binds the program and sets the uniforms every lighting program shares
+    ProgramUniforms& useLightingProgram(const LightingProgram& lighting, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+    void lightVolumePass(const LightManager& lightManager, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
 };
 
 #endif
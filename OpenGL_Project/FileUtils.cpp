@@ -0,0 +1,140 @@
+#include "FileUtils.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+bool getFileStat(const std::string& path, uint64_t& modifiedTime, uint64_t& size) {
+#ifdef _WIN32
+    struct _stat64 fileStat;
+    if (_stat64(path.c_str(), &fileStat) != 0) {
+        return false;
+    }
+#else
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0) {
+        return false;
+    }
+#endif
+    modifiedTime = static_cast<uint64_t>(fileStat.st_mtime);
+    size = static_cast<uint64_t>(fileStat.st_size);
+    return true;
+}
+
+bool fileExists(const std::string& path) {
+    uint64_t modifiedTime = 0, size = 0;
+    return getFileStat(path, modifiedTime, size);
+}
+
+void makeDirectory(const std::string& path) {
+    // Create each missing parent in turn
+    for (size_t slash = path.find('/'); ; slash = path.find('/', slash + 1)) {
+        std::string partial = path.substr(0, slash);
+        if (!partial.empty()) {
+#ifdef _WIN32
+            _mkdir(partial.c_str());
+#else
+            mkdir(partial.c_str(), 0755);
+#endif
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+}
+
+bool writeFileAtomically(const std::string& path, const std::string& data) {
+    const std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(data.data(), data.size());
+    file.close();
+
+    if (!file) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    // rename won't replace an existing file on Windows
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+namespace {
+    bool hasExtension(const std::string& name, const std::string& extension) {
+        return name.size() >= extension.size() &&
+            name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+    }
+
+    void collectFiles(const std::string& directory, const std::string& extension, bool recursive, std::vector<std::string>& files) {
+#ifdef _WIN32
+        _finddata_t entry;
+        intptr_t handle = _findfirst((directory + "/*").c_str(), &entry);
+        if (handle == -1) {
+            return;
+        }
+        do {
+            std::string name = entry.name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string path = directory + "/" + name;
+            if (entry.attrib & _A_SUBDIR) {
+                if (recursive) {
+                    collectFiles(path, extension, recursive, files);
+                }
+            }
+            else if (hasExtension(name, extension)) {
+                files.push_back(path);
+            }
+        } while (_findnext(handle, &entry) == 0);
+        _findclose(handle);
+#else
+        DIR* dir = opendir(directory.c_str());
+        if (!dir) {
+            return;
+        }
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            std::string path = directory + "/" + name;
+            struct stat fileStat;
+            if (stat(path.c_str(), &fileStat) != 0) {
+                continue;
+            }
+            if (S_ISDIR(fileStat.st_mode)) {
+                if (recursive) {
+                    collectFiles(path, extension, recursive, files);
+                }
+            }
+            else if (hasExtension(name, extension)) {
+                files.push_back(path);
+            }
+        }
+        closedir(dir);
+#endif
+    }
+}
+
+std::vector<std::string> listFiles(const std::string& directory, const std::string& extension, bool recursive) {
+    std::vector<std::string> files;
+    collectFiles(directory, extension, recursive, files);
+    std::sort(files.begin(), files.end());
+    return files;
+}
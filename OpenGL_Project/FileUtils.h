@@ -0,0 +1,19 @@
+#ifndef FILEUTILS_H
+#define FILEUTILS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small platform wrappers for the asset caches and cook tools
+bool getFileStat(const std::string& path, uint64_t& modifiedTime, uint64_t& size);
+bool fileExists(const std::string& path);
+void makeDirectory(const std::string& path);
+
+// Writes through a temporary file and renames it over path, so a crash never leaves a truncated file behind
+bool writeFileAtomically(const std::string& path, const std::string& data);
+
+// Lists files under a directory whose names end with the given extension (e.g. ".obj")
+std::vector<std::string> listFiles(const std::string& directory, const std::string& extension, bool recursive);
+
+#endif
@@ -0,0 +1,127 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+const size_t FrustumCuller::MaxFrusta;
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection) {
+    // Gribb-Hartmann: combinations of the matrix rows (glm is column-major)
+    const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // Left
+    frustum.planes[1] = row3 - row0; // Right
+    frustum.planes[2] = row3 + row1; // Bottom
+    frustum.planes[3] = row3 - row1; // Top
+    frustum.planes[4] = row3 + row2; // Near
+    frustum.planes[5] = row3 - row2; // Far
+
+    for (glm::vec4& plane : frustum.planes) {
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+void FrustumCuller::clear() {
+    count = 0;
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+}
+
+size_t FrustumCuller::add(const Aabb& worldBox) {
+    const glm::vec3 center = worldBox.getCenter();
+    const glm::vec3 extents = worldBox.getExtents();
+
+    // Grow by a whole block of four at a time; unused lanes stay empty boxes
+    if (count % 4 == 0) {
+        const size_t padded = count + 4;
+        centerX.resize(padded, 0.0f); centerY.resize(padded, 0.0f); centerZ.resize(padded, 0.0f);
+        extentX.resize(padded, 0.0f); extentY.resize(padded, 0.0f); extentZ.resize(padded, 0.0f);
+    }
+
+    centerX[count] = center.x; centerY[count] = center.y; centerZ[count] = center.z;
+    extentX[count] = extents.x; extentY[count] = extents.y; extentZ[count] = extents.z;
+    return count++;
+}
+
+void FrustumCuller::cull(const Frustum* frusta, size_t frustumCount, std::vector<unsigned char>& masks) const {
+    masks.assign(count, 0);
+    frustumCount = std::min(frustumCount, MaxFrusta);
+
+    for (size_t f = 0; f < frustumCount; ++f) {
+        const unsigned char bit = static_cast<unsigned char>(1u << f);
+        const Frustum& frustum = frusta[f];
+
+        // A box is outside once it lies fully behind any plane: n.c + |n|.e + w < 0
+        for (size_t i = 0; i < count; i += 4) {
+#ifdef FRUSTUM_CULLER_SSE
+            const __m128 cx = _mm_loadu_ps(&centerX[i]);
+            const __m128 cy = _mm_loadu_ps(&centerY[i]);
+            const __m128 cz = _mm_loadu_ps(&centerZ[i]);
+            const __m128 ex = _mm_loadu_ps(&extentX[i]);
+            const __m128 ey = _mm_loadu_ps(&extentY[i]);
+            const __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : frustum.planes) {
+                const __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                const __m128 radius = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+                    _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            const int lanes = _mm_movemask_ps(inside);
+#else
+            int lanes = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                const size_t b = i + lane;
+                bool visible = true;
+                for (const glm::vec4& plane : frustum.planes) {
+                    const float distance = plane.x * centerX[b] + plane.y * centerY[b] + plane.z * centerZ[b] + plane.w;
+                    const float radius = std::fabs(plane.x) * extentX[b] + std::fabs(plane.y) * extentY[b] + std::fabs(plane.z) * extentZ[b];
+                    visible = visible && distance + radius >= 0.0f;
+                }
+                lanes |= visible ? (1 << lane) : 0;
+            }
+#endif
+            for (size_t lane = 0; lane < 4 && i + lane < count; ++lane) {
+                if (lanes & (1 << lane)) {
+                    masks[i + lane] |= bit;
+                }
+            }
+        }
+    }
+}
+
+CullStats FrustumCuller::countVisible(const std::vector<unsigned char>& masks, size_t frustumIndex) {
+    CullStats stats;
+    stats.tested = masks.size();
+    for (unsigned char mask : masks) {
+        if (mask & (1u << frustumIndex)) {
+            stats.visible++;
+        }
+    }
+    return stats;
+}
+
+void FrustumCuller::logIfChanged(const std::string& pass, const CullStats& current, CullStats& previous) {
+    if (current != previous) {
+        std::cout << pass << ": " << current.visible << " visible, " << current.getCulled() << " culled of "
+            << current.tested << " objects" << std::endl;
+        previous = current;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <string>
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+#include "BoundingVolume.h"
+
+// Six inward-facing planes (xyz normal, w distance) taken from a view-projection matrix
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+};
+
+// Objects tested and left visible by one render pass
+struct CullStats {
+    size_t tested = 0;
+    size_t visible = 0;
+
+    size_t getCulled() const { return tested - visible; }
+    bool operator!=(const CullStats& other) const { return tested != other.tested || visible != other.visible; }
+};
+
+// Batched frustum culling of world-space AABBs. Boxes are kept as center/extent
+// arrays (structure of arrays) so the kernel tests four boxes per SSE instruction,
+// and one call tests every box against several frusta (camera plus shadow lights).
+class FrustumCuller {
+public:
+    // Each frustum owns one bit of the visibility masks
+    static const size_t MaxFrusta = 8;
+
+    void clear();
+
+    // Adds a box and returns its index into the visibility masks
+    size_t add(const Aabb& worldBox);
+
+    size_t size() const { return count; }
+
+    // masks[i] gets bit f set when box i intersects frusta[f]
+    void cull(const Frustum* frusta, size_t frustumCount, std::vector<unsigned char>& masks) const;
+
+    // Per-pass counts for the frustum with the given bit
+    static CullStats countVisible(const std::vector<unsigned char>& masks, size_t frustumIndex);
+
+    // Prints a pass's counts when they differ from the last ones printed for it
+    static void logIfChanged(const std::string& pass, const CullStats& current, CullStats& previous);
+
+private:
+    size_t count = 0;
+
+    // Padded to a multiple of four with empty boxes
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+    : next(0), open(false), totalMs(0.0), samples(0) {
+    for (unsigned i = 0; i < Latency; ++i) {
+        queries[i][0] = queries[i][1] = 0;
+        pending[i] = false;
+    }
+}
+
+GpuTimer::~GpuTimer() {
+    if (queries[0][0]) {
+        glDeleteQueries(Latency * 2, &queries[0][0]);
+    }
+}
+
+void GpuTimer::begin() {
+    if (!queries[0][0]) {
+        glGenQueries(Latency * 2, &queries[0][0]);
+    }
+    collect();
+    if (pending[next]) {
+        return;
+    }
+    glQueryCounter(queries[next][0], GL_TIMESTAMP);
+    open = true;
+}
+
+void GpuTimer::end() {
+    if (!open) {
+        return;
+    }
+    glQueryCounter(queries[next][1], GL_TIMESTAMP);
+    pending[next] = true;
+    next = (next + 1) % Latency;
+    open = false;
+}
+
+void GpuTimer::collect() {
+    for (unsigned i = 0; i < Latency; ++i) {
+        if (!pending[i]) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint64 start = 0, stop = 0;
+        glGetQueryObjectui64v(queries[i][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[i][1], GL_QUERY_RESULT, &stop);
+        totalMs += static_cast<double>(stop - start) / 1.0e6;
+        ++samples;
+        pending[i] = false;
+    }
+}
+
+double GpuTimer::getAverageMs() {
+    collect();
+    return samples > 0 ? totalMs / samples : 0.0;
+}
+
+unsigned GpuTimer::getSampleCount() {
+    collect();
+    return samples;
+}
+
+void GpuTimer::reset() {
+    // Spans still in flight belong to the old measurement; their queries are reissued
+    for (unsigned i = 0; i < Latency; ++i) {
+        pending[i] = false;
+    }
+    totalMs = 0.0;
+    samples = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glew.h>
+
+// GPU time of a span of GL commands, from a pair of timestamp queries. Timestamps (not
+// GL_TIME_ELAPSED) so timers may overlap or nest. Results are read a few frames late,
+// once the queries are available, so the CPU never waits for the GPU; they accumulate
+// into an average until reset. GL thread.
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Once per frame at most; a span is dropped while all its query pairs are in flight
+    void begin();
+    void end();
+
+    // Average over the spans finished since the last reset, in milliseconds
+    double getAverageMs();
+    unsigned getSampleCount();
+    void reset();
+
+private:
+    static const unsigned Latency = 4; // Query pairs in flight
+
+    void collect();
+
+    GLuint queries[Latency][2];
+    bool pending[Latency];
+    unsigned next;
+    bool open;
+    double totalMs;
+    unsigned samples;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef HASHUTILS_H
+#define HASHUTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used for cache keys and content validation
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    return hashBytes(text.data(), text.size(), hash);
+}
+
+#endif
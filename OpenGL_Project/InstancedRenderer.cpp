@@ -1,31 +1,35 @@
 #include "InstancedRenderer.h"
+#include "LodSelector.h"
+#include "ProgramUniforms.h"
 #include "Dependencies/glm/gtc/matrix_transform.hpp"
 #include <iostream>
-#include "ModelLoader.h"
 
 InstancedRenderer::InstancedRenderer(const std::string& modelPath, const std::string& texturePath, int instanceCount)
-    : texture(texturePath), instanceCount(instanceCount) {
-    loadModelData(modelPath);
-}
+    : modelPath(modelPath), texturePath(texturePath), texturePacked(false), instanceCount(instanceCount), loadRequested(false), VAO(0), instanceVBO(0) {}
 
 InstancedRenderer::~InstancedRenderer() {
     glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &texCoordVBO);
-    glDeleteBuffers(1, &normalVBO);
     glDeleteBuffers(1, &instanceVBO);
 }
 
-void InstancedRenderer::loadModelData(const std::string& modelPath) {
-    ModelLoader modelLoader(modelPath);
-    modelLoader.loadModel();
+void InstancedRenderer::initialize() {
+    // Already requested (the owning scene may initialize it again)
+    if (loadRequested) {
+        return;
+    }
+    loadRequested = true;
 
-    positions = modelLoader.getPositions();
-    texCoords = modelLoader.getTexCoords();
-    normals = modelLoader.getNormals();
+    MeshRegistry::instance().loadAsync(modelPath, [this](const std::shared_ptr<const Mesh>& loaded) {
+        mesh = loaded;
+        createVertexArray();
+    });
 }
 
-void InstancedRenderer::initialize() {
+void InstancedRenderer::createVertexArray() {
+    if (VAO != 0 || !mesh) {
+        return;
+    }
+
     std::vector<glm::mat4> instanceMatrices(instanceCount);
 
     int gridSize = static_cast<int>(sqrt(instanceCount)); // Calculate grid size
@@ -44,32 +48,14 @@ void InstancedRenderer::initialize() {
         instanceMatrices[i] = model;
     }
 
-    // Set up VAO, VBOs
+    // Own VAO over the shared mesh buffers, with this renderer's attribute layout
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &texCoordVBO);
-    glGenBuffers(1, &normalVBO);
     glGenBuffers(1, &instanceVBO);
 
     glBindVertexArray(VAO);
 
-    // Position Buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Texture Coordinate Buffer
-    glBindBuffer(GL_ARRAY_BUFFER, texCoordVBO);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
-    glEnableVertexAttribArray(1);
-
-    // Normal Buffer
-    glBindBuffer(GL_ARRAY_BUFFER, normalVBO);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-    glEnableVertexAttribArray(2);
+    // Shared packed vertex and index buffers (position 0, normal 1, texcoord 2)
+    mesh->bindAttributes();
 
     // Instance Matrix Buffer
     glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
@@ -86,11 +72,28 @@ void InstancedRenderer::initialize() {
 
 void InstancedRenderer::render(GLuint shaderProgram, const glm::mat4& viewProjectionMatrix) {
     glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "viewProjectionMatrix"), 1, GL_FALSE, &viewProjectionMatrix[0][0]);
+    ProgramUniforms& uniforms = ProgramUniforms::get(shaderProgram);
+    uniforms.set(ProgramUniforms::ViewProjectionMatrix, viewProjectionMatrix);
+
+    if (VAO == 0) {
+        return;
+    }
+
+    mesh->applyVertexDecode(shaderProgram);
 
-    texture.bind();
+    if (!diffuse.isValid() && !texturePacked) {
+        texturePacked = true;
+        diffuse = TextureCache::instance().loadPacked({ texturePath })[0];
+    }
+    if (diffuse.isValid()) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, diffuse.array->getID());
+        uniforms.set(ProgramUniforms::DiffuseLayer, static_cast<float>(diffuse.layer));
+    }
     glBindVertexArray(VAO);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, positions.size(), instanceCount);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->getIndexCount(), mesh->getIndexType(), 0, instanceCount);
     glBindVertexArray(0);
-    texture.unbind();
+
+    // Instances always draw full detail
+    const size_t triangles = static_cast<size_t>(mesh->getIndexCount() / 3) * instanceCount;
+    LodSelector::recordDraw(triangles, triangles);
 }
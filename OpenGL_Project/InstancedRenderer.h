@@ -2,30 +2,43 @@
 #define INSTANCEDRENDERER_H
 
 #include <glew.h>
+#include <memory>
 #include <vector>
 #include <string>
 #include "Dependencies/glm/glm.hpp"
-#include "Dependencies/tiny_obj_loader.h"
-#include "Texture.h"
+#include "MeshRegistry.h"
+#include "TextureCache.h"
 
 class InstancedRenderer
 {
 public:
     InstancedRenderer(const std::string& modelPath, const std::string& texturePath, int instanceCount);
     ~InstancedRenderer();
+
+    // Starts the background mesh load; instances are drawn once it has arrived
     void initialize();
+
+    // Binds the diffuse array on the active texture unit and sets diffuseLayer. Without a
+    // layer from the scene, the texture is packed on its own at the first call.
     void render(GLuint shaderProgram, const glm::mat4& viewProjectionMatrix);
 
+    const std::string& getTexturePath() const { return texturePath; }
+
+    // Layer of a texture array the scene packed with its other textures
+    void setDiffuse(const TextureLayer& layer) { diffuse = layer; }
+
 private:
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec2> texCoords;
-    std::vector<glm::vec3> normals;
-    Texture texture;
+    std::string modelPath;
+    std::shared_ptr<const Mesh> mesh; // Vertex and index buffers shared through the MeshRegistry
+    std::string texturePath;
+    TextureLayer diffuse;
+    bool texturePacked;
     int instanceCount;
+    bool loadRequested;
 
-    GLuint VAO, VBO, texCoordVBO, normalVBO, instanceVBO;
+    GLuint VAO, instanceVBO;
 
-    void loadModelData(const std::string& modelPath);
+    void createVertexArray();
 };
 
 #endif 
@@ -1,48 +1,32 @@
 #include "LODScene.h"
+#include "LodSelector.h"
+#include "ProgramCompiler.h"
+#include "ProgramUniforms.h"
 #include <iostream>
 #include <vector>
-#include "Dependencies/stb_image.h"
 #include "Dependencies/glm/gtc/type_ptr.hpp"
 
-// Texture loading utility function (if not using a separate Texture class)
-GLuint LoadTexture(const char* path, bool gammaCorrection = false)
+namespace {
+    const char* TriangleTexturePath = "Resources/Textures/texture1.jpg";
+    const char* QuadTexturePath = "Resources/Textures/texture2.jpg";
+    const char* TerrainHeightmapPath = "Resources/Heightmap0.jpg";
+    const char* TerrainTexturePath = "Resources/Textures/texture3.jpg";
+}
+
+// Texture loading utility function: shared through the TextureCache, flipped on load and
+// streamed, since render asks for each texture's detail
+std::shared_ptr<const CachedTexture> LoadTexture(const char* path)
 {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    // Flip textures on load
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Texture Parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    TextureParams params;
+    params.wrap = GL_CLAMP_TO_EDGE;
+    params.flipVertically = LODScene::FlipTextures;
+    params.streamable = true;
+    return TextureCache::instance().load(path, params);
+}
 
-    return textureID;
+std::vector<std::string> LODScene::getTexturePaths()
+{
+    return { TriangleTexturePath, QuadTexturePath, TerrainHeightmapPath, TerrainTexturePath };
 }
 
 LODScene::LODScene(ShaderLoader& shaderLoader, Camera& camera)
@@ -51,8 +35,6 @@ LODScene::LODScene(ShaderLoader& shaderLoader, Camera& camera)
     triangleVAO(0), triangleVBO(0),
     quadVAO(0), quadVBO(0), quadEBO(0),
     terrainVAO(0), terrainVBO(0), terrainEBO(0),
-    triangleTexture(0), quadTexture(0),
-    terrainHeightmap(0), terrainTexture(0),
     terrainResolution(32) // Default resolution
 {
 }
@@ -60,12 +42,18 @@ LODScene::LODScene(ShaderLoader& shaderLoader, Camera& camera)
 LODScene::~LODScene()
 {
     // Cleanup Shader Programs
-    if (triangleProgram)
+    if (triangleProgram) {
+        ProgramUniforms::release(triangleProgram);
         glDeleteProgram(triangleProgram);
-    if (quadProgram)
+    }
+    if (quadProgram) {
+        ProgramUniforms::release(quadProgram);
         glDeleteProgram(quadProgram);
-    if (terrainProgram)
+    }
+    if (terrainProgram) {
+        ProgramUniforms::release(terrainProgram);
         glDeleteProgram(terrainProgram);
+    }
 
     // Cleanup VAOs and VBOs
     if (triangleVAO)
@@ -84,78 +72,51 @@ LODScene::~LODScene()
         glDeleteBuffers(1, &terrainVBO);
     if (terrainEBO)
         glDeleteBuffers(1, &terrainEBO);
-
-    // Cleanup Textures
-    if (triangleTexture)
-        glDeleteTextures(1, &triangleTexture);
-    if (quadTexture)
-        glDeleteTextures(1, &quadTexture);
-    if (terrainHeightmap)
-        glDeleteTextures(1, &terrainHeightmap);
-    if (terrainTexture)
-        glDeleteTextures(1, &terrainTexture);
 }
 
 void LODScene::initialize()
 {
-    // Load and compile shader programs
+    // Load and compile shader programs, tessellation stages included
     // Triangle Shader Program
-    triangleProgram = shaderLoader.CreateProgram("triangle_vertex.txt", "triangle_fragment.txt");
-    // Attach Tessellation Control and Evaluation Shaders
-    GLuint tessControlShader = shaderLoader.CreateShader(GL_TESS_CONTROL_SHADER, "triangle_tess_control.txt");
-    GLuint tessEvalShader = shaderLoader.CreateShader(GL_TESS_EVALUATION_SHADER, "triangle_tess_eval.txt");
-    glAttachShader(triangleProgram, tessControlShader);
-    glAttachShader(triangleProgram, tessEvalShader);
-    glLinkProgram(triangleProgram);
-
-    // Check for linking errors
-    GLint success;
-    glGetProgramiv(triangleProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        GLchar infoLog[1024];
-        glGetProgramInfoLog(triangleProgram, 1024, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::TRIANGLE::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-
-    glDeleteShader(tessControlShader);
-    glDeleteShader(tessEvalShader);
+    triangleProgram = shaderLoader.CreateProgram({
+        { GL_VERTEX_SHADER, "triangle_vertex.txt" },
+        { GL_TESS_CONTROL_SHADER, "triangle_tess_control.txt" },
+        { GL_TESS_EVALUATION_SHADER, "triangle_tess_eval.txt" },
+        { GL_FRAGMENT_SHADER, "triangle_fragment.txt" } });
 
     // Quad Shader Program
-    quadProgram = shaderLoader.CreateProgram("quad_vertex.txt", "quad_fragment.txt");
-    GLuint quadTessControlShader = shaderLoader.CreateShader(GL_TESS_CONTROL_SHADER, "quad_tess_control.txt");
-    GLuint quadTessEvalShader = shaderLoader.CreateShader(GL_TESS_EVALUATION_SHADER, "quad_tess_eval.txt");
-    glAttachShader(quadProgram, quadTessControlShader);
-    glAttachShader(quadProgram, quadTessEvalShader);
-    glLinkProgram(quadProgram);
-
-    glGetProgramiv(quadProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        GLchar infoLog[1024];
-        glGetProgramInfoLog(quadProgram, 1024, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::QUAD::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(quadTessControlShader);
-    glDeleteShader(quadTessEvalShader);
+    quadProgram = shaderLoader.CreateProgram({
+        { GL_VERTEX_SHADER, "quad_vertex.txt" },
+        { GL_TESS_CONTROL_SHADER, "quad_tess_control.txt" },
+        { GL_TESS_EVALUATION_SHADER, "quad_tess_eval.txt" },
+        { GL_FRAGMENT_SHADER, "quad_fragment.txt" } });
 
     // Terrain Shader Program
-    terrainProgram = shaderLoader.CreateProgram("terrain_vertex.txt", "terrain_fragment.txt");
-    GLuint terrainTessControlShader = shaderLoader.CreateShader(GL_TESS_CONTROL_SHADER, "terrain_tess_control.txt");
-    GLuint terrainTessEvalShader = shaderLoader.CreateShader(GL_TESS_EVALUATION_SHADER, "terrain_tess_eval.txt");
-    glAttachShader(terrainProgram, terrainTessControlShader);
-    glAttachShader(terrainProgram, terrainTessEvalShader);
-    glLinkProgram(terrainProgram);
-
-    glGetProgramiv(terrainProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        GLchar infoLog[1024];
-        glGetProgramInfoLog(terrainProgram, 1024, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::TERRAIN::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(terrainTessControlShader);
-    glDeleteShader(terrainTessEvalShader);
+    terrainProgram = shaderLoader.CreateProgram({
+        { GL_VERTEX_SHADER, "terrain_vertex.txt" },
+        { GL_TESS_CONTROL_SHADER, "terrain_tess_control.txt" },
+        { GL_TESS_EVALUATION_SHADER, "terrain_tess_eval.txt" },
+        { GL_FRAGMENT_SHADER, "terrain_fragment.txt" } });
+
+    // Checked once all three are submitted, so the driver builds them side by side; a
+    // failed program keeps its name
+    ProgramCompiler& compiler = ProgramCompiler::instance();
+    if (compiler.hasFailed(triangleProgram))
+        std::cerr << "ERROR::SHADER::TRIANGLE::PROGRAM::LINKING_FAILED" << std::endl;
+    if (compiler.hasFailed(quadProgram))
+        std::cerr << "ERROR::SHADER::QUAD::PROGRAM::LINKING_FAILED" << std::endl;
+    if (compiler.hasFailed(terrainProgram))
+        std::cerr << "ERROR::SHADER::TERRAIN::PROGRAM::LINKING_FAILED" << std::endl;
+
+    // Uniform handles; the locations resolve on first use
+    triangleTextureUnit = ProgramUniforms::get(triangleProgram).find("texture1");
+    ProgramUniforms& quadUniforms = ProgramUniforms::get(quadProgram);
+    quadInnerLevel = quadUniforms.find("innerLevel");
+    quadOuterLevel = quadUniforms.find("outerLevel");
+    quadTextureUnit = quadUniforms.find("texture1");
+    ProgramUniforms& terrainUniforms = ProgramUniforms::get(terrainProgram);
+    terrainHeightmapUnit = terrainUniforms.find("heightmap");
+    terrainTextureUnit = terrainUniforms.find("terrainTexture");
 
     // Setup Geometry
     setupTriangle();
@@ -295,23 +256,23 @@ void LODScene::calculateTerrainGeometry()
 void LODScene::loadTextures()
 {
     // Load Triangle Texture
-    triangleTexture = LoadTexture("Resources/Textures/texture1.jpg");
-    if (triangleTexture == 0)
+    triangleTexture = LoadTexture(TriangleTexturePath);
+    if (!triangleTexture)
         std::cerr << "Failed to load triangle texture." << std::endl;
 
     // Load Quad Texture
-    quadTexture = LoadTexture("Resources/Textures/texture2.jpg");
-    if (quadTexture == 0)
+    quadTexture = LoadTexture(QuadTexturePath);
+    if (!quadTexture)
         std::cerr << "Failed to load quad texture." << std::endl;
 
     // Load Terrain Heightmap (Grayscale Image)
-    terrainHeightmap = LoadTexture("Resources/Heightmap0.jpg");
-    if (terrainHeightmap == 0)
+    terrainHeightmap = LoadTexture(TerrainHeightmapPath);
+    if (!terrainHeightmap)
         std::cerr << "Failed to load terrain heightmap." << std::endl;
 
     // Load Terrain Texture
-    terrainTexture = LoadTexture("Resources/Textures/texture3.jpg");
-    if (terrainTexture == 0)
+    terrainTexture = LoadTexture(TerrainTexturePath);
+    if (!terrainTexture)
         std::cerr << "Failed to load terrain texture." << std::endl;
 }
 
@@ -331,17 +292,17 @@ void LODScene::render()
     triangleModel = glm::scale(triangleModel, glm::vec3(0.5f)); // Optional: Scale down
 
     // Set Uniforms
-    GLint projLoc = glGetUniformLocation(triangleProgram, "projection");
-    GLint viewLoc = glGetUniformLocation(triangleProgram, "view");
-    GLint modelLoc = glGetUniformLocation(triangleProgram, "model");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(triangleModel));
-
-    // Bind Texture
+    ProgramUniforms& triangleUniforms = ProgramUniforms::get(triangleProgram);
+    triangleUniforms.set(ProgramUniforms::Projection, projection);
+    triangleUniforms.set(ProgramUniforms::View, view);
+    triangleUniforms.set(ProgramUniforms::Model, triangleModel);
+
+    // Bind Texture, asking for the mip detail the triangle covers on screen
+    const BoundingSphere triangleBounds = { glm::vec3(50.0f / 3.0f, 50.0f / 3.0f, 0.0f), 37.3f };
+    triangleTexture->requestDetail(LodSelector::screenSize(triangleBounds.transformed(triangleModel), view, projection));
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, triangleTexture);
-    glUniform1i(glGetUniformLocation(triangleProgram, "texture1"), 0);
+    glBindTexture(GL_TEXTURE_2D, triangleTexture->getID());
+    triangleUniforms.set(triangleTextureUnit, 0);
 
     // Draw Triangle as Patch
     glBindVertexArray(triangleVAO);
@@ -358,12 +319,10 @@ void LODScene::render()
     quadModel = glm::scale(quadModel, glm::vec3(0.75f)); // Optional: Scale down
 
     // Set Uniforms
-    projLoc = glGetUniformLocation(quadProgram, "projection");
-    viewLoc = glGetUniformLocation(quadProgram, "view");
-    GLint quadModelLoc = glGetUniformLocation(quadProgram, "model");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(quadModelLoc, 1, GL_FALSE, glm::value_ptr(quadModel));
+    ProgramUniforms& quadUniforms = ProgramUniforms::get(quadProgram);
+    quadUniforms.set(ProgramUniforms::Projection, projection);
+    quadUniforms.set(ProgramUniforms::View, view);
+    quadUniforms.set(ProgramUniforms::Model, quadModel);
 
     // Calculate distance from camera to quad
     glm::vec3 quadPos = glm::vec3(15.0f, 15.0f, -50.0f);
@@ -378,13 +337,15 @@ void LODScene::render()
     float innerLevel = glm::mix(1.0f, 7.0f, t); // Inner levels from 1 to 7
     float outerLevel = glm::mix(1.0f, 5.0f, t); // Outer levels from 1 to 5
 
-    glUniform1f(glGetUniformLocation(quadProgram, "innerLevel"), innerLevel);
-    glUniform1f(glGetUniformLocation(quadProgram, "outerLevel"), outerLevel);
+    quadUniforms.set(quadInnerLevel, innerLevel);
+    quadUniforms.set(quadOuterLevel, outerLevel);
 
     // Bind Quad Texture
+    const BoundingSphere quadBounds = { glm::vec3(0.0f), 70.8f };
+    quadTexture->requestDetail(LodSelector::screenSize(quadBounds.transformed(quadModel), view, projection));
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, quadTexture);
-    glUniform1i(glGetUniformLocation(quadProgram, "texture1"), 0);
+    glBindTexture(GL_TEXTURE_2D, quadTexture->getID());
+    quadUniforms.set(quadTextureUnit, 0);
 
     // Draw Quad as Patch
     glBindVertexArray(quadVAO);
@@ -399,22 +360,22 @@ void LODScene::render()
     glm::mat4 terrainModel = glm::mat4(1.0f); // Identity matrix
 
     // Set Uniforms
-    projLoc = glGetUniformLocation(terrainProgram, "projection");
-    viewLoc = glGetUniformLocation(terrainProgram, "view");
-    GLint terrainModelLoc = glGetUniformLocation(terrainProgram, "model");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(terrainModelLoc, 1, GL_FALSE, glm::value_ptr(terrainModel));
+    ProgramUniforms& terrainUniforms = ProgramUniforms::get(terrainProgram);
+    terrainUniforms.set(ProgramUniforms::Projection, projection);
+    terrainUniforms.set(ProgramUniforms::View, view);
+    terrainUniforms.set(ProgramUniforms::Model, terrainModel);
 
     // Bind Heightmap Texture
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, terrainHeightmap);
-    glUniform1i(glGetUniformLocation(terrainProgram, "heightmap"), 0);
+    glBindTexture(GL_TEXTURE_2D, terrainHeightmap->getID());
+    terrainUniforms.set(terrainHeightmapUnit, 0);
 
     // Bind Terrain Texture
+    const BoundingSphere terrainBounds = { glm::vec3(0.0f), 70.8f };
+    terrainTexture->requestDetail(LodSelector::screenSize(terrainBounds.transformed(terrainModel), view, projection));
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, terrainTexture);
-    glUniform1i(glGetUniformLocation(terrainProgram, "terrainTexture"), 1);
+    glBindTexture(GL_TEXTURE_2D, terrainTexture->getID());
+    terrainUniforms.set(terrainTextureUnit, 1);
 
     // Draw Terrain as Patch
     glBindVertexArray(terrainVAO);
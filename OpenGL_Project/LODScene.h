@@ -4,8 +4,9 @@
 #include "Dependencies/GLEW/glew.h"
 #include "Dependencies/glm/glm.hpp"
 #include "ShaderLoader.h"
+#include "ProgramUniforms.h"
 #include "Camera.h"
-#include "Texture.h"
+#include "TextureCache.h"
 #include <string>
 #include <vector>
 
@@ -22,6 +23,10 @@ public:
     // Render the scene
     void render();
 
+    // Images the scene loads, all with this orientation (for the texture cook tool)
+    static const bool FlipTextures = true;
+    static std::vector<std::string> getTexturePaths();
+
 private:
     // References to ShaderLoader and Camera
     ShaderLoader& shaderLoader;
@@ -32,16 +37,21 @@ private:
     GLuint quadProgram;
     GLuint terrainProgram;
 
+    // Uniform handles, found once the programs are created
+    ProgramUniforms::Handle triangleTextureUnit;
+    ProgramUniforms::Handle quadInnerLevel, quadOuterLevel, quadTextureUnit;
+    ProgramUniforms::Handle terrainHeightmapUnit, terrainTextureUnit;
+
     // Vertex Array Objects and Vertex Buffer Objects
     GLuint triangleVAO, triangleVBO;
     GLuint quadVAO, quadVBO, quadEBO;
     GLuint terrainVAO, terrainVBO, terrainEBO;
 
     // Textures
-    GLuint triangleTexture;
-    GLuint quadTexture;
-    GLuint terrainHeightmap;
-    GLuint terrainTexture;
+    std::shared_ptr<const CachedTexture> triangleTexture;
+    std::shared_ptr<const CachedTexture> quadTexture;
+    std::shared_ptr<const CachedTexture> terrainHeightmap;
+    std::shared_ptr<const CachedTexture> terrainTexture;
 
     // Terrain Parameters
     int terrainResolution; // e.g., 32 for a 32x32 grid
@@ -0,0 +1,211 @@
+#include "LightClusters.h"
+#include "ProgramCompiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    // Clusters per work group of light_cluster_compute.txt (BATCH_SIZE)
+    const unsigned BatchSize = 128;
+
+    bool sphereIntersectsBox(const glm::vec4& sphere, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        const glm::vec3 offset = glm::vec3(sphere) - glm::clamp(glm::vec3(sphere), boxMin, boxMax);
+        return glm::dot(offset, offset) <= sphere.w * sphere.w;
+    }
+
+    // View-space position and range of a light, as the compute shader sees it
+    glm::vec4 getViewSphere(const LightManager::Light& light, const glm::mat4& view) {
+        return glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), LightManager::getLightRange(light));
+    }
+}
+
+LightClusters::LightClusters()
+    : program(0), boundsBuffer(0), gridBuffer(0), boundsProjection(0.0f), lastView(1.0f) {
+}
+
+LightClusters::~LightClusters() {
+    // The program belongs to the ShaderLoader variant cache
+    if (boundsBuffer) glDeleteBuffers(1, &boundsBuffer);
+    if (gridBuffer) glDeleteBuffers(1, &gridBuffer);
+}
+
+void LightClusters::init(ShaderLoader& shaderLoader) {
+    program = shaderLoader.GetVariant({ { GL_COMPUTE_SHADER, "light_cluster_compute.txt" } }, {});
+    if (ProgramCompiler::instance().hasFailed(program)) {
+        program = 0;
+        std::cerr << "LightClusters: light assignment shader failed, clustered lighting is off" << std::endl;
+        return;
+    }
+
+    glGenBuffers(1, &boundsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, ClusterCount * 2 * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+
+    // Counts, then a fixed-size index list per cluster
+    glGenBuffers(1, &gridBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (ClusterCount + ClusterCount * MaxLightsPerCluster) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightClusters::assignLights(const glm::mat4& view, const glm::mat4& projection) {
+    if (program == 0) {
+        return;
+    }
+
+    if (bounds.empty() || projection != boundsProjection) {
+        computeBounds(projection, bounds);
+        boundsProjection = projection;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bounds.size() * sizeof(glm::vec4), bounds.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    lastView = view;
+
+    glUseProgram(program);
+    ProgramUniforms::get(program).set(ProgramUniforms::View, view);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BoundsBinding, boundsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, gridBuffer);
+    glDispatchCompute((ClusterCount + BatchSize - 1) / BatchSize, 1, 1);
+
+    // The lighting pass reads the lists
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+glm::vec2 LightClusters::getTileScale(unsigned screenWidth, unsigned screenHeight) const {
+    return glm::vec2(static_cast<float>(GridX) / screenWidth, static_cast<float>(GridY) / screenHeight);
+}
+
+glm::vec2 LightClusters::getDepthScaleBias() const {
+    float nearPlane, farPlane;
+    getDepthRange(boundsProjection, nearPlane, farPlane);
+    const float scale = GridZ / std::log(farPlane / nearPlane);
+    return glm::vec2(scale, -std::log(nearPlane) * scale);
+}
+
+void LightClusters::getDepthRange(const glm::mat4& projection, float& nearPlane, float& farPlane) {
+    nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+}
+
+void LightClusters::computeBounds(const glm::mat4& projection, std::vector<glm::vec4>& bounds) {
+    float nearPlane, farPlane;
+    getDepthRange(projection, nearPlane, farPlane);
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+
+    // View-space point on the ray through an NDC position, at a view depth
+    auto pointAtDepth = [&inverseProjection](float ndcX, float ndcY, float depth) {
+        const glm::vec4 onNearPlane = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+        const glm::vec3 ray = glm::vec3(onNearPlane) / onNearPlane.w;
+        return ray * (depth / -ray.z);
+    };
+
+    bounds.resize(ClusterCount * 2);
+    for (unsigned z = 0; z < GridZ; ++z) {
+        const float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / GridZ);
+        const float sliceFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / GridZ);
+        for (unsigned y = 0; y < GridY; ++y) {
+            const float ndcY[2] = { -1.0f + 2.0f * y / GridY, -1.0f + 2.0f * (y + 1) / GridY };
+            for (unsigned x = 0; x < GridX; ++x) {
+                const float ndcX[2] = { -1.0f + 2.0f * x / GridX, -1.0f + 2.0f * (x + 1) / GridX };
+
+                // The tile's corner rays between the slice's planes
+                glm::vec3 boxMin(INFINITY), boxMax(-INFINITY);
+                for (int corner = 0; corner < 8; ++corner) {
+                    const glm::vec3 point = pointAtDepth(ndcX[corner & 1], ndcY[(corner >> 1) & 1], (corner & 4) ? sliceFar : sliceNear);
+                    boxMin = glm::min(boxMin, point);
+                    boxMax = glm::max(boxMax, point);
+                }
+
+                const unsigned cluster = x + GridX * (y + GridY * z);
+                bounds[cluster * 2] = glm::vec4(boxMin, 0.0f);
+                bounds[cluster * 2 + 1] = glm::vec4(boxMax, 0.0f);
+            }
+        }
+    }
+}
+
+void LightClusters::assignLightsReference(const std::vector<LightManager::Light>& lights, size_t lightCount, const glm::mat4& view,
+    const std::vector<glm::vec4>& bounds, std::vector<GLuint>& counts, std::vector<GLuint>& indices) {
+    counts.assign(ClusterCount, 0);
+    indices.assign(ClusterCount * MaxLightsPerCluster, 0);
+
+    std::vector<glm::vec4> spheres;
+    spheres.reserve(lightCount);
+    for (size_t i = 0; i < lightCount; ++i) {
+        spheres.push_back(getViewSphere(lights[i], view));
+    }
+
+    for (unsigned cluster = 0; cluster < ClusterCount; ++cluster) {
+        const glm::vec3 boxMin(bounds[cluster * 2]), boxMax(bounds[cluster * 2 + 1]);
+        GLuint& count = counts[cluster];
+        for (size_t i = 0; i < spheres.size() && count < MaxLightsPerCluster; ++i) {
+            if (sphereIntersectsBox(spheres[i], boxMin, boxMax)) {
+                indices[cluster * MaxLightsPerCluster + count++] = static_cast<GLuint>(i);
+            }
+        }
+    }
+}
+
+size_t LightClusters::validate(const LightManager& lightManager) {
+    if (program == 0 || bounds.empty()) {
+        std::cout << "LightClusters: no light assignment to validate" << std::endl;
+        return 0;
+    }
+
+    std::vector<GLuint> grid(ClusterCount + ClusterCount * MaxLightsPerCluster);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, grid.size() * sizeof(GLuint), grid.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    const std::vector<LightManager::Light>& lights = lightManager.getPointLights();
+    // The lights the compute pass saw: those in the light buffer
+    const size_t lightCount = lightManager.getBufferedLightCount();
+    std::vector<GLuint> counts, indices;
+    assignLightsReference(lights, lightCount, lastView, bounds, counts, indices);
+
+    // A light in one list only, whose range ends at the cluster's surface, is rounding
+    size_t mismatches = 0, grazing = 0, assigned = 0, fullClusters = 0;
+    auto classify = [&](GLuint light, unsigned cluster) {
+        if (light >= lightCount) {
+            ++mismatches;
+            return;
+        }
+        const glm::vec4 sphere = getViewSphere(lights[light], lastView);
+        const glm::vec3 closest = glm::clamp(glm::vec3(sphere), glm::vec3(bounds[cluster * 2]), glm::vec3(bounds[cluster * 2 + 1]));
+        const float distance = glm::length(glm::vec3(sphere) - closest);
+        if (std::fabs(distance - sphere.w) <= 1e-3f * std::max(sphere.w, 1.0f)) {
+            ++grazing;
+        } else {
+            ++mismatches;
+        }
+    };
+
+    for (unsigned cluster = 0; cluster < ClusterCount; ++cluster) {
+        const GLuint* gpuList = &grid[ClusterCount + cluster * MaxLightsPerCluster];
+        const GLuint* cpuList = &indices[cluster * MaxLightsPerCluster];
+        const GLuint gpuCount = grid[cluster] < MaxLightsPerCluster ? grid[cluster] : MaxLightsPerCluster;
+        const GLuint cpuCount = counts[cluster];
+        assigned += cpuCount;
+        fullClusters += cpuCount == MaxLightsPerCluster ? 1 : 0;
+
+        // Both lists are in light order
+        GLuint i = 0, j = 0;
+        while (i < gpuCount || j < cpuCount) {
+            if (j == cpuCount || (i < gpuCount && gpuList[i] < cpuList[j])) {
+                classify(gpuList[i++], cluster);
+            } else if (i == gpuCount || cpuList[j] < gpuList[i]) {
+                classify(cpuList[j++], cluster);
+            } else {
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    std::cout << "LightClusters: " << lightCount << " lights, " << assigned << " assignments over " << ClusterCount
+        << " clusters (" << fullClusters << " full), " << mismatches << " mismatches with the CPU reference, "
+        << grazing << " grazing lights rounded differently" << std::endl;
+    return mismatches;
+}
@@ -0,0 +1,69 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <glew.h>
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+#include "LightManager.h"
+#include "ProgramUniforms.h"
+#include "ShaderLoader.h"
+
+// Clustered light assignment for the deferred lighting pass: the view frustum is split
+// into GridX x GridY screen tiles and GridZ depth slices growing exponentially from the
+// near plane, and a compute shader (light_cluster_compute.txt) lists the point lights
+// whose range reaches each cluster. The lighting shader then shades a pixel with its
+// cluster's lights only. Needs the light buffer to be a storage buffer.
+// The grid matches Resources/Shaders/light_clusters.glsl.
+class LightClusters {
+public:
+    static const unsigned GridX = 16;
+    static const unsigned GridY = 9;
+    static const unsigned GridZ = 24;
+    static const unsigned ClusterCount = GridX * GridY * GridZ;
+    static const unsigned MaxLightsPerCluster = 1024;
+
+    static const GLuint BoundsBinding = 2;
+    static const GLuint GridBinding = 3;
+
+    LightClusters();
+    ~LightClusters();
+
+    // GL thread
+    void init(ShaderLoader& shaderLoader);
+
+    // False until init, or when the light assignment shader failed to build
+    bool isAvailable() const { return program != 0; }
+
+    // Assigns the lights of the bound light buffer (LightManager::bindLightBuffer) to the
+    // clusters and binds the cluster buffers for the lighting pass. The bounds are only
+    // rebuilt when the projection changes.
+    void assignLights(const glm::mat4& view, const glm::mat4& projection);
+
+    // Values of the lighting shader's clusterTileScale and clusterDepthScaleBias
+    glm::vec2 getTileScale(unsigned screenWidth, unsigned screenHeight) const;
+    glm::vec2 getDepthScaleBias() const;
+
+    // Reads the last assignment back and compares it with assignLightsReference, for
+    // the lights as LightManager uploaded them. Differences where a light only grazes
+    // the cluster are float rounding and counted apart. Returns the real mismatches.
+    size_t validate(const LightManager& lightManager);
+
+    // CPU reference of the assignment, on the same cluster bounds (min, max per cluster)
+    static void computeBounds(const glm::mat4& projection, std::vector<glm::vec4>& bounds);
+    static void assignLightsReference(const std::vector<LightManager::Light>& lights, size_t lightCount, const glm::mat4& view,
+        const std::vector<glm::vec4>& bounds, std::vector<GLuint>& counts, std::vector<GLuint>& indices);
+
+private:
+    // Near and far plane of a perspective projection
+    static void getDepthRange(const glm::mat4& projection, float& nearPlane, float& farPlane);
+
+    GLuint program;
+    GLuint boundsBuffer;
+    GLuint gridBuffer;
+
+    glm::mat4 boundsProjection;
+    std::vector<glm::vec4> bounds;
+    glm::mat4 lastView;
+};
+
+#endif
@@ -2,9 +2,16 @@
 #include "LightManager.h"
 #include "ShaderLoader.h"
 #include "ModelLoader.h"
+#include "Dependencies/glm/gtc/constants.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
 
 LightManager::LightManager()
-    : pointLightsOn(true), directionalLightOn(true), spotLightOn(true)
+    : lightBuffer(0), lightBufferTarget(GL_SHADER_STORAGE_BUFFER), lightBufferCapacity(0), maxBufferLights(0),
+      headerUploaded(false), pointLightsOn(true), directionalLightOn(true), spotLightOn(true)
 {
     // Initialize 10 point lights with different positions and colors
     for (int i = 0; i < 10; ++i) {
@@ -30,6 +37,8 @@ LightManager::LightManager()
     spotLight.color = glm::vec3(1.0f, 1.0f, 1.0f); // White color
     spotLight.cutOff = glm::cos(glm::radians(12.5f));
     spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+
+    sceneLightCount = pointLights.size();
 }
 
 void LightManager::initialize()
@@ -96,53 +105,164 @@ void LightManager::initialize()
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glBindVertexArray(0);
+
+    initLightBuffer();
 }
 
-void LightManager::passLightData(GLuint shaderProgram, const glm::vec3& camPos, const glm::vec3& camDir)
+void LightManager::initLightBuffer()
 {
-    // Pass point lights
-    glUniform1i(glGetUniformLocation(shaderProgram, "numLights"), pointLights.size());
-    for (unsigned int i = 0; i < pointLights.size(); ++i)
-    {
-        std::string posName = "pointLights[" + std::to_string(i) + "].Position";
-        std::string colorName = "pointLights[" + std::to_string(i) + "].Color";
-        std::string linearName = "pointLights[" + std::to_string(i) + "].Linear";
-        std::string quadraticName = "pointLights[" + std::to_string(i) + "].Quadratic";
-        glUniform3fv(glGetUniformLocation(shaderProgram, posName.c_str()), 1, &pointLights[i].position[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, colorName.c_str()), 1, &pointLights[i].color[0]);
-        glUniform1f(glGetUniformLocation(shaderProgram, linearName.c_str()), pointLights[i].linear);
-        glUniform1f(glGetUniformLocation(shaderProgram, quadraticName.c_str()), pointLights[i].quadratic);
+    glGenBuffers(1, &lightBuffer);
+
+    // GL 4.3 only requires storage buffers in compute shaders
+    GLint fragmentStorageBlocks = 0;
+    glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &fragmentStorageBlocks);
+    if (fragmentStorageBlocks > 0) {
+        // The header alone, so binding it with no point lights is valid; grows on demand
+        lightBufferTarget = GL_SHADER_STORAGE_BUFFER;
+        maxBufferLights = SIZE_MAX;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuLightHeader), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return;
     }
 
-    // Pass directional light
-    if (directionalLightOn) {
-        glUniform3fv(glGetUniformLocation(shaderProgram, "dirLight.direction"), 1, &directionalLight.direction[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "dirLight.color"), 1, &directionalLight.color[0]);
+    // A uniform block as large as the driver allows, allocated whole since the block
+    // has a fixed size
+    GLint maxBlockSize = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+    lightBufferTarget = GL_UNIFORM_BUFFER;
+    maxBufferLights = (static_cast<size_t>(maxBlockSize) - sizeof(GpuLightHeader)) / sizeof(GpuPointLight);
+    lightBufferCapacity = maxBufferLights;
+    glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuLightHeader) + lightBufferCapacity * sizeof(GpuPointLight), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    std::cout << "LightManager: no fragment storage buffers, up to " << maxBufferLights << " point lights in a uniform block" << std::endl;
+}
+
+ShaderDefines LightManager::getLightBufferDefines() const
+{
+    if (lightBufferTarget != GL_UNIFORM_BUFFER) {
+        return {};
     }
-    else {
-        glm::vec3 zero = glm::vec3(0.0f);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "dirLight.direction"), 1, &zero[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "dirLight.color"), 1, &zero[0]);
+    return { "LIGHT_UBO", "MAX_POINT_LIGHTS=" + std::to_string(maxBufferLights) };
+}
+
+void LightManager::bindLightBuffer()
+{
+    glBindBuffer(lightBufferTarget, lightBuffer);
+
+    // Storage buffers grow to fit, which loses the contents
+    const size_t count = pointLightsOn ? std::min(pointLights.size(), maxBufferLights) : 0;
+    if (count > lightBufferCapacity) {
+        lightBufferCapacity = std::max(count, lightBufferCapacity * 2);
+        glBufferData(lightBufferTarget, sizeof(GpuLightHeader) + lightBufferCapacity * sizeof(GpuPointLight), nullptr, GL_DYNAMIC_DRAW);
+        headerUploaded = false;
+        uploadedLights.clear();
     }
 
-    // Pass spotlight
+    // Lights that are off go to the shader zeroed
+    GpuLightHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.counts[0] = static_cast<GLint>(count);
+    if (directionalLightOn) {
+        header.dirLightDirection = glm::vec4(directionalLight.direction, 0.0f);
+        header.dirLightColor = glm::vec4(directionalLight.color, 0.0f);
+    }
     if (spotLightOn) {
-        spotLight.position = camPos;
-        spotLight.direction = camDir;
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.position"), 1, &spotLight.position[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.direction"), 1, &spotLight.direction[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.color"), 1, &spotLight.color[0]);
-        glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.cutOff"), spotLight.cutOff);
-        glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.outerCutOff"), spotLight.outerCutOff);
+        header.spotLightPosition = glm::vec4(spotLight.position, spotLight.cutOff);
+        header.spotLightDirection = glm::vec4(spotLight.direction, spotLight.outerCutOff);
+        header.spotLightColor = glm::vec4(spotLight.color, 0.0f);
+    }
+    if (!headerUploaded || std::memcmp(&header, &uploadedHeader, sizeof(header)) != 0) {
+        glBufferSubData(lightBufferTarget, 0, sizeof(header), &header);
+        uploadedHeader = header;
+        headerUploaded = true;
+    }
+
+    // Point lights, one upload per run of changed lights
+    const size_t previous = uploadedLights.size();
+    uploadedLights.resize(count);
+    size_t runStart = 0;
+    bool inRun = false;
+    for (size_t i = 0; i <= count; ++i) {
+        bool changed = false;
+        if (i < count) {
+            GpuPointLight light;
+            light.positionLinear = glm::vec4(pointLights[i].position, pointLights[i].linear);
+            light.colorQuadratic = glm::vec4(pointLights[i].color, pointLights[i].quadratic);
+            changed = i >= previous || std::memcmp(&light, &uploadedLights[i], sizeof(light)) != 0;
+            if (changed) {
+                uploadedLights[i] = light;
+            }
+        }
+        if (changed && !inRun) {
+            runStart = i;
+            inRun = true;
+        } else if (!changed && inRun) {
+            glBufferSubData(lightBufferTarget, sizeof(GpuLightHeader) + runStart * sizeof(GpuPointLight),
+                (i - runStart) * sizeof(GpuPointLight), &uploadedLights[runStart]);
+            inRun = false;
+        }
+    }
+
+    glBindBufferBase(lightBufferTarget, LightBufferBinding, lightBuffer);
+}
+
+void LightManager::passLightData(const glm::vec3& camPos, const glm::vec3& camDir)
+{
+    spotLight.position = camPos;
+    spotLight.direction = camDir;
+    bindLightBuffer();
+}
+
+void LightManager::setStressLightCount(size_t count)
+{
+    pointLights.resize(sceneLightCount);
+    stressLights.clear();
+
+    // The same lights every run, over the 1000 x 1000 ground plane
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        StressLight stressLight;
+        stressLight.center = glm::vec3(unit(random) * 1000.0f - 500.0f, 5.0f + unit(random) * 30.0f, unit(random) * 1000.0f - 500.0f);
+        stressLight.radius = 5.0f + unit(random) * 20.0f;
+        stressLight.speed = 0.5f + unit(random) * 1.5f;
+        stressLight.phase = unit(random) * glm::two_pi<float>();
+        stressLights.push_back(stressLight);
+
+        // Reaches about 35 units (see getLightRange)
+        Light light;
+        light.position = stressLight.center;
+        light.color = glm::vec3(unit(random), unit(random), unit(random));
+        light.color /= std::max(light.color.r, std::max(light.color.g, light.color.b));
+        light.linear = 0.22f;
+        light.quadratic = 0.20f;
+        pointLights.push_back(light);
+    }
+    std::cout << "Stress lights: " << count << " (" << pointLights.size() << " point lights)" << std::endl;
+}
+
+void LightManager::animateStressLights(float time)
+{
+    for (size_t i = 0; i < stressLights.size(); ++i) {
+        const StressLight& stressLight = stressLights[i];
+        const float angle = stressLight.phase + stressLight.speed * time;
+        pointLights[sceneLightCount + i].position = stressLight.center + stressLight.radius * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+    }
+}
+
+float LightManager::getLightRange(const Light& light)
+{
+    const float brightness = std::max(light.color.r, std::max(light.color.g, light.color.b));
+    const float c = 1.0f - 256.0f * brightness;
+    if (c >= 0.0f) {
+        return 0.0f;
     }
-    else {
-        glm::vec3 zero = glm::vec3(0.0f);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.position"), 1, &zero[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.direction"), 1, &zero[0]);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "spotLight.color"), 1, &zero[0]);
-        glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.cutOff"), 0.0f);
-        glUniform1f(glGetUniformLocation(shaderProgram, "spotLight.outerCutOff"), 0.0f);
+    if (light.quadratic > 0.0f) {
+        return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
     }
+    return light.linear > 0.0f ? -c / light.linear : 1e30f;
 }
 
 const LightManager::DirectionalLight& LightManager::getDirectionalLight() const {
@@ -153,7 +273,7 @@ const LightManager::SpotLight& LightManager::getSpotLight() const {
     return spotLight;
 }
 
-std::vector<LightManager::Light> LightManager::getPointLights() const {
+const std::vector<LightManager::Light>& LightManager::getPointLights() const {
     return pointLights;
 }
 
@@ -6,6 +6,7 @@
 #include "Dependencies/glm/gtc/matrix_transform.hpp"
 #include <string>
 #include <vector>
+#include "ShaderLoader.h"
 
 class LightManager {
 public:
@@ -29,18 +30,43 @@ public:
         float outerCutOff;
     };
 
+    // Binding point of the light buffer; matches the lighting shaders. Binding 0 holds
+    // the particle storage buffer.
+    static const GLuint LightBufferBinding = 1;
+
     LightManager();
 
     void initialize();
-    void passLightData(GLuint shaderProgram, const glm::vec3& camPos, const glm::vec3& camDir);
+    // Points the spotlight along the camera, then binds the light buffer (bindLightBuffer)
+    void passLightData(const glm::vec3& camPos, const glm::vec3& camDir);
+
+    // Uploads the lights that changed since the last call and binds the light buffer
+    // to LightBufferBinding. Lights that are off are stored zeroed, or left out.
+    void bindLightBuffer();
+
+    // Defines the lighting shaders need for this light buffer: LIGHT_UBO and its
+    // MAX_POINT_LIGHTS when fragment shaders have no storage buffers. After initialize.
+    ShaderDefines getLightBufferDefines() const;
+
+    // Point lights the light buffer held after the last bindLightBuffer
+    size_t getBufferedLightCount() const { return uploadedLights.size(); }
+
     void passLightDataToShader(GLuint shaderProgram, const Light& light, const std::string& lightPosName, const std::string& lightColorName);
     void passDirectionalLightData(GLuint shaderProgram, const DirectionalLight& dirLight, const std::string& lightDirName, const std::string& lightColorName);
     void passSpotLightData(GLuint shaderProgram, const SpotLight& spotLight, const std::string& lightPosName, const std::string& lightDirName, const std::string& lightColorName, const std::string& cutOffName, const std::string& outerCutOffName);
-    void renderLightSpheres(const glm::mat4& viewProjectionMatrix);
-    void renderLightCubes(const glm::mat4& viewProjectionMatrix);
+
+    // Distance at which the light's attenuation takes its brightest channel below 1/256,
+    // from the linear and quadratic terms; the bound for culling and light volumes
+    static float getLightRange(const Light& light);
 
     // Getter for point lights
-    std::vector<Light> getPointLights() const;
+    const std::vector<Light>& getPointLights() const;
+
+    // Stress test: count extra short-range lights scattered over the ground plane, each
+    // circling its own centre once animateStressLights runs. Zero removes them again.
+    void setStressLightCount(size_t count);
+    size_t getStressLightCount() const { return stressLights.size(); }
+    void animateStressLights(float time);
 
     // Getter for directional light
     const DirectionalLight& getDirectionalLight() const;
@@ -57,9 +83,45 @@ public:
     std::vector<LightManager::Light> getLights() const;
 
 private:
+    struct StressLight {
+        glm::vec3 center;
+        float radius;
+        float speed;  // Radians per second
+        float phase;
+    };
+
     std::vector<Light> pointLights;
+    size_t sceneLightCount;               // The lights before the stress lights
+    std::vector<StressLight> stressLights;
+
+    // Light buffer contents, laid out alike by std430 and std140 (vec4s only)
+    struct GpuLightHeader {
+        GLint counts[4]; // Point lights, then padding
+        glm::vec4 dirLightDirection;
+        glm::vec4 dirLightColor;
+        glm::vec4 spotLightPosition;  // w: cutOff
+        glm::vec4 spotLightDirection; // w: outerCutOff
+        glm::vec4 spotLightColor;
+    };
+    struct GpuPointLight {
+        glm::vec4 positionLinear;
+        glm::vec4 colorQuadratic;
+    };
+
+    void initLightBuffer();
 
     GLuint lightShaderProgram;
+
+    // Storage buffer that grows with the lights, or a uniform buffer of maxBufferLights.
+    // The uploaded copies mirror what the buffer holds, so unchanged lights are skipped.
+    GLuint lightBuffer;
+    GLenum lightBufferTarget;
+    size_t lightBufferCapacity;
+    size_t maxBufferLights;
+    bool headerUploaded;
+    GpuLightHeader uploadedHeader;
+    std::vector<GpuPointLight> uploadedLights;
+
     GLuint lightVAO, lightVBO;
     unsigned int lightSphereVertexCount;
 
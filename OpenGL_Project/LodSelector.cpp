@@ -0,0 +1,107 @@
+#include "LodSelector.h"
+#include "MeshRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const float LodSelector::FirstLodScreenSize = 0.5f;
+const float LodSelector::Hysteresis = 0.15f;
+bool LodSelector::enabled = true;
+size_t LodSelector::frameTriangles = 0;
+size_t LodSelector::frameFullDetailTriangles = 0;
+
+namespace {
+    // Screen size below which level 'level' (>= 1) is drawn
+    float levelThreshold(int level) {
+        return LodSelector::FirstLodScreenSize / static_cast<float>(1 << (level - 1));
+    }
+
+    // Averages over the report interval so the readout doesn't jitter with the frame
+    double reportStart = -1.0;
+    size_t reportFrames = 0;
+    size_t reportTriangles = 0;
+    size_t reportFullDetailTriangles = 0;
+
+    // Last printed readout, so a static view doesn't repeat itself every second
+    size_t lastDrawn = 0;
+    size_t lastFullDetail = 0;
+    bool lastEnabled = true;
+}
+
+float LodSelector::screenSize(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+    return screenSize(mesh.getBoundingSphere().transformed(model), view, projection);
+}
+
+float LodSelector::screenSize(const BoundingSphere& sphere, const glm::mat4& view, const glm::mat4& projection) {
+    const float distance = glm::length(glm::vec3(view * glm::vec4(sphere.center, 1.0f)));
+    if (distance <= sphere.radius) {
+        return 1.0f;
+    }
+
+    // projection[1][1] = cot(fovY / 2): a radius r at distance d spans r * cot / d of the half-height
+    return sphere.radius * projection[1][1] / distance;
+}
+
+int LodSelector::select(float screenSize, int currentLevel, int levelCount) {
+    if (!enabled || levelCount <= 1) {
+        return 0;
+    }
+
+    // Move at most as far as the thresholds widened by the hysteresis band allow
+    int level = std::min(std::max(currentLevel, 0), levelCount - 1);
+    while (level + 1 < levelCount && screenSize < levelThreshold(level + 1) * (1.0f - Hysteresis)) {
+        ++level;
+    }
+    while (level > 0 && screenSize > levelThreshold(level) * (1.0f + Hysteresis)) {
+        --level;
+    }
+    return level;
+}
+
+int LodSelector::select(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int currentLevel) {
+    if (!enabled || mesh.getLodCount() <= 1) {
+        return 0;
+    }
+    return select(screenSize(mesh, model, view, projection), currentLevel, mesh.getLodCount());
+}
+
+void LodSelector::recordDraw(size_t trianglesDrawn, size_t fullDetailTriangles) {
+    frameTriangles += trianglesDrawn;
+    frameFullDetailTriangles += fullDetailTriangles;
+}
+
+void LodSelector::endFrame(double time) {
+    if (reportStart < 0.0) {
+        reportStart = time;
+    }
+
+    reportFrames++;
+    reportTriangles += frameTriangles;
+    reportFullDetailTriangles += frameFullDetailTriangles;
+    frameTriangles = 0;
+    frameFullDetailTriangles = 0;
+
+    if (time - reportStart < 1.0) {
+        return;
+    }
+
+    const size_t drawn = reportTriangles / reportFrames;
+    const size_t fullDetail = reportFullDetailTriangles / reportFrames;
+    reportStart = time;
+    reportFrames = 0;
+    reportTriangles = 0;
+    reportFullDetailTriangles = 0;
+
+    if (drawn == lastDrawn && fullDetail == lastFullDetail && enabled == lastEnabled) {
+        return;
+    }
+    lastDrawn = drawn;
+    lastFullDetail = fullDetail;
+    lastEnabled = enabled;
+
+    std::cout << "Mesh triangles/frame: " << drawn << " (LOD " << (enabled ? "on" : "off") << ", full detail " << fullDetail;
+    if (fullDetail > 0) {
+        std::cout << ", " << static_cast<int>(100.0 - 100.0 * static_cast<double>(drawn) / static_cast<double>(fullDetail) + 0.5) << "% saved";
+    }
+    std::cout << ")" << std::endl;
+}
@@ -0,0 +1,44 @@
+#ifndef LODSELECTOR_H
+#define LODSELECTOR_H
+
+#include <cstddef>
+#include "Dependencies/glm/glm.hpp"
+#include "BoundingVolume.h"
+
+class Mesh;
+
+// Runtime choice of a mesh's discrete LOD from its projected screen size, plus
+// the per-frame triangle counters that show what LOD saves.
+// Level n is drawn while the bounding sphere covers less than FirstLodScreenSize / 2^(n-1)
+// of the viewport height; MeshSimplifier doubles the error budget per level to match,
+// so the on-screen error stays about the same at every switch.
+class LodSelector {
+public:
+    static const float FirstLodScreenSize;
+
+    // Fraction of a threshold a mesh must cross beyond it before the level changes again
+    static const float Hysteresis;
+
+    // Global switch; with LOD off every mesh draws level 0
+    static bool enabled;
+
+    // Bounding sphere diameter as a fraction of the viewport height (1 or more when the camera is inside it)
+    static float screenSize(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
+    static float screenSize(const BoundingSphere& worldSphere, const glm::mat4& view, const glm::mat4& projection);
+
+    // Level to draw this frame, given the level drawn last frame
+    static int select(float screenSize, int currentLevel, int levelCount);
+    static int select(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int currentLevel);
+
+    // Called by every mesh draw: triangles actually drawn and what full detail would have cost
+    static void recordDraw(size_t trianglesDrawn, size_t fullDetailTriangles);
+
+    // Closes the frame's counters; about once a second prints the average triangles per frame if it changed
+    static void endFrame(double time);
+
+private:
+    static size_t frameTriangles;
+    static size_t frameFullDetailTriangles;
+};
+
+#endif
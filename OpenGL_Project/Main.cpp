@@ -23,6 +23,14 @@
 #include "Plane.h"
 #include "ParticleSystem.h"
 #include "LODScene.h"
+#include "ObjParser.h"
+#include "LodSelector.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "TextureCooker.h"
+#include "ProgramBinaryCache.h"
+#include "ProgramCompiler.h"
+#include "SpirvCache.h"
 
 // Screen dimensions
 const unsigned int WIDTH = 1920;
@@ -48,7 +56,7 @@ bool tabKeyPressed = false;
 
 // Function declarations
 GLFWwindow* initWindow();
-void processInput(GLFWwindow* window, Camera& camera, InputHandler& inputHandler, LightManager& lightManager, float deltaTime, ShadowScene& shadowScene, Scene currentScene);
+void processInput(GLFWwindow* window, Camera& camera, InputHandler& inputHandler, LightManager& lightManager, float deltaTime, ShadowScene& shadowScene, DeferredScene& deferredScene, Scene currentScene);
 void processSceneInput(GLFWwindow* window, Scene& currentScene);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
@@ -118,8 +126,38 @@ void initFramebuffers() {
 // Global ParticleSystem pointer
 ParticleSystem* particleSystem = nullptr;
 
-int main()
+int main(int argc, char** argv)
 {
+    // Offline tool modes run without creating a window
+    bool cookTextures = false;
+    bool preferBC7 = false;
+    size_t textureBudgetMegabytes = TextureCache::DefaultStreamingBudget / (1024 * 1024);
+    size_t stressLightCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--validate-obj") {
+            return ObjParser::runSelfTest("Resources/Models") ? 0 : 1;
+        }
+        if (std::string(argv[i]) == "--compile-spirv") {
+            return SpirvCache::runCompileTool({ "Resources/Shaders", "." }) ? 0 : 1;
+        }
+        cookTextures = cookTextures || std::string(argv[i]) == "--cook-textures";
+        preferBC7 = preferBC7 || std::string(argv[i]) == "--bc7";
+        if (std::string(argv[i]) == "--texture-budget-mb" && i + 1 < argc) {
+            textureBudgetMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        }
+        if (std::string(argv[i]) == "--light-stress" && i + 1 < argc) {
+            stressLightCount = std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+    if (cookTextures) {
+        // Every image in the orientation its loaders ask for; LODScene flips its own
+        std::vector<TextureCooker::CookSource> cookSources = { { "Resources/Textures", false }, { "Resources/Skybox", false } };
+        for (const std::string& path : LODScene::getTexturePaths()) {
+            cookSources.push_back({ path, LODScene::FlipTextures });
+        }
+        return TextureCooker::runCookTool(cookSources, preferBC7) ? 0 : 1;
+    }
+
     // Seed random number generator
     std::srand(static_cast<unsigned int>(std::time(0)));
 
@@ -144,6 +182,10 @@ int main()
     // Set viewport
     glViewport(0, 0, WIDTH, HEIGHT);
 
+    // Streamed textures pick mip levels from on-screen sizes within the VRAM budget
+    TextureCache::instance().setViewportHeight(HEIGHT);
+    TextureCache::instance().setStreamingBudget(textureBudgetMegabytes * 1024 * 1024);
+
     // Initialize ShaderLoader
     ShaderLoader shaderLoader;
 
@@ -160,22 +202,25 @@ int main()
     // Initialize LightManager
     LightManager lightManager;
     lightManager.initialize();
+    if (stressLightCount > 0) {
+        lightManager.setStressLightCount(stressLightCount);
+    }
 
     // Initialize ParticleSystem
     particleSystem = new ParticleSystem("particle_compute.txt", "particle_vertex.txt", "particle_fragment.txt");
     particleSystem->init();
 
-    // Load Models
+    // Load Models (parsed in the background, placeholders until then)
     ModelLoader mineModelLoader("Resources/Models/SciFiSpace/SM_Prop_Mine_01.obj");
-    mineModelLoader.loadModel();
+    mineModelLoader.loadModelAsync();
 
     ModelLoader alienModelLoader("Resources/Models/SciFiWorlds/SM_Env_Artifact_AlienRuin_03.obj");
-    alienModelLoader.loadModel();
+    alienModelLoader.loadModelAsync();
 
     ModelLoader cannonModelLoader("Resources/Models/SciFiWorlds/SM_Bld_Planetary_Cannon_01.obj");
-    cannonModelLoader.loadModel();
+    cannonModelLoader.loadModelAsync();
 
-    // Initialize Instanced Renderers for models
+    // Initialize Instanced Renderers for models (meshes are shared with the loaders above)
     InstancedRenderer mineRenderer(
         "Resources/Models/SciFiSpace/SM_Prop_Mine_01.obj",
         "Resources/Textures/PolygonSciFiSpace_Texture_01_A.png",
@@ -186,18 +231,14 @@ int main()
     // Uncomment and properly initialize other renderers if needed
     /*
     InstancedRenderer alienRenderer(
-        alienModelLoader.getPositions(),
-        alienModelLoader.getTexCoords(),
-        alienModelLoader.getNormals(),
+        "Resources/Models/SciFiWorlds/SM_Env_Artifact_AlienRuin_03.obj",
         "Resources/Textures/PolygonSciFiSpace_Texture_01_A.png",
         10
     );
     alienRenderer.initialize();
 
     InstancedRenderer canonRenderer(
-        cannonModelLoader.getPositions(),
-        cannonModelLoader.getTexCoords(),
-        cannonModelLoader.getNormals(),
+        "Resources/Models/SciFiWorlds/SM_Bld_Planetary_Cannon_01.obj",
         "Resources/Textures/PolygonSciFiSpace_Texture_01_A.png",
         10
     );
@@ -227,7 +268,7 @@ int main()
 
     // Initialize Deferred Rendering Scene
     DeferredScene deferredRenderingScene(WIDTH, HEIGHT); // Corrected constructor
-    deferredRenderingScene.init(shaderLoader); // Initialize with ShaderLoader
+    deferredRenderingScene.init(shaderLoader, lightManager); // Initialize with ShaderLoader
 
     // Initialize Quad VAO for screen-space rendering
     initQuadVAO();
@@ -246,6 +287,9 @@ int main()
     LODScene lodScene(shaderLoader, cam);
     lodScene.initialize();  // Initialize LOD Scene
 
+    // Every program is loaded or compiling by now
+    ProgramBinaryCache::instance().printStats();
+
     viewMatrix = cam.GetViewMatrix();
 
     // Set input callbacks
@@ -253,17 +297,32 @@ int main()
     glfwSetScrollCallback(window, scrollCallback);
 
     // Main rendering loop
+    bool firstFrame = true;
     while (!glfwWindowShouldClose(window)) {
         // Calculate delta time
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        if (firstFrame) {
+            std::cout << "First frame after " << currentFrame * 1000.0f << " ms (" << AssetLoader::instance().getPendingCount()
+                << " assets still loading)" << std::endl;
+            firstFrame = false;
+        }
+
+        // Report programs the driver has finished compiling (binding one waits for it anyway)
+        ProgramCompiler::instance().poll();
+
+        // Upload assets the loader threads have finished, within the frame's budget
+        if (AssetLoader::instance().processUploads() > 0 && AssetLoader::instance().getPendingCount() == 0) {
+            TextureCache::instance().printStats();
+        }
+
         // Handle scene switching input
         processSceneInput(window, currentScene);  // Handle scene switching input
 
         // Process general input
-        processInput(window, cam, inputHandler, lightManager, deltaTime, shadowScene, currentScene);  // Pass ShadowScene and currentScene
+        processInput(window, cam, inputHandler, lightManager, deltaTime, shadowScene, deferredRenderingScene, currentScene);  // Pass ShadowScene and currentScene
 
         // Update camera
         cam.update(deltaTime);
@@ -293,15 +352,11 @@ int main()
             deferredRenderingScene.geometryPass({ &mineModelLoader, &alienModelLoader, &cannonModelLoader }, cam.GetViewMatrix(), cam.GetProjectionMatrix());
 
             // 2. Lighting Pass
-            deferredRenderingScene.lightingPass(
-                lightManager.getPointLights(),
-                lightManager.getDirectionalLight(),
-                lightManager.getSpotLight(),
-                cam.getPosition()
-            );
+            lightManager.animateStressLights(currentFrame);
+            deferredRenderingScene.lightingPass(lightManager, cam.GetViewMatrix(), cam.GetProjectionMatrix(), cam.getPosition());
 
             // 3. Render Light Boxes
-            deferredRenderingScene.renderLights(lightManager.getPointLights(), cam.GetViewMatrix(), cam.GetProjectionMatrix());
+            deferredRenderingScene.renderLights(lightManager, cam.GetViewMatrix(), cam.GetProjectionMatrix());
 
             break;
         case SCENE_COMPUTE_SHADER:
@@ -335,6 +390,12 @@ int main()
             break;
         }
 
+        // Report mesh triangles drawn this frame
+        LodSelector::endFrame(currentFrame);
+
+        // Stream texture mips for what was drawn
+        TextureCache::instance().updateStreaming(currentFrame);
+
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -419,7 +480,7 @@ void processSceneInput(GLFWwindow* window, Scene& currentScene) {
 
 
 // Function to handle general input
-void processInput(GLFWwindow* window, Camera& camera, InputHandler& inputHandler, LightManager& lightManager, float deltaTime, ShadowScene& shadowScene, Scene currentScene) {
+void processInput(GLFWwindow* window, Camera& camera, InputHandler& inputHandler, LightManager& lightManager, float deltaTime, ShadowScene& shadowScene, DeferredScene& deferredScene, Scene currentScene) {
     // Close window on pressing ESC
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
@@ -468,6 +529,81 @@ void processInput(GLFWwindow* window, Camera& camera, InputHandler& inputHandler
         spotLightTogglePressed = false;
     }
 
+    // Cycle the stress test lights with key '8'
+    static bool stressLightsPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_8) == GLFW_PRESS) {
+        if (!stressLightsPressed) {
+            const size_t stressLightCounts[] = { 0, 1000, 4000, 10000 };
+            const size_t stressLightSteps = sizeof(stressLightCounts) / sizeof(stressLightCounts[0]);
+            size_t next = 0;
+            while (next < stressLightSteps && stressLightCounts[next] <= lightManager.getStressLightCount()) {
+                ++next;
+            }
+            lightManager.setStressLightCount(stressLightCounts[next % stressLightSteps]);
+            stressLightsPressed = true;
+        }
+    }
+    else {
+        stressLightsPressed = false;
+    }
+
+    // Cycle the deferred lighting mode (per-pixel, clustered, light volumes) with key 'C',
+    // skipping unavailable ones; check the cluster light lists against the CPU with 'V'
+    static bool lightingModePressed = false;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+        if (!lightingModePressed) {
+            static const char* modeNames[] = { "Per-Pixel", "Clustered", "Light Volumes" };
+            int mode = static_cast<int>(deferredScene.getLightingMode());
+            do {
+                mode = (mode + 1) % 3;
+            } while (!deferredScene.isLightingModeAvailable(static_cast<DeferredScene::LightingMode>(mode)));
+            deferredScene.setLightingMode(static_cast<DeferredScene::LightingMode>(mode));
+            lightingModePressed = true;
+            std::cout << "Deferred Lighting " << modeNames[mode] << std::endl;
+        }
+    }
+    else {
+        lightingModePressed = false;
+    }
+
+    // Switch between the wide and thin G-buffer with key 'G'; both switches print the pass timings
+    static bool gBufferTogglePressed = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!gBufferTogglePressed) {
+            const bool thin = deferredScene.getGBufferLayout() == DeferredScene::GBufferLayout::Thin;
+            deferredScene.setGBufferLayout(thin ? DeferredScene::GBufferLayout::Wide : DeferredScene::GBufferLayout::Thin);
+            gBufferTogglePressed = true;
+            std::cout << "G-buffer " << (thin ? "Wide" : "Thin") << std::endl;
+        }
+    }
+    else {
+        gBufferTogglePressed = false;
+    }
+
+    static bool clusterValidatePressed = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!clusterValidatePressed && currentScene == SCENE_DEFERRED_RENDERING && deferredScene.getLightingMode() == DeferredScene::LightingMode::Clustered) {
+            deferredScene.validateLightClusters(lightManager);
+        }
+        clusterValidatePressed = true;
+    }
+    else {
+        clusterValidatePressed = false;
+    }
+
+    // Toggle mesh LOD selection with key 'L' (compare the triangle readout)
+    static bool lodTogglePressed = false;
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+        if (!lodTogglePressed) {
+            LodSelector::enabled = !LodSelector::enabled;
+            lodTogglePressed = true;
+            std::cout << "Mesh LOD " << (LodSelector::enabled ? "On" : "Off") << std::endl;
+        }
+    }
+    else {
+        lodTogglePressed = false;
+    }
+
     // Smooth Movement Logic for Movable Model (Only in Shadow Scene)
     if (currentScene == SCENE_SHADOW) {
         ModelLoader& movableModel = shadowScene.getMovableModel();
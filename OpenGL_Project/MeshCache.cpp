@@ -0,0 +1,159 @@
+#include "MeshCache.h"
+#include "HashUtils.h"
+#include "FileUtils.h"
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const char* CacheDirectory = "Resources/Cache";
+    const size_t VertexStride = sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2);
+}
+
+MeshCache::MeshCache(const std::string& sourcePath)
+    : sourcePath(sourcePath), sourceStamped(false), sourceModifiedTime(0), sourceSize(0), sourceHash(0),
+    vertexData(nullptr), indexData(nullptr), vertexCount(0), indexCount(0)
+{
+    std::ostringstream name;
+    name << CacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << hashString(sourcePath) << ".mesh";
+    cachePath = name.str();
+}
+
+size_t MeshCache::getVertexDataSize() const {
+    return static_cast<size_t>(vertexCount) * VertexStride;
+}
+
+size_t MeshCache::alignedPathSize(uint32_t pathLength) {
+    return (static_cast<size_t>(pathLength) + 3) & ~static_cast<size_t>(3);
+}
+
+bool MeshCache::stampSource() {
+    if (sourceStamped) {
+        return true;
+    }
+
+    if (!getFileStat(sourcePath, sourceModifiedTime, sourceSize)) {
+        return false;
+    }
+
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        return false;
+    }
+    sourceHash = hashBytes(source.data(), source.size());
+    sourceStamped = true;
+    return true;
+}
+
+bool MeshCache::load() {
+    if (!mapping.open(cachePath)) {
+        return false;
+    }
+
+    Header header;
+    if (mapping.size() < sizeof(Header)) {
+        mapping.close();
+        return false;
+    }
+    std::memcpy(&header, mapping.data(), sizeof(Header));
+
+    if (std::memcmp(header.magic, "MSHC", 4) != 0 || header.version != Version) {
+        mapping.close();
+        return false;
+    }
+
+    const size_t pathOffset = sizeof(Header);
+    const size_t vertexOffset = pathOffset + alignedPathSize(header.pathLength);
+    const size_t indexOffset = vertexOffset + static_cast<size_t>(header.vertexCount) * VertexStride;
+    const size_t lodTableOffset = indexOffset + static_cast<size_t>(header.indexCount) * sizeof(unsigned int);
+    const size_t lodIndexOffset = lodTableOffset + static_cast<size_t>(header.lodCount) * sizeof(LodRecord);
+    if (mapping.size() < lodIndexOffset) {
+        mapping.close();
+        return false;
+    }
+
+    std::vector<LodRecord> lodRecords(header.lodCount);
+    if (header.lodCount > 0) {
+        std::memcpy(lodRecords.data(), mapping.data() + lodTableOffset, lodRecords.size() * sizeof(LodRecord));
+    }
+    size_t totalSize = lodIndexOffset;
+    for (const LodRecord& record : lodRecords) {
+        totalSize += static_cast<size_t>(record.indexCount) * sizeof(unsigned int);
+    }
+
+    if (mapping.size() != totalSize ||
+        header.pathLength != sourcePath.size() ||
+        std::memcmp(mapping.data() + pathOffset, sourcePath.data(), sourcePath.size()) != 0) {
+        mapping.close();
+        return false;
+    }
+
+    // Only hash the source when the cheap checks already pass
+    uint64_t modifiedTime = 0, size = 0;
+    if (!getFileStat(sourcePath, modifiedTime, size) ||
+        modifiedTime != header.sourceModifiedTime || size != header.sourceSize ||
+        !stampSource() || sourceHash != header.sourceHash) {
+        std::cout << "Mesh cache stale for " << sourcePath << std::endl;
+        mapping.close();
+        return false;
+    }
+
+    vertexCount = header.vertexCount;
+    indexCount = header.indexCount;
+    vertexData = mapping.data() + vertexOffset;
+    indexData = reinterpret_cast<const unsigned int*>(mapping.data() + indexOffset);
+
+    lods.clear();
+    const unsigned int* lodIndices = reinterpret_cast<const unsigned int*>(mapping.data() + lodIndexOffset);
+    for (const LodRecord& record : lodRecords) {
+        LodView view = { lodIndices, record.indexCount, record.error };
+        lods.push_back(view);
+        lodIndices += record.indexCount;
+    }
+    return true;
+}
+
+bool MeshCache::save(const MeshData& data) {
+    if (!stampSource()) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, "MSHC", 4);
+    header.version = Version;
+    header.sourceModifiedTime = sourceModifiedTime;
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.pathLength = static_cast<uint32_t>(sourcePath.size());
+    header.vertexCount = static_cast<uint32_t>(data.positions.size());
+    header.indexCount = static_cast<uint32_t>(data.indices.size());
+    header.lodCount = static_cast<uint32_t>(data.lods.size());
+
+    makeDirectory(CacheDirectory);
+
+    const char padding[4] = { 0, 0, 0, 0 };
+    std::ostringstream buffer(std::ios::out | std::ios::binary);
+    buffer.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    buffer.write(sourcePath.data(), sourcePath.size());
+    buffer.write(padding, alignedPathSize(header.pathLength) - sourcePath.size());
+    buffer.write(reinterpret_cast<const char*>(data.positions.data()), data.positions.size() * sizeof(glm::vec3));
+    buffer.write(reinterpret_cast<const char*>(data.normals.data()), data.normals.size() * sizeof(glm::vec3));
+    buffer.write(reinterpret_cast<const char*>(data.texCoords.data()), data.texCoords.size() * sizeof(glm::vec2));
+    buffer.write(reinterpret_cast<const char*>(data.indices.data()), data.indices.size() * sizeof(unsigned int));
+    for (const MeshLod& lod : data.lods) {
+        LodRecord record = { static_cast<uint32_t>(lod.indices.size()), lod.error };
+        buffer.write(reinterpret_cast<const char*>(&record), sizeof(LodRecord));
+    }
+    for (const MeshLod& lod : data.lods) {
+        buffer.write(reinterpret_cast<const char*>(lod.indices.data()), lod.indices.size() * sizeof(unsigned int));
+    }
+
+    // Release the old entry's mapping so it can be replaced
+    mapping.close();
+    if (!writeFileAtomically(cachePath, buffer.str())) {
+        std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+#include "MappedFile.h"
+#include "MeshData.h"
+
+// Versioned binary cache of welded mesh data, stored under Resources/Cache.
+// An entry is valid only while the source path, modification time, size and
+// content hash all match; the vertex blob holds positions, then normals, then
+// texcoords so it can be packed straight from the mapping. The full-detail
+// indices are followed by a table and the indices of each simplified LOD.
+class MeshCache {
+public:
+    static const uint32_t Version = 3;
+
+    explicit MeshCache(const std::string& sourcePath);
+
+    // Maps the cache entry and validates it against the source file
+    bool load();
+
+    // Writes a fresh entry for the source file
+    bool save(const MeshData& data);
+
+    // Views into the mapping, valid after a successful load() while this object lives
+    const void* getVertexData() const { return vertexData; }
+    size_t getVertexDataSize() const;
+    uint32_t getVertexCount() const { return vertexCount; }
+    const unsigned int* getIndexData() const { return indexData; }
+    uint32_t getIndexCount() const { return indexCount; }
+    size_t getLodCount() const { return lods.size(); }
+    const unsigned int* getLodIndexData(size_t lod) const { return lods[lod].indices; }
+    uint32_t getLodIndexCount(size_t lod) const { return lods[lod].indexCount; }
+    float getLodError(size_t lod) const { return lods[lod].error; }
+
+    const std::string& getCachePath() const { return cachePath; }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceModifiedTime;
+        uint64_t sourceSize;
+        uint64_t sourceHash;
+        uint32_t pathLength;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+    };
+
+    struct LodRecord {
+        uint32_t indexCount;
+        float error;
+    };
+
+    struct LodView {
+        const unsigned int* indices;
+        uint32_t indexCount;
+        float error;
+    };
+
+    std::string sourcePath;
+    std::string cachePath;
+
+    // Identity of the source file, gathered once per MeshCache
+    bool sourceStamped;
+    uint64_t sourceModifiedTime;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+
+    MappedFile mapping;
+    const void* vertexData;
+    const unsigned int* indexData;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    std::vector<LodView> lods;
+
+    bool stampSource();
+    static size_t alignedPathSize(uint32_t pathLength);
+};
+
+#endif
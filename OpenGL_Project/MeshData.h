@@ -0,0 +1,33 @@
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+
+// Simplified triangle list over the same vertices as the full-detail mesh
+struct MeshLod {
+    std::vector<unsigned int> indices;
+    float error; // Geometric deviation relative to the mesh extent
+};
+
+// CPU-side indexed triangle mesh in the layout ModelLoader uploads
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods; // Coarser levels after the full-detail indices, finest first
+
+    size_t getVertexCount() const { return positions.size(); }
+    size_t getTriangleCount() const { return indices.size() / 3; }
+
+    void clear() {
+        std::vector<glm::vec3>().swap(positions);
+        std::vector<glm::vec3>().swap(normals);
+        std::vector<glm::vec2>().swap(texCoords);
+        std::vector<unsigned int>().swap(indices);
+        std::vector<MeshLod>().swap(lods);
+    }
+};
+
+#endif
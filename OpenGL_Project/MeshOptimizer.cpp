@@ -0,0 +1,319 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // FIFO post-transform cache modelled with timestamps: a vertex is resident while
+    // fewer than CacheSize misses happened since it was last loaded
+    struct FifoCache {
+        std::vector<unsigned int> loadTime;
+        unsigned int time;
+
+        explicit FifoCache(size_t vertexCount)
+            : loadTime(vertexCount, 0), time(MeshOptimizer::CacheSize + 1) {}
+
+        void reset() {
+            time += MeshOptimizer::CacheSize + 1;
+        }
+
+        // Returns true on a miss
+        bool access(unsigned int vertex) {
+            if (time - loadTime[vertex] > MeshOptimizer::CacheSize) {
+                loadTime[vertex] = time++;
+                return true;
+            }
+            return false;
+        }
+
+        unsigned int accessTriangle(const unsigned int* triangle) {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+    };
+
+    // Vertex -> triangles adjacency in compressed row form
+    struct Adjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+        std::vector<unsigned int> counts;
+
+        Adjacency(const std::vector<unsigned int>& indices, size_t vertexCount)
+            : offsets(vertexCount + 1, 0), triangles(indices.size()), counts(vertexCount, 0)
+        {
+            for (unsigned int index : indices) {
+                counts[index]++;
+            }
+            for (size_t v = 0; v < vertexCount; ++v) {
+                offsets[v + 1] = offsets[v] + counts[v];
+            }
+
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+    };
+
+    // Tipsify's choice of the next fanning vertex: the most recently cached candidate
+    // that will still be resident after its remaining triangles are emitted
+    int nextFanningVertex(const std::vector<unsigned int>& candidates, const std::vector<unsigned int>& liveCount,
+        const FifoCache& cache, std::vector<unsigned int>& deadEnds, size_t& cursor) {
+        int best = -1;
+        int bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (liveCount[v] == 0) {
+                continue;
+            }
+
+            int priority = 0;
+            const unsigned int age = cache.time - cache.loadTime[v];
+            if (age + 2 * liveCount[v] <= MeshOptimizer::CacheSize) {
+                priority = static_cast<int>(age);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = static_cast<int>(v);
+            }
+        }
+
+        if (best >= 0) {
+            return best;
+        }
+
+        // Dead end: back up through recently emitted vertices, then scan forward
+        while (!deadEnds.empty()) {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveCount[v] > 0) {
+                return static_cast<int>(v);
+            }
+        }
+        while (cursor < liveCount.size()) {
+            if (liveCount[cursor] > 0) {
+                return static_cast<int>(cursor++);
+            }
+            ++cursor;
+        }
+        return -1;
+    }
+
+    struct Cluster {
+        size_t begin;
+        size_t end;
+        float sortKey;
+    };
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount) {
+    CacheStats stats = { 0.0f, 0.0f };
+    if (indices.empty() || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount);
+    size_t misses = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        misses += cache.accessTriangle(&indices[i]);
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    Adjacency adjacency(indices, vertexCount);
+    std::vector<unsigned int> liveCount = adjacency.counts;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+
+    FifoCache cache(vertexCount);
+    size_t cursor = 0;
+    int fanning = nextFanningVertex(candidates, liveCount, cache, deadEnds, cursor);
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            const unsigned int triangle = adjacency.triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                cache.access(v);
+            }
+        }
+
+        fanning = nextFanningVertex(candidates, liveCount, cache, deadEnds, cursor);
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+    float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles whose three vertices all miss start a new cache "run"
+    std::vector<size_t> hardStarts(1, 0);
+    {
+        FifoCache cache(positions.size());
+        cache.accessTriangle(&indices[0]);
+        for (size_t t = 1; t < triangleCount; ++t) {
+            if (cache.accessTriangle(&indices[t * 3]) == 3) {
+                hardStarts.push_back(t);
+            }
+        }
+        hardStarts.push_back(triangleCount);
+    }
+
+    // Soft boundaries: split a run wherever the cache cost so far stays within threshold
+    std::vector<Cluster> clusters;
+    FifoCache cache(positions.size());
+    for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+        const size_t runBegin = hardStarts[h];
+        const size_t runEnd = hardStarts[h + 1];
+
+        cache.reset();
+        size_t runMisses = 0;
+        for (size_t t = runBegin; t < runEnd; ++t) {
+            runMisses += cache.accessTriangle(&indices[t * 3]);
+        }
+        const float targetAcmr = threshold * static_cast<float>(runMisses) / static_cast<float>(runEnd - runBegin);
+
+        cache.reset();
+        size_t clusterBegin = runBegin;
+        size_t clusterMisses = 0;
+        for (size_t t = runBegin; t < runEnd; ++t) {
+            clusterMisses += cache.accessTriangle(&indices[t * 3]);
+            const float acmr = static_cast<float>(clusterMisses) / static_cast<float>(t + 1 - clusterBegin);
+            if (acmr <= targetAcmr || t + 1 == runEnd) {
+                Cluster cluster = { clusterBegin, t + 1, 0.0f };
+                clusters.push_back(cluster);
+                clusterBegin = t + 1;
+                clusterMisses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    // Area-weighted mesh centroid
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+        const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+        const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+        const float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the centroid are likely occluders from any outside view
+    for (Cluster& cluster : clusters) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float clusterArea = 0.0f;
+        for (size_t t = cluster.begin; t < cluster.end; ++t) {
+            const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+            const glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(weightedNormal);
+            centroid += (p0 + p1 + p2) * (area / 3.0f);
+            normal += weightedNormal;
+            clusterArea += area;
+        }
+
+        const float normalLength = glm::length(normal);
+        if (clusterArea > 0.0f && normalLength > 0.0f) {
+            cluster.sortKey = glm::dot(centroid / clusterArea - meshCentroid, normal / normalLength);
+        }
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData& mesh) {
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(mesh.positions.size(), unused);
+    unsigned int nextVertex = 0;
+
+    for (unsigned int& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+
+    MeshData reordered;
+    reordered.positions.resize(nextVertex);
+    reordered.normals.resize(nextVertex);
+    reordered.texCoords.resize(nextVertex);
+    for (size_t v = 0; v < remap.size(); ++v) {
+        if (remap[v] != unused) {
+            reordered.positions[remap[v]] = mesh.positions[v];
+            reordered.normals[remap[v]] = mesh.normals[v];
+            reordered.texCoords[remap[v]] = mesh.texCoords[v];
+        }
+    }
+
+    mesh.positions.swap(reordered.positions);
+    mesh.normals.swap(reordered.normals);
+    mesh.texCoords.swap(reordered.texCoords);
+}
+
+void MeshOptimizer::optimize(MeshData& mesh, const std::string& name) {
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    const CacheStats before = analyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    optimizeVertexCache(mesh.indices, mesh.positions.size());
+    const CacheStats afterCache = analyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    optimizeOverdraw(mesh.indices, mesh.positions);
+    optimizeVertexFetch(mesh);
+    const CacheStats after = analyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    // Formatted locally and printed in one insertion, so pool threads can't interleave it
+    // or leave std::cout's formatting flags changed
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3)
+        << "Optimized mesh: " << name << " ACMR " << before.acmr << " -> " << after.acmr
+        << " (cache pass " << afterCache.acmr << "), ATVR " << before.atvr << " -> " << after.atvr << "\n";
+    std::cout << line.str();
+}
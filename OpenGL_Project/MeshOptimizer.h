@@ -0,0 +1,37 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+// Load-time reordering of welded meshes for the GPU: triangle order for the
+// post-transform vertex cache (Tipsify), then cluster order for overdraw, then
+// vertex order for fetch locality. Geometry is unchanged, only its order.
+class MeshOptimizer {
+public:
+    // FIFO size used for both optimization and reporting
+    static const unsigned int CacheSize = 16;
+
+    struct CacheStats {
+        float acmr; // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal)
+        float atvr; // Average transform to vertex ratio: transformed vertices per vertex (1.0 is ideal)
+    };
+
+    static CacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount);
+
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Sorts cache-friendly triangle clusters front-to-back as seen from outside the mesh.
+    // Clusters only split where their ACMR stays within threshold of the cache-optimized order.
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+        float threshold = 1.05f);
+
+    // Renumbers vertices in first-use order and drops unreferenced ones
+    static void optimizeVertexFetch(MeshData& mesh);
+
+    // Runs all passes and prints the ACMR/ATVR before and after
+    static void optimize(MeshData& mesh, const std::string& name);
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "MeshRegistry.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "LodSelector.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "AssetLoader.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <sstream>
+
+namespace {
+    bool parseModel(const std::string& modelPath, MeshData& data) {
+        ObjParser::Result obj;
+        if (!ObjParser::parse(modelPath, obj, ThreadPool::shared()) || !ObjParser::weld(obj, data)) {
+            std::cerr << "Failed to load model: " << modelPath << std::endl;
+            return false;
+        }
+
+        std::cout << "Parsed model: " << modelPath << " (" << obj.corners.size() << " vertices welded to "
+            << data.positions.size() << ", " << data.indices.size() / 3 << " triangles)" << std::endl;
+
+        // Reordered and simplified once here; the mesh cache stores the results
+        MeshOptimizer::optimize(data, modelPath);
+        MeshSimplifier::buildLods(data, modelPath);
+        return true;
+    }
+
+    void copyFromCache(const MeshCache& cache, MeshData& data) {
+        const uint32_t vertexCount = cache.getVertexCount();
+        const glm::vec3* cachedPositions = static_cast<const glm::vec3*>(cache.getVertexData());
+        const glm::vec3* cachedNormals = cachedPositions + vertexCount;
+        const glm::vec2* cachedTexCoords = reinterpret_cast<const glm::vec2*>(cachedNormals + vertexCount);
+
+        data.positions.assign(cachedPositions, cachedPositions + vertexCount);
+        data.normals.assign(cachedNormals, cachedNormals + vertexCount);
+        data.texCoords.assign(cachedTexCoords, cachedTexCoords + vertexCount);
+        data.indices.assign(cache.getIndexData(), cache.getIndexData() + cache.getIndexCount());
+
+        data.lods.resize(cache.getLodCount());
+        for (size_t i = 0; i < data.lods.size(); ++i) {
+            data.lods[i].indices.assign(cache.getLodIndexData(i), cache.getLodIndexData(i) + cache.getLodIndexCount(i));
+            data.lods[i].error = cache.getLodError(i);
+        }
+    }
+
+    // Flat-shaded cube from -0.5 to 0.5, one quad of four vertices per face
+    void buildCube(MeshData& data) {
+        const glm::vec3 normals[6] = {
+            glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+            glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+        };
+        const glm::vec2 corners[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+
+        for (const glm::vec3& normal : normals) {
+            // Cyclic swizzle of an axis is another axis; tangent x bitangent == normal keeps the
+            // quads counter-clockwise seen from outside
+            const glm::vec3 tangent(normal.z, normal.x, normal.y);
+            const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+            const unsigned int base = static_cast<unsigned int>(data.positions.size());
+            for (const glm::vec2& corner : corners) {
+                data.positions.push_back(normal * 0.5f + tangent * (corner.x - 0.5f) + bitangent * (corner.y - 0.5f));
+                data.normals.push_back(normal);
+                data.texCoords.push_back(corner);
+            }
+            const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for (unsigned int index : quad) {
+                data.indices.push_back(base + index);
+            }
+        }
+    }
+
+    void printLoaded(const std::string& modelPath, const std::string& source, double milliseconds, const Mesh& mesh) {
+        std::cout << "Loaded model: " << modelPath << " (" << source << ") in " << milliseconds << " ms, "
+            << MeshVertexLayout::Stride << " B/vertex, " << (mesh.getIndexType() == GL_UNSIGNED_SHORT ? 16 : 32)
+            << "-bit indices, " << mesh.getLodCount() << " LOD levels" << std::endl;
+    }
+}
+
+Mesh::Mesh(const std::string& key)
+    : key(key), VAO(0), VBO(0), EBO(0), indexType(GL_UNSIGNED_INT), vertexCount(0) {}
+
+Mesh::~Mesh() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void Mesh::upload(const VertexSource& source, const std::vector<IndexSpan>& levels) {
+    vertexCount = source.vertexCount;
+
+    // Interleave and compress the float streams
+    std::vector<unsigned char> vertices;
+    MeshVertexLayout::pack(source, vertices, bounds);
+
+    // Bounding box, and the sphere around its center that just holds every vertex
+    aabb = Aabb();
+    if (vertexCount > 0) {
+        aabb.min = aabb.max = source.positions[0];
+    }
+    for (size_t i = 1; i < vertexCount; ++i) {
+        aabb.min = glm::min(aabb.min, source.positions[i]);
+        aabb.max = glm::max(aabb.max, source.positions[i]);
+    }
+    boundingSphere.center = aabb.getCenter();
+    boundingSphere.radius = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        boundingSphere.radius = std::max(boundingSphere.radius, glm::length(source.positions[i] - boundingSphere.center));
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+    // Setup indices for EBO, all levels back to back, halving them when every vertex fits
+    // in 16 bits below 0xFFFF, which stays free for primitive restart
+    indexType = vertexCount < 65535 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+
+    size_t totalIndexCount = 0;
+    for (const IndexSpan& level : levels) {
+        totalIndexCount += level.indexCount;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndexCount * indexSize, nullptr, GL_STATIC_DRAW);
+
+    lods.clear();
+    size_t byteOffset = 0;
+    for (const IndexSpan& level : levels) {
+        LodRange range = { static_cast<GLsizei>(level.indexCount), byteOffset, level.error };
+        lods.push_back(range);
+
+        if (indexType == GL_UNSIGNED_SHORT) {
+            std::vector<uint16_t> shortIndices(level.indices, level.indices + level.indexCount);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, byteOffset, level.indexCount * indexSize, shortIndices.data());
+        } else {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, byteOffset, level.indexCount * indexSize, level.indices);
+        }
+        byteOffset += level.indexCount * indexSize;
+    }
+
+    MeshVertexLayout::setupAttributes();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::bindAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    MeshVertexLayout::setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+}
+
+void Mesh::applyVertexDecode(GLuint program) const {
+    ::applyVertexDecode(program, bounds, MeshVertexLayout::OctNormals);
+}
+
+void Mesh::draw(GLenum mode, int lod) const {
+    if (lods.empty()) {
+        return;
+    }
+
+    const LodRange& range = lods[std::min(std::max(lod, 0), getLodCount() - 1)];
+    glBindVertexArray(VAO);
+    glDrawElements(mode, range.indexCount, indexType, reinterpret_cast<const void*>(range.byteOffset));
+    glBindVertexArray(0);
+
+    LodSelector::recordDraw(range.indexCount / 3, lods[0].indexCount / 3);
+}
+
+MeshRegistry& MeshRegistry::instance() {
+    static MeshRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<Mesh> MeshRegistry::findLive(const std::string& key) const {
+    auto found = meshes.find(key);
+    if (found == meshes.end()) {
+        return nullptr;
+    }
+    return found->second.lock();
+}
+
+std::shared_ptr<const Mesh> MeshRegistry::load(const std::string& modelPath, bool keepCpuData) {
+    std::shared_ptr<Mesh> mesh = findLive(modelPath);
+    if (mesh) {
+        // A later user may want the CPU copy the first one dropped
+        if (keepCpuData && !mesh->hasCpuData()) {
+            MeshCache cache(modelPath);
+            if (cache.load()) {
+                copyFromCache(cache, mesh->cpuData);
+            } else {
+                parseModel(modelPath, mesh->cpuData);
+            }
+        }
+        std::cout << "Reusing loaded model: " << modelPath << " (" << mesh.use_count() - 1 << " other users)" << std::endl;
+        return mesh;
+    }
+
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    mesh.reset(new Mesh(modelPath));
+
+    // Warm start: upload straight from the mapped cache entry
+    MeshCache cache(modelPath);
+    if (cache.load()) {
+        const uint32_t vertexCount = cache.getVertexCount();
+        const glm::vec3* cachedPositions = static_cast<const glm::vec3*>(cache.getVertexData());
+        const glm::vec3* cachedNormals = cachedPositions + vertexCount;
+        const glm::vec2* cachedTexCoords = reinterpret_cast<const glm::vec2*>(cachedNormals + vertexCount);
+
+        if (keepCpuData) {
+            copyFromCache(cache, mesh->cpuData);
+        }
+
+        VertexSource source = { cachedPositions, cachedNormals, cachedTexCoords, vertexCount };
+        std::vector<Mesh::IndexSpan> levels(1 + cache.getLodCount());
+        levels[0] = { cache.getIndexData(), cache.getIndexCount(), 0.0f };
+        for (size_t i = 0; i < cache.getLodCount(); ++i) {
+            levels[i + 1] = { cache.getLodIndexData(i), cache.getLodIndexCount(i), cache.getLodError(i) };
+        }
+
+        mesh->upload(source, levels);
+        printLoaded(modelPath, "warm, from cache", millisecondsSince(loadStart), *mesh);
+    } else {
+        MeshData data;
+        if (!parseModel(modelPath, data)) {
+            return nullptr;
+        }
+
+        cache.save(data);
+        upload(*mesh, data);
+        printLoaded(modelPath, "cold, parsed", millisecondsSince(loadStart), *mesh);
+
+        if (keepCpuData) {
+            mesh->cpuData = std::move(data);
+        }
+    }
+
+    meshes[modelPath] = mesh;
+    return mesh;
+}
+
+void MeshRegistry::loadAsync(const std::string& modelPath, LoadCallback onLoaded, bool keepCpuData) {
+    std::shared_ptr<Mesh> mesh = findLive(modelPath);
+    if (mesh && (!keepCpuData || mesh->hasCpuData())) {
+        onLoaded(mesh);
+        return;
+    }
+
+    auto pending = pendingLoads.find(modelPath);
+    if (pending != pendingLoads.end()) {
+        pending->second.callbacks.push_back(onLoaded);
+        pending->second.keepCpuData = pending->second.keepCpuData || keepCpuData;
+        return;
+    }
+
+    PendingLoad& load = pendingLoads[modelPath];
+    load.callbacks.push_back(onLoaded);
+    load.keepCpuData = keepCpuData;
+
+    // Worker: cache read or parse (and cache write) into CPU data
+    AssetLoader::instance().load(modelPath, [modelPath]() -> AssetLoader::Upload {
+        auto decodeStart = std::chrono::high_resolution_clock::now();
+        auto data = std::make_shared<MeshData>();
+        std::string source = "warm, from cache";
+
+        MeshCache cache(modelPath);
+        if (cache.load()) {
+            copyFromCache(cache, *data);
+        } else if (parseModel(modelPath, *data)) {
+            cache.save(*data);
+            source = "cold, parsed";
+        } else {
+            data.reset();
+        }
+
+        const double decodeMilliseconds = millisecondsSince(decodeStart);
+        return [modelPath, data, source, decodeMilliseconds]() {
+            MeshRegistry::instance().finishLoad(modelPath, data, source, decodeMilliseconds);
+        };
+    });
+}
+
+void MeshRegistry::finishLoad(const std::string& modelPath, const std::shared_ptr<MeshData>& data, const std::string& source, double decodeMilliseconds) {
+    auto pending = pendingLoads.find(modelPath);
+    if (pending == pendingLoads.end()) {
+        return;
+    }
+    PendingLoad load = std::move(pending->second);
+    pendingLoads.erase(pending);
+
+    // A blocking load() of the same path may have finished first
+    std::shared_ptr<Mesh> mesh = findLive(modelPath);
+    if (!mesh && data) {
+        auto uploadStart = std::chrono::high_resolution_clock::now();
+        mesh.reset(new Mesh(modelPath));
+        upload(*mesh, *data);
+        meshes[modelPath] = mesh;
+
+        std::ostringstream details;
+        details << source << " in background, " << millisecondsSince(uploadStart) << " ms GL upload";
+        printLoaded(modelPath, details.str(), decodeMilliseconds, *mesh);
+    }
+
+    if (mesh && load.keepCpuData && !mesh->hasCpuData() && data) {
+        mesh->cpuData = std::move(*data);
+    }
+
+    for (const LoadCallback& callback : load.callbacks) {
+        callback(mesh);
+    }
+}
+
+std::shared_ptr<const Mesh> MeshRegistry::getPlaceholder() {
+    if (!placeholder) {
+        MeshData cube;
+        buildCube(cube);
+        placeholder = create("placeholder:cube", cube);
+    }
+    return placeholder;
+}
+
+std::shared_ptr<const Mesh> MeshRegistry::create(const std::string& key, const MeshData& data, bool keepCpuData) {
+    std::shared_ptr<Mesh> mesh = findLive(key);
+    if (mesh) {
+        if (keepCpuData && !mesh->hasCpuData()) {
+            mesh->cpuData = data;
+        }
+        return mesh;
+    }
+
+    mesh.reset(new Mesh(key));
+    upload(*mesh, data);
+    if (keepCpuData) {
+        mesh->cpuData = data;
+    }
+
+    meshes[key] = mesh;
+    return mesh;
+}
+
+void MeshRegistry::upload(Mesh& mesh, const MeshData& data) {
+    VertexSource source = { data.positions.data(), data.normals.data(), data.texCoords.data(), data.positions.size() };
+    std::vector<Mesh::IndexSpan> levels(1 + data.lods.size());
+    levels[0] = { data.indices.data(), data.indices.size(), 0.0f };
+    for (size_t i = 0; i < data.lods.size(); ++i) {
+        levels[i + 1] = { data.lods[i].indices.data(), data.lods[i].indices.size(), data.lods[i].error };
+    }
+    mesh.upload(source, levels);
+}
+
+size_t MeshRegistry::getLiveMeshCount() const {
+    size_t count = 0;
+    for (const auto& entry : meshes) {
+        if (!entry.second.expired()) {
+            ++count;
+        }
+    }
+    return count;
+}
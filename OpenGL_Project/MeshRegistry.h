@@ -0,0 +1,137 @@
+#ifndef MESHREGISTRY_H
+#define MESHREGISTRY_H
+
+#include <glew.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BoundingVolume.h"
+#include "MeshData.h"
+#include "VertexLayout.h"
+
+// Packed vertex format of every registry mesh: 16 bytes instead of 32
+typedef VertexLayout<Pos16Quantized, NormalOct16, UvHalf2> MeshVertexLayout;
+
+// GPU-resident indexed mesh shared by everything that draws the same source.
+// The VBO holds interleaved MeshVertexLayout vertices (positions quantized to the
+// mesh bounds, octahedral normals, half-float texcoords) and the EBO uses 16-bit
+// indices when the mesh has fewer than 65535 vertices, keeping 0xFFFF free for
+// primitive restart. The EBO holds the full-detail triangles followed by each
+// simplified LOD, all over the same vertices.
+class Mesh {
+public:
+    ~Mesh();
+
+    GLuint getVAO() const { return VAO; }
+    GLuint getVBO() const { return VBO; }
+    GLuint getEBO() const { return EBO; }
+    GLsizei getIndexCount() const { return getLodIndexCount(0); }
+    GLenum getIndexType() const { return indexType; }
+    size_t getVertexCount() const { return vertexCount; }
+    const QuantizationBounds& getBounds() const { return bounds; }
+
+    // Object-space bounds, computed from the vertices at load time
+    const Aabb& getAabb() const { return aabb; }
+    const BoundingSphere& getBoundingSphere() const { return boundingSphere; }
+
+    // LOD 0 is full detail; higher levels are coarser
+    int getLodCount() const { return static_cast<int>(lods.size()); }
+    GLsizei getLodIndexCount(int lod) const { return lods.empty() ? 0 : lods[lod].indexCount; }
+    float getLodError(int lod) const { return lods[lod].error; }
+
+    // Binds the VBO/EBO and describes the vertex format to the current VAO, for callers
+    // building their own VAO (e.g. with extra instance attributes)
+    void bindAttributes() const;
+
+    // Sets the position dequantization and normal decode uniforms; call after glUseProgram
+    void applyVertexDecode(GLuint program) const;
+
+    // CPU copy of the mesh, empty unless some user asked the registry to keep it
+    bool hasCpuData() const { return !cpuData.positions.empty(); }
+    const MeshData& getCpuData() const { return cpuData; }
+
+    const std::string& getKey() const { return key; }
+
+    // Draws one LOD level (clamped to the available levels) and counts it in the LOD stats
+    void draw(GLenum mode = GL_TRIANGLES, int lod = 0) const;
+
+private:
+    friend class MeshRegistry;
+
+    // One level of the concatenated index buffer
+    struct LodRange {
+        GLsizei indexCount;
+        size_t byteOffset;
+        float error;
+    };
+
+    // Index list of one level, as handed to upload()
+    struct IndexSpan {
+        const unsigned int* indices;
+        size_t indexCount;
+        float error;
+    };
+
+    explicit Mesh(const std::string& key);
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    void upload(const VertexSource& source, const std::vector<IndexSpan>& levels);
+
+    std::string key;
+    GLuint VAO, VBO, EBO;
+    GLenum indexType;
+    size_t vertexCount;
+    QuantizationBounds bounds;
+    Aabb aabb;
+    BoundingSphere boundingSphere;
+    std::vector<LodRange> lods;
+    MeshData cpuData;
+};
+
+// Hands out shared, immutable meshes keyed by source path (or a procedural name),
+// so each OBJ is parsed and uploaded once no matter how many users draw it.
+// Entries are weak: the GPU buffers go away with the last handle. GL thread only.
+class MeshRegistry {
+public:
+    typedef std::function<void(const std::shared_ptr<const Mesh>&)> LoadCallback;
+
+    static MeshRegistry& instance();
+
+    // Loads a model through the mesh cache / OBJ parser, or returns the live shared copy
+    std::shared_ptr<const Mesh> load(const std::string& modelPath, bool keepCpuData = false);
+
+    // Same as load, but the cache read or OBJ parse runs on the AssetLoader's workers and
+    // onLoaded gets the mesh (null on failure) from AssetLoader::processUploads. A live mesh
+    // is handed over at once; requests for a path already in flight join that load.
+    void loadAsync(const std::string& modelPath, LoadCallback onLoaded, bool keepCpuData = false);
+
+    // Unit cube drawn in place of meshes that are still loading
+    std::shared_ptr<const Mesh> getPlaceholder();
+
+    // Registers generated geometry under a name; an existing live entry is returned as is
+    std::shared_ptr<const Mesh> create(const std::string& key, const MeshData& data, bool keepCpuData = false);
+
+    size_t getLiveMeshCount() const;
+
+private:
+    // Async load waiting for its worker
+    struct PendingLoad {
+        std::vector<LoadCallback> callbacks;
+        bool keepCpuData;
+    };
+
+    MeshRegistry() = default;
+
+    std::shared_ptr<Mesh> findLive(const std::string& key) const;
+    static void upload(Mesh& mesh, const MeshData& data);
+    void finishLoad(const std::string& modelPath, const std::shared_ptr<MeshData>& data, const std::string& source, double decodeMilliseconds);
+
+    std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+    std::unordered_map<std::string, PendingLoad> pendingLoads;
+    std::shared_ptr<const Mesh> placeholder; // Kept alive for the whole run
+};
+
+#endif
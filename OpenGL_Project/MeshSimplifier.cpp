@@ -0,0 +1,515 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "HashUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    // Border and seam edge planes count this much more than surface area of the same size
+    const double EdgeWeight = 10.0;
+
+    // Smallest mesh worth a LOD chain, and the shrink a level must achieve to be kept
+    const size_t MinLodTriangles = 64;
+    const float MinLodReduction = 0.8f;
+
+    // Error budget of the first coarse level (relative to the mesh extent), doubled per level
+    // as the screen size it is drawn at halves (see LodSelector)
+    const float FirstLodError = 0.01f;
+
+    // Sum of area-weighted squared plane distances, kept in double for large meshes
+    struct Quadric {
+        double a00, a11, a22, a01, a02, a12;
+        double b0, b1, b2;
+        double c;
+        double weight;
+    };
+
+    Quadric planeQuadric(const glm::vec3& normal, float distance, double weight) {
+        const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+        Quadric q;
+        q.a00 = weight * x * x; q.a11 = weight * y * y; q.a22 = weight * z * z;
+        q.a01 = weight * x * y; q.a02 = weight * x * z; q.a12 = weight * y * z;
+        q.b0 = weight * x * d; q.b1 = weight * y * d; q.b2 = weight * z * d;
+        q.c = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+
+    void addQuadric(Quadric& q, const Quadric& r) {
+        q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+        q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+        q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+        q.c += r.c;
+        q.weight += r.weight;
+    }
+
+    // Weighted mean squared distance of p to the accumulated planes
+    double evaluateQuadric(const Quadric& q, const glm::vec3& p) {
+        const double x = p.x, y = p.y, z = p.z;
+        const double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+            + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+            + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+        return q.weight > 0.0 ? std::fabs(error) / q.weight : 0.0;
+    }
+
+    struct VertexKey {
+        glm::vec3 position;
+        glm::vec2 texCoord;
+
+        bool operator==(const VertexKey& other) const {
+            return std::memcmp(this, &other, sizeof(VertexKey)) == 0;
+        }
+    };
+
+    struct VertexKeyHash {
+        size_t operator()(const VertexKey& key) const {
+            return static_cast<size_t>(hashBytes(&key, sizeof(VertexKey)));
+        }
+    };
+
+    // Maps every vertex to the first vertex with bitwise the same position (and texcoord,
+    // if asked), so vertices split only by other attributes act as one
+    std::vector<unsigned int> buildRemap(const MeshData& mesh, bool matchTexCoords) {
+        std::unordered_map<VertexKey, unsigned int, VertexKeyHash> firstVertex;
+        firstVertex.reserve(mesh.positions.size());
+
+        std::vector<unsigned int> remap(mesh.positions.size());
+        for (size_t v = 0; v < mesh.positions.size(); ++v) {
+            VertexKey key;
+            key.position = mesh.positions[v];
+            key.texCoord = matchTexCoords ? mesh.texCoords[v] : glm::vec2(0.0f);
+            remap[v] = firstVertex.emplace(key, static_cast<unsigned int>(v)).first->second;
+        }
+        return remap;
+    }
+
+    uint64_t edgeKey(unsigned int from, unsigned int to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    // One directed position edge and the wedges its first triangle uses
+    struct EdgeRecord {
+        unsigned int fromVertex;
+        unsigned int toVertex;
+        unsigned int count;
+    };
+
+    // Position -> triangles adjacency in compressed row form
+    struct PositionAdjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        void build(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionId) {
+            offsets.assign(positionId.size() + 1, 0);
+            for (unsigned int index : indices) {
+                offsets[positionId[index] + 1]++;
+            }
+            for (size_t p = 0; p < positionId.size(); ++p) {
+                offsets[p + 1] += offsets[p];
+            }
+
+            triangles.resize(indices.size());
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[cursor[positionId[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double error;
+    };
+
+    glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    // Points each corner at the vertex of its wedge whose normal best fits the simplified
+    // triangle, so flat-shaded and hard-edged meshes keep their facets
+    void restoreNormals(const MeshData& mesh, const std::vector<unsigned int>& wedgeId, std::vector<unsigned int>& indices) {
+        const size_t vertexCount = wedgeId.size();
+        std::vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (unsigned int wedge : wedgeId) {
+            offsets[wedge + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<unsigned int> variants(vertexCount);
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            variants[cursor[wedgeId[v]]++] = static_cast<unsigned int>(v);
+        }
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const glm::vec3 faceNormal = triangleNormal(mesh.positions[indices[i]], mesh.positions[indices[i + 1]],
+                mesh.positions[indices[i + 2]]);
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int wedge = indices[i + k];
+                unsigned int best = wedge;
+                float bestFit = -1.0f;
+                for (unsigned int a = offsets[wedge]; a < offsets[wedge + 1]; ++a) {
+                    const float fit = glm::dot(mesh.normals[variants[a]], faceNormal);
+                    if (fit > bestFit) {
+                        bestFit = fit;
+                        best = variants[a];
+                    }
+                }
+                indices[i + k] = best;
+            }
+        }
+    }
+
+    // Working state of one simplify() call; positions are moved into a unit-extent frame
+    // so quadric errors come out relative to the mesh size
+    struct Simplifier {
+        const std::vector<unsigned int>& positionId;
+        const std::vector<glm::vec3>& points;
+        const std::vector<unsigned char>& border;
+        std::vector<unsigned int>& indices;
+        PositionAdjacency adjacency;
+        std::vector<std::pair<unsigned int, unsigned int>> wedgeMap;
+
+        Simplifier(const std::vector<unsigned int>& positionId, const std::vector<glm::vec3>& points,
+            const std::vector<unsigned char>& border, std::vector<unsigned int>& indices)
+            : positionId(positionId), points(points), border(border), indices(indices) {}
+
+        int cornerAt(unsigned int triangle, unsigned int position) const {
+            for (int k = 0; k < 3; ++k) {
+                if (positionId[indices[triangle * 3 + k]] == position) {
+                    return k;
+                }
+            }
+            return -1;
+        }
+
+        // Validates moving position from onto position to and fills wedgeMap with where each
+        // of from's wedges goes; returns how many triangles the collapse removes (0 if refused)
+        int prepareCollapse(unsigned int from, unsigned int to) {
+            wedgeMap.clear();
+            int shared = 0;
+
+            // Triangles on the collapsing edge decide each wedge's destination
+            for (unsigned int a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; ++a) {
+                const unsigned int triangle = adjacency.triangles[a];
+                const int toCorner = cornerAt(triangle, to);
+                if (toCorner < 0) {
+                    continue;
+                }
+
+                const unsigned int fromWedge = indices[triangle * 3 + cornerAt(triangle, from)];
+                const unsigned int toWedge = indices[triangle * 3 + toCorner];
+                shared++;
+
+                bool mapped = false;
+                for (const auto& entry : wedgeMap) {
+                    if (entry.first == fromWedge) {
+                        // One wedge split across a seam on the far side would tear
+                        if (entry.second != toWedge) {
+                            return 0;
+                        }
+                        mapped = true;
+                    }
+                }
+                if (!mapped) {
+                    wedgeMap.push_back(std::make_pair(fromWedge, toWedge));
+                }
+            }
+
+            // Non-manifold edges stay; border vertices only slide along the border
+            if (shared == 0 || shared > 2 || (border[from] && shared != 1)) {
+                return 0;
+            }
+
+            for (unsigned int a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; ++a) {
+                const unsigned int triangle = adjacency.triangles[a];
+                const int fromCorner = cornerAt(triangle, from);
+                const unsigned int fromWedge = indices[triangle * 3 + fromCorner];
+
+                // A wedge with no counterpart on the edge (seam corner, or a seam vertex moving
+                // off its seam) has nowhere to go
+                bool mapped = false;
+                for (const auto& entry : wedgeMap) {
+                    mapped = mapped || entry.first == fromWedge;
+                }
+                if (!mapped) {
+                    return 0;
+                }
+
+                // Surviving triangles must not flip over
+                if (cornerAt(triangle, to) >= 0) {
+                    continue;
+                }
+                glm::vec3 corners[3];
+                for (int k = 0; k < 3; ++k) {
+                    corners[k] = points[positionId[indices[triangle * 3 + k]]];
+                }
+                const glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+                corners[fromCorner] = points[to];
+                const glm::vec3 after = triangleNormal(corners[0], corners[1], corners[2]);
+                if (glm::dot(before, after) <= 0.0f) {
+                    return 0;
+                }
+            }
+
+            return shared;
+        }
+    };
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const MeshData& mesh, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float targetError, float* resultError) {
+    std::vector<unsigned int> result(indices);
+    if (resultError) {
+        *resultError = 0.0f;
+    }
+
+    const size_t vertexCount = mesh.positions.size();
+    if (result.size() <= targetIndexCount || vertexCount == 0) {
+        return result;
+    }
+
+    glm::vec3 minimum = mesh.positions[0];
+    glm::vec3 maximum = mesh.positions[0];
+    for (const glm::vec3& p : mesh.positions) {
+        minimum = glm::min(minimum, p);
+        maximum = glm::max(maximum, p);
+    }
+    const float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+    if (extent <= 0.0f) {
+        return result;
+    }
+
+    std::vector<glm::vec3> points(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        points[v] = (mesh.positions[v] - minimum) / extent;
+    }
+
+    // Wedges are vertices that differ by texcoord; normal-only splits (flat shading, hard
+    // edges) don't constrain collapses and are picked again per triangle at the end
+    const std::vector<unsigned int> positionId = buildRemap(mesh, false);
+    const std::vector<unsigned int> wedgeId = buildRemap(mesh, true);
+
+    // Work on wedges and drop triangles that are already degenerate in position space
+    size_t write = 0;
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        const unsigned int a = positionId[result[i]], b = positionId[result[i + 1]], c = positionId[result[i + 2]];
+        if (a != b && b != c && c != a) {
+            result[write++] = wedgeId[result[i]];
+            result[write++] = wedgeId[result[i + 1]];
+            result[write++] = wedgeId[result[i + 2]];
+        }
+    }
+    result.resize(write);
+
+    // Directed position edges, to find open borders, attribute seams and non-manifold edges
+    std::unordered_map<uint64_t, EdgeRecord> edges;
+    edges.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int fromVertex = result[i + k];
+            const unsigned int toVertex = result[i + (k + 1) % 3];
+            EdgeRecord record = { fromVertex, toVertex, 0 };
+            edges.emplace(edgeKey(positionId[fromVertex], positionId[toVertex]), record).first->second.count++;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount, planeQuadric(glm::vec3(0.0f), 0.0f, 0.0));
+    std::vector<unsigned char> border(vertexCount, 0);
+    std::vector<unsigned char> locked(vertexCount, 0);
+
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::vec3& p0 = points[result[i]];
+        const glm::vec3 cross = triangleNormal(p0, points[result[i + 1]], points[result[i + 2]]);
+        const float length = glm::length(cross);
+        if (length <= 0.0f) {
+            continue;
+        }
+        const glm::vec3 normal = cross / length;
+
+        const Quadric surface = planeQuadric(normal, -glm::dot(normal, p0), 0.5 * length);
+        for (int k = 0; k < 3; ++k) {
+            addQuadric(quadrics[positionId[result[i + k]]], surface);
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int fromVertex = result[i + k];
+            const unsigned int toVertex = result[i + (k + 1) % 3];
+            const unsigned int from = positionId[fromVertex];
+            const unsigned int to = positionId[toVertex];
+
+            const auto forward = edges.find(edgeKey(from, to));
+            const auto opposite = edges.find(edgeKey(to, from));
+            if (forward->second.count > 1 || (opposite != edges.end() && opposite->second.count > 1)) {
+                locked[from] = locked[to] = 1;
+            }
+
+            const bool isBorder = opposite == edges.end();
+            const bool isSeam = !isBorder && (opposite->second.fromVertex != toVertex || opposite->second.toVertex != fromVertex);
+            if (isBorder) {
+                border[from] = border[to] = 1;
+            }
+
+            // Planes through the edge, perpendicular to the surface, hold borders and seams in place
+            if (isBorder || isSeam) {
+                const glm::vec3 edge = points[to] - points[from];
+                const float edgeLength = glm::length(edge);
+                const glm::vec3 sideways = glm::cross(edge, normal);
+                const float sidewaysLength = glm::length(sideways);
+                if (edgeLength > 0.0f && sidewaysLength > 0.0f) {
+                    const glm::vec3 planeNormal = sideways / sidewaysLength;
+                    const Quadric constraint = planeQuadric(planeNormal, -glm::dot(planeNormal, points[from]),
+                        EdgeWeight * edgeLength * edgeLength);
+                    addQuadric(quadrics[from], constraint);
+                    addQuadric(quadrics[to], constraint);
+                }
+            }
+        }
+    }
+
+    Simplifier state(positionId, points, border, result);
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> vertexRemap(vertexCount);
+    std::vector<unsigned char> collapseLocked(vertexCount);
+    const double errorLimit = static_cast<double>(targetError) * targetError;
+    double maxError = 0.0;
+
+    // Each pass collapses the cheapest independent edges, then rewrites the index buffer
+    while (result.size() > targetIndexCount) {
+        state.adjacency.build(result, positionId);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int from = positionId[result[i + k]];
+                const unsigned int to = positionId[result[i + (k + 1) % 3]];
+
+                // Interior edges show up once per direction; border edges only once in total
+                const int directions = (border[from] && border[to]) ? 2 : 1;
+                for (int d = 0; d < directions; ++d) {
+                    const unsigned int u = d == 0 ? from : to;
+                    const unsigned int v = d == 0 ? to : from;
+                    if (locked[u]) {
+                        continue;
+                    }
+
+                    Quadric combined = quadrics[u];
+                    addQuadric(combined, quadrics[v]);
+                    Collapse collapse = { u, v, evaluateQuadric(combined, points[v]) };
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.error < b.error;
+        });
+
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexRemap[v] = static_cast<unsigned int>(v);
+        }
+        std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+        const size_t triangleGoal = (result.size() - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        size_t applied = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > errorLimit || trianglesRemoved >= triangleGoal) {
+                break;
+            }
+            if (collapseLocked[collapse.from] || collapseLocked[collapse.to]) {
+                continue;
+            }
+
+            const int removed = state.prepareCollapse(collapse.from, collapse.to);
+            if (removed == 0) {
+                continue;
+            }
+
+            for (const auto& entry : state.wedgeMap) {
+                vertexRemap[entry.first] = entry.second;
+            }
+            addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+
+            // Everything touching the moved vertex is stale until the next pass
+            for (unsigned int a = state.adjacency.offsets[collapse.from]; a < state.adjacency.offsets[collapse.from + 1]; ++a) {
+                const unsigned int triangle = state.adjacency.triangles[a];
+                for (int k = 0; k < 3; ++k) {
+                    collapseLocked[positionId[result[triangle * 3 + k]]] = 1;
+                }
+            }
+
+            trianglesRemoved += removed;
+            maxError = std::max(maxError, collapse.error);
+            applied++;
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const unsigned int a = vertexRemap[result[i]], b = vertexRemap[result[i + 1]], c = vertexRemap[result[i + 2]];
+            if (positionId[a] != positionId[b] && positionId[b] != positionId[c] && positionId[c] != positionId[a]) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    restoreNormals(mesh, wedgeId, result);
+
+    if (resultError) {
+        *resultError = static_cast<float>(std::sqrt(maxError));
+    }
+    return result;
+}
+
+void MeshSimplifier::buildLods(MeshData& mesh, const std::string& name) {
+    mesh.lods.clear();
+    const size_t triangleCount = mesh.getTriangleCount();
+    if (triangleCount < MinLodTriangles * 2) {
+        return;
+    }
+
+    size_t previousCount = mesh.indices.size();
+    float targetError = FirstLodError;
+    for (size_t level = 1; level <= MaxLods; ++level) {
+        const size_t targetTriangles = triangleCount >> level;
+        if (targetTriangles < MinLodTriangles) {
+            break;
+        }
+
+        // Every level starts from full detail so its error is measured against the original
+        MeshLod lod;
+        lod.indices = simplify(mesh, mesh.indices, targetTriangles * 3, targetError, &lod.error);
+
+        // A level that barely shrinks costs memory without saving any work
+        if (lod.indices.size() > previousCount * MinLodReduction) {
+            break;
+        }
+
+        MeshOptimizer::optimizeVertexCache(lod.indices, mesh.positions.size());
+        previousCount = lod.indices.size();
+        mesh.lods.push_back(std::move(lod));
+        targetError *= 2.0f;
+    }
+
+    std::cout << "Built LODs: " << name << " " << triangleCount;
+    for (const MeshLod& lod : mesh.lods) {
+        std::cout << " -> " << lod.indices.size() / 3 << " (error " << lod.error << ")";
+    }
+    std::cout << " triangles" << std::endl;
+}
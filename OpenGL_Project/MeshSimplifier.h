@@ -0,0 +1,29 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+// Quadric error metric (Garland-Heckbert) simplification by half-edge collapse.
+// Vertices only ever move onto existing vertices, so every level indexes the
+// original vertex buffer and the LOD chain costs nothing but index memory.
+// Open borders and UV seams are kept by extra edge quadrics and by only
+// collapsing a vertex along its seam; normal-only splits (flat shading, hard
+// edges) are re-picked per simplified triangle.
+class MeshSimplifier {
+public:
+    // Full detail plus up to this many coarser levels
+    static const size_t MaxLods = 3;
+
+    // Simplifies an indexed triangle list over mesh's vertices towards targetIndexCount,
+    // never exceeding targetError (relative to the mesh extent). Returns the new indices;
+    // resultError receives the largest error actually introduced.
+    static std::vector<unsigned int> simplify(const MeshData& mesh, const std::vector<unsigned int>& indices,
+        size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+    // Fills mesh.lods with halving triangle budgets, stopping once a level no longer pays off
+    static void buildLods(MeshData& mesh, const std::string& name);
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_GENERATOR_AVX2 1
+#endif
+
+namespace {
+    const int StripRows = 32; // Target rows per pool task
+    const int KaiserTaps = 8;
+    const int SrgbEncodeSteps = 16384;
+
+    // Lookup tables shared by every conversion, built once
+    struct FilterTables {
+        float srgbToLinear[256];
+        float unormToFloat[256];
+        unsigned char linearToSrgb[SrgbEncodeSteps + 1];
+        float kaiser[KaiserTaps]; // Weights of source texels 2x-3 .. 2x+4 for target texel x
+
+        FilterTables() {
+            for (int i = 0; i < 256; ++i) {
+                const double value = i / 255.0;
+                srgbToLinear[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+                unormToFloat[i] = static_cast<float>(value);
+            }
+            for (int i = 0; i <= SrgbEncodeSteps; ++i) {
+                const double value = static_cast<double>(i) / SrgbEncodeSteps;
+                const double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+                linearToSrgb[i] = static_cast<unsigned char>(std::min(std::max(encoded * 255.0 + 0.5, 0.0), 255.0));
+            }
+
+            // Half-band sinc under a Kaiser window (alpha 4) reaching four source texels either side
+            const double pi = 3.14159265358979323846;
+            const double alpha = 4.0, radius = 4.0;
+            double total = 0.0;
+            double weights[KaiserTaps];
+            for (int k = 0; k < KaiserTaps; ++k) {
+                const double distance = k - 3.5;
+                const double phase = pi * distance * 0.5;
+                const double sinc = std::sin(phase) / phase;
+                const double ratio = distance / radius;
+                weights[k] = sinc * besselI0(alpha * std::sqrt(1.0 - ratio * ratio)) / besselI0(alpha);
+                total += weights[k];
+            }
+            for (int k = 0; k < KaiserTaps; ++k) {
+                kaiser[k] = static_cast<float>(weights[k] / total);
+            }
+        }
+
+        static double besselI0(double x) {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 20; ++k) {
+                const double factor = x / (2.0 * k);
+                term *= factor * factor;
+                sum += term;
+            }
+            return sum;
+        }
+    };
+
+    const FilterTables& filterTables() {
+        static const FilterTables tables;
+        return tables;
+    }
+
+    // Channels before this one hold colour; the last of a 2- or 4-channel image is alpha
+    int colorChannelCount(int channels) {
+        return channels == 2 || channels == 4 ? channels - 1 : channels;
+    }
+
+    // One row of 8-bit texels to linear RGBA floats (unused channels zero)
+    void fetchRow(const unsigned char* row, int width, int channels, bool srgb, float* out) {
+        const FilterTables& tables = filterTables();
+        const int colorChannels = srgb ? colorChannelCount(channels) : 0;
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                const unsigned char value = c < channels ? row[x * channels + c] : 0;
+                out[x * 4 + c] = c < colorChannels ? tables.srgbToLinear[value] : tables.unormToFloat[value];
+            }
+        }
+    }
+
+    void storeRow(const float* in, int width, int channels, bool srgb, unsigned char* row) {
+        const FilterTables& tables = filterTables();
+        const int colorChannels = srgb ? colorChannelCount(channels) : 0;
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                const float value = std::min(std::max(in[x * 4 + c], 0.0f), 1.0f);
+                row[x * channels + c] = c < colorChannels
+                    ? tables.linearToSrgb[static_cast<int>(value * SrgbEncodeSteps + 0.5f)]
+                    : static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // acc += row * weight over count floats
+    void accumulate(float* acc, const float* row, float weight, int count) {
+        int i = 0;
+#ifdef MIP_GENERATOR_AVX2
+        const __m256 weight8 = _mm256_set1_ps(weight);
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(row + i), weight8)));
+        }
+#endif
+#ifdef MIP_GENERATOR_SSE
+        const __m128 weight4 = _mm_set1_ps(weight);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), weight4)));
+        }
+#endif
+        for (; i < count; ++i) {
+            acc[i] += row[i] * weight;
+        }
+    }
+
+    // Averages horizontal pairs of a row that already holds the sum of two source rows
+    void averagePairs(const float* sum, int sourceWidth, int targetWidth, float* out) {
+        int x = 0;
+        if (sourceWidth >= 2) {
+#ifdef MIP_GENERATOR_AVX2
+            const __m256 quarter8 = _mm256_set1_ps(0.25f);
+            for (; x + 2 <= targetWidth; x += 2) {
+                const __m256 first = _mm256_loadu_ps(sum + x * 8);      // Texels 2x, 2x+1
+                const __m256 second = _mm256_loadu_ps(sum + x * 8 + 8); // Texels 2x+2, 2x+3
+                const __m256 even = _mm256_permute2f128_ps(first, second, 0x20);
+                const __m256 odd = _mm256_permute2f128_ps(first, second, 0x31);
+                _mm256_storeu_ps(out + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter8));
+            }
+#endif
+#ifdef MIP_GENERATOR_SSE
+            const __m128 quarter4 = _mm_set1_ps(0.25f);
+            for (; x < targetWidth; ++x) {
+                _mm_storeu_ps(out + x * 4, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(sum + x * 8), _mm_loadu_ps(sum + x * 8 + 4)), quarter4));
+            }
+#endif
+        }
+        for (; x < targetWidth; ++x) {
+            const int x0 = std::min(x * 2, sourceWidth - 1), x1 = std::min(x * 2 + 1, sourceWidth - 1);
+            for (int c = 0; c < 4; ++c) {
+                out[x * 4 + c] = 0.25f * (sum[x0 * 4 + c] + sum[x1 * 4 + c]);
+            }
+        }
+    }
+
+    // Horizontal half of the separable Kaiser filter, clamping at the edges
+    void kaiserRow(const float* source, int sourceWidth, int targetWidth, float* out) {
+        if (sourceWidth == 1) {
+            std::memcpy(out, source, 4 * sizeof(float));
+            return;
+        }
+
+        const float* weights = filterTables().kaiser;
+        for (int x = 0; x < targetWidth; ++x) {
+#ifdef MIP_GENERATOR_SSE
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < KaiserTaps; ++k) {
+                const int sourceX = std::min(std::max(x * 2 - 3 + k, 0), sourceWidth - 1);
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(source + sourceX * 4), _mm_set1_ps(weights[k])));
+            }
+            _mm_storeu_ps(out + x * 4, acc);
+#else
+            float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int k = 0; k < KaiserTaps; ++k) {
+                const int sourceX = std::min(std::max(x * 2 - 3 + k, 0), sourceWidth - 1);
+                for (int c = 0; c < 4; ++c) {
+                    acc[c] += source[sourceX * 4 + c] * weights[k];
+                }
+            }
+            std::memcpy(out + x * 4, acc, sizeof(acc));
+#endif
+        }
+    }
+}
+
+int MipGenerator::getLevelCount(int width, int height) {
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+        ++levels;
+    }
+    return levels;
+}
+
+void MipGenerator::generate(ImageData& image, bool srgb, MipFilter filter) {
+    image.mipLevels.clear();
+    if (image.pixels.empty() || image.isCompressed()) {
+        return;
+    }
+
+    const unsigned char* source = image.pixels.data();
+    int width = image.width, height = image.height;
+    image.mipLevels.resize(getLevelCount(width, height) - 1);
+    for (std::vector<unsigned char>& level : image.mipLevels) {
+        const int targetWidth = std::max(1, width / 2), targetHeight = std::max(1, height / 2);
+        level.resize(static_cast<size_t>(targetWidth) * targetHeight * image.channels);
+        downsample(source, width, height, level.data(), targetWidth, targetHeight, image.channels, srgb, filter);
+
+        source = level.data();
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
+
+void MipGenerator::downsample(const unsigned char* source, int sourceWidth, int sourceHeight,
+    unsigned char* target, int targetWidth, int targetHeight, int channels, bool srgb, MipFilter filter) {
+    const size_t sourceStride = static_cast<size_t>(sourceWidth) * channels;
+    const size_t targetStride = static_cast<size_t>(targetWidth) * channels;
+    const int targetFloats = targetWidth * 4;
+    const size_t strips = (targetHeight + StripRows - 1) / StripRows;
+
+    ThreadPool::shared().parallelFor(strips, [&](size_t strip) {
+        const int firstRow = static_cast<int>(strip) * StripRows;
+        const int endRow = std::min(firstRow + StripRows, targetHeight);
+        std::vector<float> sourceRow(static_cast<size_t>(sourceWidth) * 4);
+        std::vector<float> targetRow(targetFloats);
+
+        if (filter == MipFilter::Box) {
+            std::vector<float> secondRow(sourceRow.size());
+            for (int y = firstRow; y < endRow; ++y) {
+                const int y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+                fetchRow(source + y0 * sourceStride, sourceWidth, channels, srgb, sourceRow.data());
+                fetchRow(source + y1 * sourceStride, sourceWidth, channels, srgb, secondRow.data());
+                accumulate(sourceRow.data(), secondRow.data(), 1.0f, sourceWidth * 4);
+                averagePairs(sourceRow.data(), sourceWidth, targetWidth, targetRow.data());
+                storeRow(targetRow.data(), targetWidth, channels, srgb, target + y * targetStride);
+            }
+            return;
+        }
+
+        // Horizontally filter each source row the strip reads once, then combine vertically
+        const float* weights = filterTables().kaiser;
+        const int firstSource = std::max(firstRow * 2 - 3, 0);
+        const int lastSource = std::min((endRow - 1) * 2 + 4, sourceHeight - 1);
+        std::vector<float> filtered(static_cast<size_t>(lastSource - firstSource + 1) * targetFloats);
+        for (int row = firstSource; row <= lastSource; ++row) {
+            fetchRow(source + row * sourceStride, sourceWidth, channels, srgb, sourceRow.data());
+            kaiserRow(sourceRow.data(), sourceWidth, targetWidth, &filtered[static_cast<size_t>(row - firstSource) * targetFloats]);
+        }
+
+        for (int y = firstRow; y < endRow; ++y) {
+            if (sourceHeight == 1) {
+                std::copy(filtered.begin(), filtered.begin() + targetFloats, targetRow.begin());
+            } else {
+                std::fill(targetRow.begin(), targetRow.end(), 0.0f);
+                for (int k = 0; k < KaiserTaps; ++k) {
+                    const int row = std::min(std::max(y * 2 - 3 + k, 0), sourceHeight - 1);
+                    accumulate(targetRow.data(), &filtered[static_cast<size_t>(row - firstSource) * targetFloats], weights[k], targetFloats);
+                }
+            }
+            storeRow(targetRow.data(), targetWidth, channels, srgb, target + y * targetStride);
+        }
+    });
+}
@@ -0,0 +1,31 @@
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <vector>
+#include "AssetLoader.h"
+
+enum class MipFilter {
+    Box,   // 2x2 average, cheap enough for load time
+    Kaiser // Kaiser-windowed sinc over 8x8 texels, sharper; used when cooking
+};
+
+// CPU mip chain generation, so textures upload level by level and nothing calls
+// glGenerateMipmap. Colour data is filtered in linear light (sRGB decoded through a
+// table, re-encoded after), alpha and non-colour data as stored. Each level is built
+// from the 8-bit level above it, a strip of rows at a time on the shared pool; the
+// inner loops use AVX2 when the build enables it and SSE2 otherwise.
+class MipGenerator {
+public:
+    // Number of levels in a full chain down to 1x1, level 0 included
+    static int getLevelCount(int width, int height);
+
+    // Replaces image.mipLevels with levels 1.. of the image, same channel count and
+    // tightly packed. Any thread.
+    static void generate(ImageData& image, bool srgb, MipFilter filter);
+
+private:
+    static void downsample(const unsigned char* source, int sourceWidth, int sourceHeight,
+        unsigned char* target, int targetWidth, int targetHeight, int channels, bool srgb, MipFilter filter);
+};
+
+#endif
@@ -1,18 +1,29 @@
 #pragma once
 
 #include <glew.h>
+#include <memory>
 #include <vector>
 #include <string>
 #include "Dependencies/glm/glm.hpp"
 #include "Dependencies/glm/ext/matrix_transform.hpp"
 #include "Dependencies/glm/gtc/type_ptr.hpp"
+#include "MeshRegistry.h"
 
 class ModelLoader {
 public:
     ModelLoader(const std::string& modelPath);
-    ~ModelLoader();
 
-    void loadModel();
+    // Acquires the shared mesh for this path from the MeshRegistry, which loads it once
+    // (binary mesh cache or OBJ parse). CPU-side attribute copies are only kept on request.
+    void loadModel(bool keepCpuData = false);
+
+    // Same, with the parse/cache read in the background; render() draws the registry's
+    // placeholder cube until the mesh arrives. The loader must outlive the main loop.
+    void loadModelAsync(bool keepCpuData = false);
+
+    bool isLoaded() const { return mesh != nullptr; }
+
+    // Draws the LOD level that matches the model's projected size under view/projection
     void render(GLuint shaderProgram, const glm::mat4& view, const glm::mat4& projection);
 
     // Transformation Methods
@@ -23,21 +34,30 @@ public:
     glm::mat4 getModelMatrix() const { return modelMatrix; }
     void setModelMatrix(const glm::mat4& matrix) { modelMatrix = matrix; }
 
-    // Getters for positions, texcoords, normals
+    // Getters for the welded vertex attributes and the triangle index buffer
+    // (only populated when loadModel was asked to keep CPU data)
     const std::vector<glm::vec3>& getPositions() const;
     const std::vector<glm::vec2>& getTexCoords() const;
     const std::vector<glm::vec3>& getNormals() const;
+    const std::vector<unsigned int>& getIndices() const;
 
-    GLuint VAO, VBO, EBO; // OpenGL handles for rendering
+    const std::shared_ptr<const Mesh>& getMesh() const { return mesh; }
+
+    // Mesh bounds under the current model matrix (the placeholder's until loaded)
+    Aabb getWorldAabb() const;
+    BoundingSphere getWorldSphere() const;
+
+protected:
+    std::shared_ptr<const Mesh> mesh; // Shared GPU buffers, null until loaded
 
 private:
     std::string modelPath;
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec2> texCoords;
-    std::vector<glm::vec3> normals;
-    std::vector<unsigned int> indices;
 
     glm::mat4 modelMatrix = glm::mat4(1.0f); // Transformation matrix
+    int lodLevel = 0; // LOD drawn last frame, kept for hysteresis
+
+    const MeshData& getCpuData() const;
 
-    void setupMesh();
+    // The loaded mesh, or the placeholder while it is loading
+    std::shared_ptr<const Mesh> getDrawMesh() const;
 };
@@ -0,0 +1,58 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue for many producers and a single consumer (Vyukov's
+// node-based MPSC queue). push() is one atomic exchange, so worker threads never
+// block each other or the consumer; pop() is wait-free and only the consumer calls it.
+// A pop can briefly miss an item whose producer is between its exchange and link
+// store; it shows up on the next pop.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(new Node()), tail(head.load()) {}
+
+    ~MpscQueue() {
+        T discarded;
+        while (pop(discarded)) {}
+        delete tail;
+    }
+
+    // Any thread
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete tail;
+        tail = next; // next becomes the stub; its value has been moved out
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+
+        Node() : next(nullptr) {}
+    };
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    std::atomic<Node*> head; // Last pushed node, producers swap themselves in here
+    Node* tail;              // Stub before the next node to pop
+};
+
+#endif
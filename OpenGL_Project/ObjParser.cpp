@@ -0,0 +1,790 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "ObjParser.h"
+#include "dependencies/tiny_obj_loader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "FileUtils.h"
+#include "HashUtils.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    // Chunks smaller than this are not worth a thread hand-off
+    const size_t MinChunkSize = 64 * 1024;
+    // More chunks than threads so uneven chunks (long face runs) still balance
+    const size_t ChunksPerThread = 4;
+
+    typedef ObjParser::Corner Corner;
+
+    // Everything one chunk of the file produces; indices are chunk-relative until resolved
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texCoords;
+        std::vector<Corner> faceCorners;
+        std::vector<unsigned int> faceSizes;
+        std::vector<size_t> relativeSlots; // faceCorners slot * 3 + component of each negative index
+        std::vector<Corner> triangles;
+
+        size_t lineCount = 0;
+        size_t errorLine = 0;
+        std::string error;
+
+        size_t positionBase = 0;
+        size_t normalBase = 0;
+        size_t texCoordBase = 0;
+    };
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    inline bool isDigit(char c) {
+        return static_cast<unsigned int>(c - '0') < 10u;
+    }
+
+    inline char peekAt(const char* p, const char* end, size_t offset) {
+        return p + offset < end ? p[offset] : '\0';
+    }
+
+    inline void skipSpaces(const char*& p, const char* end) {
+        while (p < end && isSpace(*p)) {
+            ++p;
+        }
+    }
+
+    // Same arithmetic as tinyobj's tryParseDouble so the floats come out bit-identical
+    bool parseDouble(const char* s, const char* end, double& result) {
+        if (s >= end) {
+            return false;
+        }
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        char sign = '+';
+        char exponentSign = '+';
+        const char* curr = s;
+        int read = 0;
+        bool leadingDot = false;
+
+        if (*curr == '+' || *curr == '-') {
+            sign = *curr;
+            ++curr;
+            if (curr != end && *curr == '.') {
+                leadingDot = true;
+            }
+        } else if (*curr == '.') {
+            leadingDot = true;
+        } else if (!isDigit(*curr)) {
+            return false;
+        }
+
+        if (!leadingDot) {
+            while (curr != end && isDigit(*curr)) {
+                mantissa *= 10;
+                mantissa += static_cast<int>(*curr - '0');
+                ++curr;
+                ++read;
+            }
+            if (read == 0) {
+                return false;
+            }
+        }
+
+        if (curr != end) {
+            bool readExponent = false;
+            if (*curr == '.') {
+                static const double powLut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+                const int lutEntries = sizeof(powLut) / sizeof(powLut[0]);
+
+                ++curr;
+                read = 1;
+                while (curr != end && isDigit(*curr)) {
+                    mantissa += static_cast<int>(*curr - '0') * (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+                    ++read;
+                    ++curr;
+                }
+                readExponent = curr != end;
+            } else if (*curr == 'e' || *curr == 'E') {
+                readExponent = true;
+            }
+
+            if (readExponent && (*curr == 'e' || *curr == 'E')) {
+                ++curr;
+                if (curr != end && (*curr == '+' || *curr == '-')) {
+                    exponentSign = *curr;
+                    ++curr;
+                } else if (curr == end || !isDigit(*curr)) {
+                    return false;
+                }
+
+                read = 0;
+                while (curr != end && isDigit(*curr)) {
+                    if (exponent > 2147483647 / 10) {
+                        return false;
+                    }
+                    exponent *= 10;
+                    exponent += static_cast<int>(*curr - '0');
+                    ++curr;
+                    ++read;
+                }
+                exponent *= (exponentSign == '+' ? 1 : -1);
+                if (read == 0) {
+                    return false;
+                }
+            }
+        }
+
+        result = (sign == '+' ? 1 : -1) *
+            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+        return true;
+    }
+
+    float parseFloat(const char*& p, const char* end, double defaultValue = 0.0) {
+        skipSpaces(p, end);
+        const char* tokenEnd = p;
+        while (tokenEnd < end && !isSpace(*tokenEnd)) {
+            ++tokenEnd;
+        }
+
+        double value = defaultValue;
+        parseDouble(p, tokenEnd, value);
+        p = tokenEnd;
+        return static_cast<float>(value);
+    }
+
+    // atoi() over a bounded range; like atoi it does not move the cursor
+    int parseInt(const char* p, const char* end) {
+        skipSpaces(p, end);
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            ++p;
+        }
+
+        unsigned int value = 0;
+        while (p < end && isDigit(*p)) {
+            value = value * 10u + static_cast<unsigned int>(*p - '0');
+            ++p;
+        }
+        return static_cast<int>(negative ? 0u - value : value);
+    }
+
+    inline void skipIndex(const char*& p, const char* end) {
+        while (p < end && *p != '/' && !isSpace(*p)) {
+            ++p;
+        }
+    }
+
+    // OBJ indices are 1-based, negative ones count back from the attributes read so far.
+    // Negative indices are stored relative to the chunk and resolved once its base is known.
+    bool resolveIndex(int index, size_t localCount, int& out, bool allowZero, Chunk& chunk, size_t slot) {
+        if (index > 0) {
+            out = index - 1;
+            return true;
+        }
+        if (index == 0) {
+            out = -1;
+            return allowZero;
+        }
+
+        out = static_cast<int>(localCount) + index;
+        chunk.relativeSlots.push_back(slot);
+        return true;
+    }
+
+    // One "v", "v/t", "v//n" or "v/t/n" face corner
+    bool parseFaceCorner(const char*& p, const char* end, Chunk& chunk) {
+        Corner corner = { -1, -1, -1 };
+        const size_t slot = chunk.faceCorners.size() * 3;
+
+        if (!resolveIndex(parseInt(p, end), chunk.positions.size() / 3, corner.position, false, chunk, slot + 0)) {
+            return false;
+        }
+        skipIndex(p, end);
+
+        if (peekAt(p, end, 0) == '/') {
+            ++p;
+            if (peekAt(p, end, 0) == '/') {
+                ++p;
+                if (!resolveIndex(parseInt(p, end), chunk.normals.size() / 3, corner.normal, true, chunk, slot + 1)) {
+                    return false;
+                }
+                skipIndex(p, end);
+            } else {
+                if (!resolveIndex(parseInt(p, end), chunk.texCoords.size() / 2, corner.texCoord, true, chunk, slot + 2)) {
+                    return false;
+                }
+                skipIndex(p, end);
+
+                if (peekAt(p, end, 0) == '/') {
+                    ++p;
+                    if (!resolveIndex(parseInt(p, end), chunk.normals.size() / 3, corner.normal, true, chunk, slot + 1)) {
+                        return false;
+                    }
+                    skipIndex(p, end);
+                }
+            }
+        }
+
+        chunk.faceCorners.push_back(corner);
+        return true;
+    }
+
+    bool parseLine(const char* p, const char* end, Chunk& chunk) {
+        skipSpaces(p, end);
+        if (p == end || *p == '#') {
+            return true;
+        }
+
+        const char c0 = p[0];
+        const char c1 = peekAt(p, end, 1);
+        const char c2 = peekAt(p, end, 2);
+
+        if (c0 == 'v' && isSpace(c1)) {
+            p += 2;
+            float x = parseFloat(p, end);
+            float y = parseFloat(p, end);
+            float z = parseFloat(p, end);
+            chunk.positions.push_back(x);
+            chunk.positions.push_back(y);
+            chunk.positions.push_back(z);
+        } else if (c0 == 'v' && c1 == 'n' && isSpace(c2)) {
+            p += 3;
+            float x = parseFloat(p, end);
+            float y = parseFloat(p, end);
+            float z = parseFloat(p, end);
+            chunk.normals.push_back(x);
+            chunk.normals.push_back(y);
+            chunk.normals.push_back(z);
+        } else if (c0 == 'v' && c1 == 't' && isSpace(c2)) {
+            p += 3;
+            float u = parseFloat(p, end);
+            float v = parseFloat(p, end);
+            chunk.texCoords.push_back(u);
+            chunk.texCoords.push_back(v);
+        } else if (c0 == 'f' && isSpace(c1)) {
+            p += 2;
+            skipSpaces(p, end);
+
+            unsigned int cornerCount = 0;
+            while (p < end) {
+                if (!parseFaceCorner(p, end, chunk)) {
+                    chunk.error = "Failed to parse 'f' line (zero or invalid vertex index)";
+                    return false;
+                }
+                ++cornerCount;
+                skipSpaces(p, end);
+            }
+            chunk.faceSizes.push_back(cornerCount);
+        }
+
+        // Groups, materials, smoothing groups etc. don't affect the triangle stream
+        return true;
+    }
+
+    void tokenizeChunk(Chunk& chunk) {
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* lineEnd = p;
+            while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r') {
+                ++lineEnd;
+            }
+
+            ++chunk.lineCount;
+            if (!parseLine(p, lineEnd, chunk)) {
+                chunk.errorLine = chunk.lineCount;
+                return;
+            }
+
+            // "\n", "\r\n" and a lone "\r" each end one line
+            p = lineEnd;
+            if (p < chunk.end && *p == '\r') {
+                ++p;
+            }
+            if (p < chunk.end && *p == '\n') {
+                ++p;
+            }
+        }
+    }
+
+    inline bool hasPosition(int index, const std::vector<float>& positions) {
+        return 3 * size_t(index) + 2 < positions.size();
+    }
+
+    // Point-in-triangle test used by tinyobj's ear clipper
+    int pointInTriangle(const float* vx, const float* vy, float tx, float ty) {
+        int inside = 0;
+        for (int i = 0, j = 2; i < 3; j = i++) {
+            if (((vy[i] > ty) != (vy[j] > ty)) &&
+                (tx < (vx[j] - vx[i]) * (ty - vy[i]) / (vy[j] - vy[i]) + vx[i])) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    // Mirrors tinyobj's built-in triangulation: quads split along the shorter diagonal,
+    // larger polygons are ear clipped in the dominant projection plane
+    void triangulateFace(const Corner* face, size_t cornerCount, const std::vector<float>& v, std::vector<Corner>& out) {
+        if (cornerCount < 3) {
+            return;
+        }
+
+        if (cornerCount == 3) {
+            out.insert(out.end(), face, face + 3);
+            return;
+        }
+
+        if (cornerCount == 4) {
+            for (size_t k = 0; k < 4; ++k) {
+                if (!hasPosition(face[k].position, v)) {
+                    return;
+                }
+            }
+
+            const float* v0 = &v[3 * face[0].position];
+            const float* v1 = &v[3 * face[1].position];
+            const float* v2 = &v[3 * face[2].position];
+            const float* v3 = &v[3 * face[3].position];
+
+            float e02x = v2[0] - v0[0];
+            float e02y = v2[1] - v0[1];
+            float e02z = v2[2] - v0[2];
+            float e13x = v3[0] - v1[0];
+            float e13y = v3[1] - v1[1];
+            float e13z = v3[2] - v1[2];
+            float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+            float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+            if (sqr02 < sqr13) {
+                const Corner split[6] = { face[0], face[1], face[2], face[0], face[2], face[3] };
+                out.insert(out.end(), split, split + 6);
+            } else {
+                const Corner split[6] = { face[0], face[1], face[3], face[1], face[2], face[3] };
+                out.insert(out.end(), split, split + 6);
+            }
+            return;
+        }
+
+        // Find the two axes to work in
+        size_t axes[2] = { 1, 2 };
+        for (size_t k = 0; k < cornerCount; ++k) {
+            const Corner& i0 = face[(k + 0) % cornerCount];
+            const Corner& i1 = face[(k + 1) % cornerCount];
+            const Corner& i2 = face[(k + 2) % cornerCount];
+            if (!hasPosition(i0.position, v) || !hasPosition(i1.position, v) || !hasPosition(i2.position, v)) {
+                continue;
+            }
+
+            const float* p0 = &v[3 * size_t(i0.position)];
+            const float* p1 = &v[3 * size_t(i1.position)];
+            const float* p2 = &v[3 * size_t(i2.position)];
+            float e0x = p1[0] - p0[0];
+            float e0y = p1[1] - p0[1];
+            float e0z = p1[2] - p0[2];
+            float e1x = p2[0] - p1[0];
+            float e1y = p2[1] - p1[1];
+            float e1z = p2[2] - p1[2];
+            float cx = std::fabs(e0y * e1z - e0z * e1y);
+            float cy = std::fabs(e0z * e1x - e0x * e1z);
+            float cz = std::fabs(e0x * e1y - e0y * e1x);
+            const float epsilon = std::numeric_limits<float>::epsilon();
+            if (cx > epsilon || cy > epsilon || cz > epsilon) {
+                if (!(cx > cy && cx > cz)) {
+                    axes[0] = 0;
+                    if (cz > cx && cz > cy) {
+                        axes[1] = 1;
+                    }
+                }
+                break;
+            }
+        }
+
+        std::vector<Corner> remaining(face, face + cornerCount);
+        size_t guess = 0;
+        Corner ind[3];
+        float vx[3];
+        float vy[3];
+
+        size_t remainingIterations = cornerCount;
+        size_t previousRemaining = remaining.size();
+
+        while (remaining.size() > 3 && remainingIterations > 0) {
+            const size_t count = remaining.size();
+            if (guess >= count) {
+                guess -= count;
+            }
+
+            if (previousRemaining != count) {
+                previousRemaining = count;
+                remainingIterations = count;
+            } else {
+                remainingIterations--;
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                ind[k] = remaining[(guess + k) % count];
+                size_t vi = size_t(ind[k].position);
+                if (vi * 3 + axes[0] >= v.size() || vi * 3 + axes[1] >= v.size()) {
+                    vx[k] = 0.0f;
+                    vy[k] = 0.0f;
+                } else {
+                    vx[k] = v[vi * 3 + axes[0]];
+                    vy[k] = v[vi * 3 + axes[1]];
+                }
+            }
+
+            float e0x = vx[1] - vx[0];
+            float e0y = vy[1] - vy[0];
+            float e1x = vx[2] - vx[1];
+            float e1y = vy[2] - vy[1];
+            float cross = e0x * e1y - e0y * e1x;
+            float area = (vx[0] * vy[1] - vy[0] * vx[1]) * 0.5f;
+
+            // Reflex corner, try the next one
+            if (cross * area < 0.0f) {
+                guess += 1;
+                continue;
+            }
+
+            // Reject the ear if any other corner lies inside it
+            bool overlap = false;
+            for (size_t other = 3; other < count; ++other) {
+                size_t ovi = size_t(remaining[(guess + other) % count].position);
+                if (ovi * 3 + axes[0] >= v.size() || ovi * 3 + axes[1] >= v.size()) {
+                    continue;
+                }
+                if (pointInTriangle(vx, vy, v[ovi * 3 + axes[0]], v[ovi * 3 + axes[1]])) {
+                    overlap = true;
+                    break;
+                }
+            }
+
+            if (overlap) {
+                guess += 1;
+                continue;
+            }
+
+            out.insert(out.end(), ind, ind + 3);
+            remaining.erase(remaining.begin() + (guess + 1) % count);
+        }
+
+        if (remaining.size() == 3) {
+            out.insert(out.end(), remaining.begin(), remaining.end());
+        }
+    }
+
+    // Face corner attributes used as the welding key
+    struct WeldKey {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoord;
+
+        bool operator==(const WeldKey& other) const {
+            return std::memcmp(this, &other, sizeof(WeldKey)) == 0;
+        }
+    };
+
+    // Hashes the raw attribute bits, consistent with the bitwise operator==
+    struct WeldKeyHash {
+        size_t operator()(const WeldKey& key) const {
+            return static_cast<size_t>(hashBytes(&key, sizeof(WeldKey)));
+        }
+    };
+}
+
+bool ObjParser::parse(const std::string& filePath, Result& result, ThreadPool& pool, size_t maxThreads) {
+    MappedFile file;
+    if (!file.open(filePath)) {
+        std::cerr << "Failed to open OBJ file: " << filePath << std::endl;
+        return false;
+    }
+
+    std::string error;
+    if (!parseBuffer(reinterpret_cast<const char*>(file.data()), file.size(), result, pool, maxThreads, error)) {
+        std::cerr << "Failed to parse " << filePath << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ObjParser::parseBuffer(const char* data, size_t size, Result& result, ThreadPool& pool, size_t maxThreads,
+    std::string& error) {
+    result = Result();
+
+    // Split into line-aligned chunks
+    size_t threadCount = pool.getThreadCount() + 1;
+    if (maxThreads > 0) {
+        threadCount = std::min(threadCount, maxThreads);
+    }
+    size_t chunkCount = std::max<size_t>(1, std::min(size / MinChunkSize, threadCount * ChunksPerThread));
+
+    std::vector<Chunk> chunks(chunkCount);
+    const char* chunkBegin = data;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const char* chunkEnd = data + size;
+        if (i + 1 < chunkCount) {
+            const char* split = std::max(chunkBegin, data + size * (i + 1) / chunkCount);
+            const void* newline = std::memchr(split, '\n', static_cast<size_t>(data + size - split));
+            chunkEnd = newline ? static_cast<const char*>(newline) + 1 : data + size;
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // Tokenize every chunk independently
+    pool.parallelFor(chunkCount, [&chunks](size_t i) { tokenizeChunk(chunks[i]); }, maxThreads);
+
+    // Prefix sums give each chunk its global attribute offsets
+    size_t positionCount = 0, normalCount = 0, texCoordCount = 0, lineBase = 0;
+    for (Chunk& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            error = chunk.error + " (line " + std::to_string(lineBase + chunk.errorLine) + ")";
+            return false;
+        }
+        chunk.positionBase = positionCount;
+        chunk.normalBase = normalCount;
+        chunk.texCoordBase = texCoordCount;
+        positionCount += chunk.positions.size();
+        normalCount += chunk.normals.size();
+        texCoordCount += chunk.texCoords.size();
+        lineBase += chunk.lineCount;
+    }
+
+    result.positions.resize(positionCount);
+    result.normals.resize(normalCount);
+    result.texCoords.resize(texCoordCount);
+
+    pool.parallelFor(chunkCount, [&chunks, &result](size_t i) {
+        Chunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), result.positions.begin() + chunk.positionBase);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), result.normals.begin() + chunk.normalBase);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), result.texCoords.begin() + chunk.texCoordBase);
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.normals);
+        std::vector<float>().swap(chunk.texCoords);
+    }, maxThreads);
+
+    // Resolve relative indices, then triangulate against the merged positions
+    pool.parallelFor(chunkCount, [&chunks, &result](size_t i) {
+        Chunk& chunk = chunks[i];
+        const int bases[3] = {
+            static_cast<int>(chunk.positionBase / 3),
+            static_cast<int>(chunk.normalBase / 3),
+            static_cast<int>(chunk.texCoordBase / 2)
+        };
+
+        for (size_t slot : chunk.relativeSlots) {
+            Corner& corner = chunk.faceCorners[slot / 3];
+            int* components[3] = { &corner.position, &corner.normal, &corner.texCoord };
+            int& index = *components[slot % 3];
+            index += bases[slot % 3];
+            if (index < 0) {
+                chunk.error = "Invalid relative index in 'f' line";
+                return;
+            }
+        }
+
+        chunk.triangles.reserve(chunk.faceCorners.size() * 2);
+        const Corner* face = chunk.faceCorners.data();
+        for (unsigned int faceSize : chunk.faceSizes) {
+            triangulateFace(face, faceSize, result.positions, chunk.triangles);
+            face += faceSize;
+        }
+        std::vector<Corner>().swap(chunk.faceCorners);
+    }, maxThreads);
+
+    size_t cornerCount = 0;
+    std::vector<size_t> cornerBases(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        if (!chunks[i].error.empty()) {
+            error = chunks[i].error;
+            return false;
+        }
+        cornerBases[i] = cornerCount;
+        cornerCount += chunks[i].triangles.size();
+    }
+
+    result.corners.resize(cornerCount);
+    pool.parallelFor(chunkCount, [&chunks, &cornerBases, &result](size_t i) {
+        std::copy(chunks[i].triangles.begin(), chunks[i].triangles.end(), result.corners.begin() + cornerBases[i]);
+    }, maxThreads);
+
+    return true;
+}
+
+bool ObjParser::weld(const Result& result, MeshData& mesh) {
+    mesh.clear();
+
+    // Weld identical face corners into unique vertices so the EBO actually shares them
+    std::unordered_map<WeldKey, unsigned int, WeldKeyHash> uniqueVertices;
+    uniqueVertices.reserve(result.corners.size());
+    mesh.indices.reserve(result.corners.size());
+
+    for (const Corner& corner : result.corners) {
+        if (corner.position < 0 || 3 * size_t(corner.position) + 2 >= result.positions.size() ||
+            3 * size_t(corner.normal + 1) > result.normals.size() ||
+            2 * size_t(corner.texCoord + 1) > result.texCoords.size()) {
+            std::cerr << "OBJ face references a missing vertex attribute" << std::endl;
+            mesh.clear();
+            return false;
+        }
+
+        WeldKey key;
+        key.position = glm::vec3(
+            result.positions[3 * corner.position + 0],
+            result.positions[3 * corner.position + 1],
+            result.positions[3 * corner.position + 2]
+        );
+
+        key.texCoord = glm::vec2(0.0f);
+        if (corner.texCoord >= 0) {
+            key.texCoord = glm::vec2(
+                result.texCoords[2 * corner.texCoord + 0],
+                1.0f - result.texCoords[2 * corner.texCoord + 1]
+            );
+        }
+
+        key.normal = glm::vec3(0.0f);
+        if (corner.normal >= 0) {
+            key.normal = glm::vec3(
+                result.normals[3 * corner.normal + 0],
+                result.normals[3 * corner.normal + 1],
+                result.normals[3 * corner.normal + 2]
+            );
+        }
+
+        auto inserted = uniqueVertices.emplace(key, static_cast<unsigned int>(mesh.positions.size()));
+        if (inserted.second) {
+            mesh.positions.push_back(key.position);
+            mesh.texCoords.push_back(key.texCoord);
+            mesh.normals.push_back(key.normal);
+        }
+
+        mesh.indices.push_back(inserted.first->second);
+    }
+
+    return true;
+}
+
+bool ObjParser::runSelfTest(const std::string& directory) {
+    std::vector<std::string> files = listFiles(directory, ".obj", true);
+    if (files.empty()) {
+        std::cerr << "No OBJ files found under " << directory << std::endl;
+        return false;
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    const size_t maxThreads = pool.getThreadCount() + 1;
+    const int runs = 3;
+    size_t failedCount = 0;
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& path : files) {
+        // Reference: tinyobj, flattened across shapes in file order
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        double referenceTime = std::numeric_limits<double>::max();
+        bool referenceLoaded = false;
+        for (int run = 0; run < runs; ++run) {
+            attrib = tinyobj::attrib_t();
+            shapes.clear();
+            materials.clear();
+            auto start = std::chrono::high_resolution_clock::now();
+            referenceLoaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
+            referenceTime = std::min(referenceTime, millisecondsSince(start));
+        }
+
+        Result result;
+        bool parsed = parse(path, result, pool);
+
+        std::string mismatch;
+        if (!referenceLoaded || !parsed) {
+            if (referenceLoaded != parsed) {
+                mismatch = parsed ? "tinyobj failed to load" : "parser failed to load";
+            }
+        } else if (result.positions.size() != attrib.vertices.size() ||
+            std::memcmp(result.positions.data(), attrib.vertices.data(), result.positions.size() * sizeof(float)) != 0) {
+            mismatch = "positions differ";
+        } else if (result.normals.size() != attrib.normals.size() ||
+            std::memcmp(result.normals.data(), attrib.normals.data(), result.normals.size() * sizeof(float)) != 0) {
+            mismatch = "normals differ";
+        } else if (result.texCoords.size() != attrib.texcoords.size() ||
+            std::memcmp(result.texCoords.data(), attrib.texcoords.data(), result.texCoords.size() * sizeof(float)) != 0) {
+            mismatch = "texcoords differ";
+        } else {
+            size_t corner = 0;
+            for (const auto& shape : shapes) {
+                for (const auto& index : shape.mesh.indices) {
+                    if (corner >= result.corners.size() ||
+                        result.corners[corner].position != index.vertex_index ||
+                        result.corners[corner].normal != index.normal_index ||
+                        result.corners[corner].texCoord != index.texcoord_index) {
+                        mismatch = "face corner " + std::to_string(corner) + " differs";
+                        break;
+                    }
+                    ++corner;
+                }
+                if (!mismatch.empty()) {
+                    break;
+                }
+            }
+            if (mismatch.empty() && corner != result.corners.size()) {
+                mismatch = "triangle counts differ";
+            }
+        }
+
+        if (!mismatch.empty()) {
+            std::cout << "[FAIL] " << path << ": " << mismatch << std::endl;
+            ++failedCount;
+            continue;
+        }
+
+        std::cout << "[PASS] " << path << " (" << result.corners.size() / 3 << " triangles)" << std::endl;
+        std::cout << "       tinyobj " << referenceTime << " ms";
+
+        double singleThreadTime = 0.0;
+        for (size_t threads : threadCounts) {
+            double bestTime = std::numeric_limits<double>::max();
+            for (int run = 0; run < runs; ++run) {
+                auto start = std::chrono::high_resolution_clock::now();
+                parse(path, result, pool, threads);
+                bestTime = std::min(bestTime, millisecondsSince(start));
+            }
+            if (threads == 1) {
+                singleThreadTime = bestTime;
+            }
+            std::cout << " | " << threads << "T " << bestTime << " ms (x" << singleThreadTime / bestTime << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    if (failedCount == 0) {
+        std::cout << "OBJ parser matches tinyobj on all " << files.size() << " files" << std::endl;
+    } else {
+        std::cout << "OBJ parser mismatches in " << failedCount << " of " << files.size() << " files" << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    return failedCount == 0;
+}
@@ -0,0 +1,44 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+class ThreadPool;
+
+// Multithreaded OBJ reader. The file is memory-mapped and split into line-aligned
+// chunks that are tokenized in parallel; relative indices are fixed up once the
+// per-chunk attribute counts are known, then faces are triangulated in parallel.
+// Output matches tinyobj::LoadObj (triangulate on) corner for corner and bit for bit.
+class ObjParser {
+public:
+    // One triangle corner, same convention as tinyobj::index_t (-1 = attribute absent)
+    struct Corner {
+        int position;
+        int normal;
+        int texCoord;
+    };
+
+    struct Result {
+        std::vector<float> positions; // xyz per "v"
+        std::vector<float> normals;   // xyz per "vn"
+        std::vector<float> texCoords; // uv per "vt"
+        std::vector<Corner> corners;  // three per triangle, in file order
+    };
+
+    // maxThreads of 0 uses every thread of the pool
+    static bool parse(const std::string& filePath, Result& result, ThreadPool& pool, size_t maxThreads = 0);
+    static bool parseBuffer(const char* data, size_t size, Result& result, ThreadPool& pool, size_t maxThreads,
+        std::string& error);
+
+    // Welds identical corners into unique vertices (V flipped for GL) with a triangle index buffer
+    static bool weld(const Result& result, MeshData& mesh);
+
+    // Parses every .obj under the directory with both this parser and tinyobj, checks the
+    // results are identical and prints the thread scaling. Returns false on any mismatch.
+    static bool runSelfTest(const std::string& directory);
+};
+
+#endif
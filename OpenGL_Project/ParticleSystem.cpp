@@ -1,4 +1,6 @@
 #include "ParticleSystem.h"
+#include "ShaderLoader.h"
+#include "ProgramUniforms.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -16,6 +18,9 @@ ParticleSystem::ParticleSystem(const std::string& computeShaderPath, const std::
     {
         std::cerr << "Compute Shader Program creation failed!" << std::endl;
     }
+    ProgramUniforms& computeUniforms = ProgramUniforms::get(computeShaderProgram);
+    deltaTimeUniform = computeUniforms.find("uDeltaTime");
+    maxParticlesUniform = computeUniforms.find("uMaxParticles");
 
     renderShaderProgram = createShaderProgram(nullptr, vertexShaderSource.c_str(), fragmentShaderSource.c_str());
     if (!renderShaderProgram)
@@ -26,6 +31,8 @@ ParticleSystem::ParticleSystem(const std::string& computeShaderPath, const std::
 
 ParticleSystem::~ParticleSystem()
 {
+    ProgramUniforms::release(computeShaderProgram);
+    ProgramUniforms::release(renderShaderProgram);
     glDeleteProgram(computeShaderProgram);
     glDeleteProgram(renderShaderProgram);
     glDeleteBuffers(1, &particleBuffer);
@@ -71,8 +78,9 @@ void ParticleSystem::init()
 void ParticleSystem::update(float deltaTime)
 {
     glUseProgram(computeShaderProgram);
-    glUniform1f(glGetUniformLocation(computeShaderProgram, "uDeltaTime"), deltaTime);
-    glUniform1ui(glGetUniformLocation(computeShaderProgram, "uMaxParticles"), maxParticles);
+    ProgramUniforms& computeUniforms = ProgramUniforms::get(computeShaderProgram);
+    computeUniforms.set(deltaTimeUniform, deltaTime);
+    computeUniforms.set(maxParticlesUniform, static_cast<GLuint>(maxParticles));
     glDispatchCompute((GLuint)(maxParticles / 256) + 1, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
     std::cout << "Current Particle Count: " << maxParticles << std::endl;
@@ -82,8 +90,9 @@ void ParticleSystem::update(float deltaTime)
 void ParticleSystem::render(const glm::mat4& view, const glm::mat4& projection)
 {
     glUseProgram(renderShaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(renderShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(renderShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    ProgramUniforms& renderUniforms = ProgramUniforms::get(renderShaderProgram);
+    renderUniforms.set(ProgramUniforms::View, view);
+    renderUniforms.set(ProgramUniforms::Projection, projection);
 
     glBindVertexArray(vao);
     glDrawArrays(GL_POINTS, 0, maxParticles);
@@ -111,82 +120,23 @@ std::string ParticleSystem::readShaderSourceFromFile(const std::string& shaderFi
     return shaderCode;
 }
 
-GLuint ParticleSystem::compileShader(const char* shaderSource, GLenum shaderType)
-{
-    GLuint shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, &shaderSource, nullptr);
-    glCompileShader(shader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
-        glDeleteShader(shader);
-        return 0;
-    }
-    return shader;
-}
-
 GLuint ParticleSystem::createShaderProgram(const char* computeShaderSource, const char* vertexShaderSource, const char* fragmentShaderSource)
 {
-    GLuint computeShader, vertexShader, fragmentShader;
-
-    if (computeShaderSource)
-    {
-        computeShader = compileShader(computeShaderSource, GL_COMPUTE_SHADER);
-    }
-    if (vertexShaderSource)
-    {
-        vertexShader = compileShader(vertexShaderSource, GL_VERTEX_SHADER);
-    }
-    if (fragmentShaderSource)
-    {
-        fragmentShader = compileShader(fragmentShaderSource, GL_FRAGMENT_SHADER);
-    }
-
-    GLuint shaderProgram = glCreateProgram();
+    // Compiled by the ShaderLoader so the program binary cache covers it too
+    std::vector<ShaderSource> stages;
     if (computeShaderSource)
     {
-        glAttachShader(shaderProgram, computeShader);
+        stages.push_back({ GL_COMPUTE_SHADER, computeShaderSource });
     }
     if (vertexShaderSource)
     {
-        glAttachShader(shaderProgram, vertexShader);
+        stages.push_back({ GL_VERTEX_SHADER, vertexShaderSource });
     }
     if (fragmentShaderSource)
     {
-        glAttachShader(shaderProgram, fragmentShader);
-    }
-    glLinkProgram(shaderProgram);
-
-    int success;
-    char infoLog[512];
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-        glDeleteProgram(shaderProgram);
-        shaderProgram = 0;
-    }
-
-    if (computeShaderSource)
-    {
-        glDeleteShader(computeShader);
+        stages.push_back({ GL_FRAGMENT_SHADER, fragmentShaderSource });
     }
-    if (vertexShaderSource)
-    {
-        glDeleteShader(vertexShader);
-    }
-    if (fragmentShaderSource)
-    {
-        glDeleteShader(fragmentShader);
-    }
-
-    return shaderProgram;
+    return ShaderLoader().CreateProgramFromSources(stages, computeShaderSource ? "particle compute" : "particle render");
 }
 
 void ParticleSystem::triggerFirework(const glm::vec3& position, const glm::vec4& color) {
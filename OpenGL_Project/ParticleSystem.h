@@ -6,6 +6,7 @@
 #include <glew.h>
 #include <string>
 #include <mutex>
+#include "ProgramUniforms.h"
 
 class ParticleSystem
 {
@@ -32,7 +33,7 @@ public:
 
 private:
     GLuint computeShaderProgram;
-    GLuint compileShader(const char* shaderSource, GLenum shaderType);
+    ProgramUniforms::Handle deltaTimeUniform, maxParticlesUniform;
     GLuint createShaderProgram(const char* computeShaderSource, const char* vertexShaderSource, const char* fragmentShaderSource);
     std::string readShaderSourceFromFile(const std::string& shaderFilePath);
 
@@ -2,6 +2,8 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include "PerlinNoiseScene.h"
+#include "AssetLoader.h"
+#include "ProgramUniforms.h"
 #include <iostream>
 #include <fstream>
 #include <ctime>
@@ -15,6 +17,8 @@ PerlinNoiseScene::PerlinNoiseScene(ShaderLoader& shaderLoader, Camera& camera)
     : m_shaderLoader(shaderLoader), m_camera(camera), m_time(0.0f) {
     m_terrainShaderProgram = m_shaderLoader.CreateProgram("perlin_vertex_shader.txt", "perlin_fragment_shader.txt");
     m_2dNoiseShaderProgram = m_shaderLoader.CreateProgram("2d_perlin_vertex_shader.txt", "2d_perlin_fragment_shader.txt");
+    m_perlinTextureUniform = ProgramUniforms::get(m_terrainShaderProgram).find("perlinTexture");
+    m_timeUniform = ProgramUniforms::get(m_2dNoiseShaderProgram).find("time");
     initializeNoise();
 }
 
@@ -164,27 +168,11 @@ void PerlinNoiseScene::generateTerrainMesh() {
 }
 
 void PerlinNoiseScene::loadTerrainTexture() {
-    generateAndSavePerlinNoiseImage("perlin_noise_texture.jpg", "perlin_noise_heightmap.raw");
-
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("perlin_noise_texture.jpg", &width, &height, &nrChannels, 0);
-
-    if (data) {
-        glGenTextures(1, &m_terrainTexture);
-        glBindTexture(GL_TEXTURE_2D, m_terrainTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else {
-        std::cerr << "Failed to load texture" << std::endl;
-    }
+    // Noise generation, JPG encode and decode run on a worker (the permutation table is read-only by now)
+    m_terrainTexture = TextureCache::instance().loadGenerated("perlin_noise_texture", TextureParams(), [this](std::vector<ImageData>& faces) {
+        generateAndSavePerlinNoiseImage("perlin_noise_texture.jpg", "perlin_noise_heightmap.raw");
+        return AssetLoader::decodeImage("perlin_noise_texture.jpg", false, faces[0]);
+    });
 }
 
 void PerlinNoiseScene::setup2DQuad() {
@@ -236,13 +224,14 @@ void PerlinNoiseScene::render() {
     glm::mat4 view = m_camera.GetViewMatrix();
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 
-    glUniformMatrix4fv(glGetUniformLocation(m_terrainShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(glGetUniformLocation(m_terrainShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(m_terrainShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    ProgramUniforms& terrainUniforms = ProgramUniforms::get(m_terrainShaderProgram);
+    terrainUniforms.set(ProgramUniforms::Model, model);
+    terrainUniforms.set(ProgramUniforms::View, view);
+    terrainUniforms.set(ProgramUniforms::Projection, projection);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_terrainTexture);
-    glUniform1i(glGetUniformLocation(m_terrainShaderProgram, "perlinTexture"), 0);
+    glBindTexture(GL_TEXTURE_2D, m_terrainTexture->getID());
+    terrainUniforms.set(m_perlinTextureUniform, 0);
 
     glBindVertexArray(m_terrainVAO);
     glDrawElements(GL_TRIANGLES, (128 - 1) * (128 - 1) * 6, GL_UNSIGNED_INT, 0);
@@ -252,7 +241,8 @@ void PerlinNoiseScene::render() {
     glUseProgram(m_2dNoiseShaderProgram);
 
     // Update the time uniform
-    glUniform1f(glGetUniformLocation(m_2dNoiseShaderProgram, "time"), m_time);
+    ProgramUniforms& noiseUniforms = ProgramUniforms::get(m_2dNoiseShaderProgram);
+    noiseUniforms.set(m_timeUniform, m_time);
 
     glBindVertexArray(m_2dQuadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
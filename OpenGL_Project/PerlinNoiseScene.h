@@ -3,9 +3,12 @@
 
 #include "ShaderLoader.h"
 #include "Camera.h"
+#include "TextureCache.h"
+#include "ProgramUniforms.h"
 #include <glew.h>
 #include <glfw3.h>
 #include "Dependencies/glm/glm.hpp"
+#include <memory>
 #include <vector>
 
 class PerlinNoiseScene {
@@ -20,9 +23,10 @@ private:
     Camera& m_camera;
     GLuint m_terrainShaderProgram;
     GLuint m_2dNoiseShaderProgram;
+    ProgramUniforms::Handle m_perlinTextureUniform, m_timeUniform;
     GLuint m_terrainVAO, m_terrainVBO, m_terrainEBO;
     GLuint m_2dQuadVAO, m_2dQuadVBO;
-    GLuint m_terrainTexture;
+    std::shared_ptr<const CachedTexture> m_terrainTexture;
     GLuint m_2dNoiseTexture;
     std::vector<int> p;
     float m_time;
@@ -1,50 +1,39 @@
 #include "Plane.h"
+#include "ProgramUniforms.h"
 
 Plane::Plane() : ModelLoader("") {}
 
 void Plane::loadPlane() {
-    // Define plane vertices (positions, normals, texcoords)
-    float planeVertices[] = {
-        // positions            // normals         // texcoords
-        500.0f, 0.0f,  500.0f, 0.0f, 1.0f, 0.0f,  50.0f, 0.0f,
-       -500.0f, 0.0f,  500.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-       -500.0f, 0.0f, -500.0f, 0.0f, 1.0f, 0.0f,  0.0f, 50.0f,
-
-        500.0f, 0.0f,  500.0f, 0.0f, 1.0f, 0.0f,  50.0f, 0.0f,
-       -500.0f, 0.0f, -500.0f, 0.0f, 1.0f, 0.0f,  0.0f, 50.0f,
-        500.0f, 0.0f, -500.0f, 0.0f, 1.0f, 0.0f,  50.0f, 50.0f
+    // Two triangles over four shared corners (positions, normals, texcoords)
+    MeshData planeData;
+    planeData.positions = {
+        glm::vec3( 500.0f, 0.0f,  500.0f),
+        glm::vec3(-500.0f, 0.0f,  500.0f),
+        glm::vec3(-500.0f, 0.0f, -500.0f),
+        glm::vec3( 500.0f, 0.0f, -500.0f)
     };
+    planeData.normals.assign(4, glm::vec3(0.0f, 1.0f, 0.0f));
+    planeData.texCoords = {
+        glm::vec2(50.0f, 0.0f),
+        glm::vec2(0.0f, 0.0f),
+        glm::vec2(0.0f, 50.0f),
+        glm::vec2(50.0f, 50.0f)
+    };
+    planeData.indices = { 0, 1, 2, 0, 2, 3 };
 
-    // Set up buffers
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-
-    // Positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // TexCoords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
+    // Every Plane instance shares one set of buffers
+    mesh = MeshRegistry::instance().create("procedural:plane", planeData);
 }
 
 void Plane::render(GLuint shaderProgram, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
-    glBindVertexArray(VAO);
-
     // Optionally pass matrices to the shader if needed
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    ProgramUniforms& uniforms = ProgramUniforms::get(shaderProgram);
+    uniforms.set(ProgramUniforms::ViewMatrix, viewMatrix);
+    uniforms.set(ProgramUniforms::ProjectionMatrix, projectionMatrix);
 
-    glPatchParameteri(GL_PATCH_VERTICES, 3);  // Ensure triangle patches for tessellation
-    glDrawArrays(GL_PATCHES, 0, 6);  // Draw 6 vertices forming 2 triangles (1 patch)
+    mesh->applyVertexDecode(shaderProgram);
 
-    glBindVertexArray(0);
+    glPatchParameteri(GL_PATCH_VERTICES, 3);  // Ensure triangle patches for tessellation
+    mesh->draw(GL_PATCHES);  // Draw 6 indices forming 2 triangles (2 patches)
 }
 
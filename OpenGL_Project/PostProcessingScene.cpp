@@ -1,4 +1,5 @@
 #include "PostProcessingScene.h"
+#include "ProgramUniforms.h"
 #include "Dependencies/glm/gtc/matrix_transform.hpp"
 #include <iostream>
 #include <string>
@@ -80,6 +81,15 @@ void PostProcessingScene::loadShaders() {
     effectShaders.push_back(shaderLoader.CreateProgram("Resources/Shaders/post_processing.vert", "Resources/Shaders/greyscale.frag"));
     effectShaders.push_back(shaderLoader.CreateProgram("Resources/Shaders/post_processing.vert", "Resources/Shaders/raining.frag"));
     effectShaders.push_back(shaderLoader.CreateProgram("Resources/Shaders/post_processing.vert", "Resources/Shaders/sobel.frag"));
+
+    for (GLuint program : effectShaders) {
+        ProgramUniforms& uniforms = ProgramUniforms::get(program);
+        EffectUniforms handles;
+        handles.screenTexture = uniforms.find("screenTexture");
+        handles.time = uniforms.find("time");
+        handles.resolution = uniforms.find("resolution");
+        effectUniforms.push_back(handles);
+    }
 }
 
 void PostProcessingScene::render(int currentEffect) {
@@ -101,7 +111,7 @@ void PostProcessingScene::render(int currentEffect) {
     glm::mat4 modelMatrix = glm::mat4(1.0f);
     float rotationAngle = glm::radians(glfwGetTime() * 20.0f);
     modelMatrix = glm::rotate(modelMatrix, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
+    ProgramUniforms::get(shaderProgram).set(ProgramUniforms::Model, modelMatrix);
     //glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &camera.getViewMatrix()[0][0]);
     //glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &camera.getProjectionMatrix()[0][0]);
     mineRenderer.render(shaderProgram, modelMatrix);
@@ -109,13 +119,13 @@ void PostProcessingScene::render(int currentEffect) {
     // Render the cannon
     modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, 0.0f, 0.0f));
     modelMatrix = glm::rotate(modelMatrix, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
+    ProgramUniforms::get(shaderProgram).set(ProgramUniforms::Model, modelMatrix);
     cannonRenderer.render(shaderProgram, modelMatrix);
 
     // Render the alien
     modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-20.0f, 0.0f, 0.0f));
     modelMatrix = glm::rotate(modelMatrix, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
+    ProgramUniforms::get(shaderProgram).set(ProgramUniforms::Model, modelMatrix);
     alienRenderer.render(shaderProgram, modelMatrix);
 
     // Unbind the framebuffer
@@ -131,9 +141,11 @@ void PostProcessingScene::render(int currentEffect) {
 void PostProcessingScene::applyEffect(GLuint textureId, int effectId) {
     glBindVertexArray(quadVAO);
     glUseProgram(effectShaders[effectId]);
-    glUniform1i(glGetUniformLocation(effectShaders[effectId], "screenTexture"), 0);
-    glUniform1f(glGetUniformLocation(effectShaders[effectId], "time"), static_cast<float>(glfwGetTime()));
-    glUniform2f(glGetUniformLocation(effectShaders[effectId], "resolution"), 800.0f, 600.0f);  // Replace with actual width and height if different
+    ProgramUniforms& uniforms = ProgramUniforms::get(effectShaders[effectId]);
+    const EffectUniforms& handles = effectUniforms[effectId];
+    uniforms.set(handles.screenTexture, 0);
+    uniforms.set(handles.time, static_cast<float>(glfwGetTime()));
+    uniforms.set(handles.resolution, glm::vec2(800.0f, 600.0f));  // Replace with actual width and height if different
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, textureId);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -4,6 +4,7 @@
 #include "Camera.h"
 #include "Skybox.h" 
 #include "InstancedRenderer.h"
+#include "ProgramUniforms.h"
 #include <glew.h>
 #include <vector>
 
@@ -30,6 +31,12 @@ private:
 
     GLuint quadVAO, quadVBO;
     std::vector<GLuint> effectShaders;
+
+    // Uniform handles of each effect program, by effect
+    struct EffectUniforms {
+        ProgramUniforms::Handle screenTexture, time, resolution;
+    };
+    std::vector<EffectUniforms> effectUniforms;
     int currentEffect;
 
     GLuint shaderProgram;  // Base shader program used for rendering the scene
@@ -0,0 +1,152 @@
+#include "ProgramBinaryCache.h"
+#include "FileUtils.h"
+#include "HashUtils.h"
+#include "TimeUtils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const char* ProgramDirectory = "Resources/Cache/Programs";
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format; // Driver's binary format enum
+        uint32_t length;
+    };
+
+    std::string getString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+}
+
+ProgramBinaryCache& ProgramBinaryCache::instance() {
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+bool ProgramBinaryCache::isAvailable() {
+    if (!initialized) {
+        initialized = true;
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        available = formats > 0;
+        driver = getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+        if (!available) {
+            std::cout << "Program binary cache unavailable (needs GL 4.1 or ARB_get_program_binary), compiling shaders from source" << std::endl;
+        }
+    }
+    return available;
+}
+
+uint64_t ProgramBinaryCache::getKey(const std::vector<ShaderSource>& stages) const {
+    uint64_t key = hashString(driver);
+    for (const ShaderSource& stage : stages) {
+        key = hashBytes(&stage.type, sizeof(stage.type), key);
+        const uint64_t length = stage.source.size();
+        key = hashBytes(&length, sizeof(length), key);
+        key = hashString(stage.source, key);
+    }
+    return key;
+}
+
+std::string ProgramBinaryCache::getPath(uint64_t key) {
+    std::ostringstream name;
+    name << ProgramDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return name.str();
+}
+
+GLuint ProgramBinaryCache::load(const std::vector<ShaderSource>& stages) {
+    if (!isAvailable()) {
+        return 0;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const uint64_t key = getKey(stages);
+    const std::string path = getPath(key);
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    Header header;
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(Header)) ||
+        std::memcmp(header.magic, "PRGB", 4) != 0 || header.version != Version || header.key != key) {
+        ++stats.misses;
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) {
+        ++stats.misses;
+        return 0;
+    }
+    file.close();
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        // Drivers may refuse binaries from other builds even when the strings match
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        ++stats.rejected;
+        ++stats.misses;
+        return 0;
+    }
+
+    ++stats.hits;
+    stats.loadMilliseconds += millisecondsSince(start);
+    return program;
+}
+
+void ProgramBinaryCache::save(GLuint program, const std::vector<ShaderSource>& stages) {
+    if (!isAvailable()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    Header header;
+    std::memcpy(header.magic, "PRGB", 4);
+    header.version = Version;
+    header.key = getKey(stages);
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    makeDirectory(ProgramDirectory);
+
+    std::ostringstream buffer(std::ios::out | std::ios::binary);
+    buffer.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    buffer.write(binary.data(), length);
+
+    const std::string path = getPath(header.key);
+    if (!writeFileAtomically(path, buffer.str())) {
+        std::cerr << "Failed to write program binary: " << path << std::endl;
+    }
+}
+
+void ProgramBinaryCache::recordCompile(double milliseconds) {
+    stats.compileMilliseconds += milliseconds;
+}
+
+void ProgramBinaryCache::printStats() const {
+    std::cout << "Shader programs: " << stats.hits << " from binary cache (" << stats.loadMilliseconds << " ms), "
+        << stats.misses << " compiled from source (" << stats.compileMilliseconds << " ms";
+    if (stats.rejected > 0) {
+        std::cout << ", " << stats.rejected << " cached binaries rejected by the driver";
+    }
+    std::cout << ")" << std::endl;
+}
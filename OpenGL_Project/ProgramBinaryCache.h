@@ -0,0 +1,61 @@
+#ifndef PROGRAMBINARYCACHE_H
+#define PROGRAMBINARYCACHE_H
+
+#include <glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One stage of a program as ShaderLoader compiles it
+struct ShaderSource {
+    GLenum type;
+    std::string source;
+};
+
+// Disk cache of linked programs (glGetProgramBinary) under Resources/Cache/Programs.
+// Entries are keyed by a hash of every stage's type and source plus the driver's
+// vendor, renderer and version strings, so edited shaders and driver updates miss.
+// A binary the driver rejects is deleted and the program is compiled from source again.
+// Needs GL 4.1 or ARB_get_program_binary with at least one binary format; otherwise
+// every program compiles from source.
+class ProgramBinaryCache {
+public:
+    static const uint32_t Version = 1;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t rejected = 0; // Entries found but refused by the driver
+        double loadMilliseconds = 0.0;
+        double compileMilliseconds = 0.0;
+    };
+
+    static ProgramBinaryCache& instance();
+
+    bool isAvailable();
+
+    // Linked program from the cache, or 0 on a miss. GL thread.
+    GLuint load(const std::vector<ShaderSource>& stages);
+
+    // Stores a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT. GL thread.
+    void save(GLuint program, const std::vector<ShaderSource>& stages);
+
+    // GL-thread time spent building programs the cache could not provide
+    void recordCompile(double milliseconds);
+
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    ProgramBinaryCache() = default;
+
+    uint64_t getKey(const std::vector<ShaderSource>& stages) const;
+    static std::string getPath(uint64_t key);
+
+    bool initialized = false;
+    bool available = false;
+    std::string driver; // Vendor, renderer and version, part of every key
+    Stats stats;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "ProgramCompiler.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    void printErrorDetails(bool isShader, GLuint id, const std::string& name) {
+        GLint infoLogLength = 0;
+        isShader ? glGetShaderiv(id, GL_INFO_LOG_LENGTH, &infoLogLength) : glGetProgramiv(id, GL_INFO_LOG_LENGTH, &infoLogLength);
+        std::vector<char> log(std::max(infoLogLength, 1), '\0');
+        isShader ? glGetShaderInfoLog(id, infoLogLength, NULL, &log[0]) : glGetProgramInfoLog(id, infoLogLength, NULL, &log[0]);
+        std::cerr << "Error compiling " << (isShader ? "shader" : "program") << ": " << name << std::endl;
+        std::cerr << &log[0] << std::endl;
+    }
+}
+
+ProgramCompiler& ProgramCompiler::instance() {
+    static ProgramCompiler compiler;
+    return compiler;
+}
+
+bool ProgramCompiler::isParallel() {
+    if (!initialized) {
+        initialized = true;
+
+        // Let the driver use as many compiler threads as it likes
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallel = true;
+        } else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            parallel = true;
+        }
+    }
+    return parallel;
+}
+
+GLuint ProgramCompiler::submit(const std::vector<ShaderSource>& stages, const std::string& name) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (pending.empty()) {
+        batchStart = start;
+        batchCount = 0;
+        batchFailures = 0;
+    }
+    isParallel();
+
+    Pending entry;
+    entry.program = glCreateProgram();
+    entry.stages = stages;
+    entry.name = name;
+    for (const ShaderSource& stage : stages) {
+        GLuint shader = glCreateShader(stage.type);
+        const char* source = stage.source.c_str();
+        const GLint length = static_cast<GLint>(stage.source.size());
+        glShaderSource(shader, 1, &source, &length);
+        glCompileShader(shader);
+        glAttachShader(entry.program, shader);
+        entry.shaders.push_back(shader);
+    }
+    if (ProgramBinaryCache::instance().isAvailable()) {
+        glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Linking right away lets the driver finish the whole program in the background
+    glLinkProgram(entry.program);
+    pending.push_back(entry);
+    ++batchCount;
+
+    ProgramBinaryCache::instance().recordCompile(millisecondsSince(start));
+    return entry.program;
+}
+
+size_t ProgramCompiler::poll() {
+    if (pending.empty()) {
+        return 0;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    size_t finished = 0;
+    for (size_t i = 0; i < pending.size();) {
+        GLint complete = GL_TRUE;
+        if (parallel) {
+            glGetProgramiv(pending[i].program, GL_COMPLETION_STATUS_KHR, &complete);
+        }
+        if (complete == GL_FALSE) {
+            ++i;
+            continue;
+        }
+        resolve(pending[i]);
+        pending.erase(pending.begin() + i);
+        ++finished;
+    }
+    ProgramBinaryCache::instance().recordCompile(millisecondsSince(start));
+
+    if (finished > 0 && pending.empty()) {
+        printBatch();
+    }
+    return finished;
+}
+
+void ProgramCompiler::printBatch() const {
+    std::cout << "Built " << batchCount << " shader programs in " << millisecondsSince(batchStart) << " ms"
+        << (parallel ? " with parallel compile" : "");
+    if (batchFailures > 0) {
+        std::cout << ", " << batchFailures << " failed";
+    }
+    std::cout << std::endl;
+}
+
+bool ProgramCompiler::hasFailed(GLuint program) {
+    if (program == 0) {
+        return true;
+    }
+    auto found = std::find_if(pending.begin(), pending.end(), [program](const Pending& entry) { return entry.program == program; });
+    if (found != pending.end()) {
+        resolve(*found);
+        pending.erase(found);
+        if (pending.empty()) {
+            printBatch();
+        }
+    }
+    return failed.count(program) != 0;
+}
+
+void ProgramCompiler::resolve(const Pending& entry) {
+    bool compiled = true;
+    for (GLuint shader : entry.shaders) {
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status == GL_FALSE) {
+            printErrorDetails(true, shader, entry.name);
+            compiled = false;
+        }
+        glDetachShader(entry.program, shader);
+        glDeleteShader(shader);
+    }
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        if (compiled) {
+            printErrorDetails(false, entry.program, entry.name);
+        }
+        ++batchFailures;
+        failed.insert(entry.program);
+        return;
+    }
+    ProgramBinaryCache::instance().save(entry.program, entry.stages);
+}
@@ -0,0 +1,65 @@
+#ifndef PROGRAMCOMPILER_H
+#define PROGRAMCOMPILER_H
+
+#include <glew.h>
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "ProgramBinaryCache.h"
+
+// Submit-all-then-poll program building. submit() issues every stage compile and the
+// link without reading any status back, so a driver with KHR (or ARB)
+// parallel_shader_compile builds all programs on its own threads meanwhile. The program
+// name is usable straight away; the driver only waits when it is first bound. poll()
+// picks up finished programs without blocking (GL_COMPLETION_STATUS_KHR), reports
+// compile and link errors and stores the binaries in the ProgramBinaryCache.
+// A program that fails keeps its (unusable) name; the error is printed when polled,
+// and hasFailed tells it from a good one.
+class ProgramCompiler {
+public:
+    static ProgramCompiler& instance();
+
+    // Starts building the program and returns its name. GL thread.
+    GLuint submit(const std::vector<ShaderSource>& stages, const std::string& name);
+
+    // Finishes the programs the driver is done with; without the extension there is no
+    // way to ask, so every pending program is finished (and waited for). Returns how many
+    // were finished. GL thread, once per frame.
+    size_t poll();
+
+    size_t getPendingCount() const { return pending.size(); }
+
+    // Whether the program is unusable: 0, or a submitted program whose compile or link
+    // failed. A program still building is finished first, which waits for the driver.
+    // Programs from the caches are only ever returned linked. GL thread.
+    bool hasFailed(GLuint program);
+
+    // Whether the driver compiles in the background
+    bool isParallel();
+
+private:
+    struct Pending {
+        GLuint program;
+        std::vector<GLuint> shaders;
+        std::vector<ShaderSource> stages; // Kept for the binary cache key
+        std::string name;
+    };
+
+    ProgramCompiler() = default;
+
+    void resolve(const Pending& pending);
+    void printBatch() const;
+
+    bool initialized = false;
+    bool parallel = false;
+    std::vector<Pending> pending;
+    std::unordered_set<GLuint> failed;
+
+    // Current batch, from the first submit until nothing is pending
+    std::chrono::high_resolution_clock::time_point batchStart;
+    size_t batchCount = 0;
+    size_t batchFailures = 0;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "ProgramUniforms.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace {
+    const char* CommonNames[] = {
+        "model", "view", "projection", "viewProjectionMatrix", "posOffset", "posScale", "octNormals", "diffuseLayer",
+        "viewMatrix", "projectionMatrix"
+    };
+
+    std::unordered_map<GLuint, std::unique_ptr<ProgramUniforms>>& getTables() {
+        static std::unordered_map<GLuint, std::unique_ptr<ProgramUniforms>> tables;
+        return tables;
+    }
+}
+
+ProgramUniforms& ProgramUniforms::get(GLuint program) {
+    std::unique_ptr<ProgramUniforms>& table = getTables()[program];
+    if (!table) {
+        table.reset(new ProgramUniforms(program));
+    }
+    return *table;
+}
+
+void ProgramUniforms::release(GLuint program) {
+    getTables().erase(program);
+}
+
+ProgramUniforms::ProgramUniforms(GLuint program)
+    : program(program) {
+    static_assert(sizeof(CommonNames) / sizeof(CommonNames[0]) == CommonCount, "One name per common handle");
+    for (const char* name : CommonNames) {
+        find(name);
+    }
+}
+
+void ProgramUniforms::reflect() {
+    reflected = true;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        Uniform uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &uniform.size, &uniform.type, name.data());
+        uniform.name.assign(name.data(), length);
+        uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+        if (uniform.location >= 0) {
+            active.push_back(uniform); // Block members have no location
+        }
+    }
+    std::sort(active.begin(), active.end(), [](const Uniform& a, const Uniform& b) { return a.name < b.name; });
+
+    for (Slot& slot : slots) {
+        resolve(slot);
+    }
+}
+
+void ProgramUniforms::resolve(Slot& slot) const {
+    auto found = std::lower_bound(active.begin(), active.end(), slot.name,
+        [](const Uniform& uniform, const std::string& name) { return uniform.name < name; });
+    if (found != active.end() && found->name == slot.name) {
+        slot.location = found->location;
+    } else if (!active.empty()) {
+        // Later elements of a basic array ("weights[2]") are not listed
+        slot.location = glGetUniformLocation(program, slot.name.c_str());
+    }
+}
+
+ProgramUniforms::Handle ProgramUniforms::find(const char* name) {
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i].name == name) {
+            return static_cast<Handle>(i);
+        }
+    }
+    Slot slot;
+    slot.name = name;
+    if (reflected) {
+        resolve(slot);
+    }
+    slots.push_back(slot);
+    return static_cast<Handle>(slots.size() - 1);
+}
+
+ProgramUniforms::Handle ProgramUniforms::find(const char* array, size_t index, const char* member) {
+    std::string name = std::string(array) + "[" + std::to_string(index) + "]";
+    if (member) {
+        name += std::string(".") + member;
+    }
+    return find(name.c_str());
+}
+
+bool ProgramUniforms::update(Handle handle, const void* value, size_t size) {
+    if (!reflected) {
+        reflect();
+    }
+    Slot& slot = slots[handle];
+    if (slot.location < 0 || (slot.hasValue && std::memcmp(slot.value, value, size) == 0)) {
+        return false;
+    }
+    std::memcpy(slot.value, value, size);
+    slot.hasValue = true;
+    return true;
+}
+
+void ProgramUniforms::set(Handle handle, int value) {
+    if (update(handle, &value, sizeof(value))) {
+        glUniform1i(slots[handle].location, value);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, GLuint value) {
+    if (update(handle, &value, sizeof(value))) {
+        glUniform1ui(slots[handle].location, value);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, float value) {
+    if (update(handle, &value, sizeof(value))) {
+        glUniform1f(slots[handle].location, value);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, const glm::vec2& value) {
+    if (update(handle, &value[0], sizeof(value))) {
+        glUniform2fv(slots[handle].location, 1, &value[0]);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, const glm::vec3& value) {
+    if (update(handle, &value[0], sizeof(value))) {
+        glUniform3fv(slots[handle].location, 1, &value[0]);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, const glm::vec4& value) {
+    if (update(handle, &value[0], sizeof(value))) {
+        glUniform4fv(slots[handle].location, 1, &value[0]);
+    }
+}
+
+void ProgramUniforms::set(Handle handle, const glm::mat4& value) {
+    if (update(handle, &value[0][0], sizeof(value))) {
+        glUniformMatrix4fv(slots[handle].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+const std::vector<ProgramUniforms::Uniform>& ProgramUniforms::getActiveUniforms() {
+    if (!reflected) {
+        reflect();
+    }
+    return active;
+}
@@ -0,0 +1,90 @@
+#ifndef PROGRAMUNIFORMS_H
+#define PROGRAMUNIFORMS_H
+
+#include <glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+
+// A program's active uniforms, reflected once into a compact table, with typed setters
+// on pre-resolved locations that skip the upload when the value has not changed.
+// There is one table per program (get), and every write to a program's uniforms has to
+// go through it, or the skip compares against a stale value.
+// Handles come from find at setup time. The program may still be linking then (see
+// ProgramCompiler), so the reflection runs on the first set instead, and the frame loop
+// neither builds names nor queries locations. Setters write to the program in use.
+class ProgramUniforms {
+public:
+    typedef uint32_t Handle;
+
+    // Registered first in every table, so helpers drawing with any program
+    // (ModelLoader, InstancedRenderer, Plane, applyVertexDecode) use them without a lookup
+    enum Common : Handle {
+        Model,
+        View,
+        Projection,
+        ViewProjectionMatrix,
+        PosOffset,
+        PosScale,
+        OctNormals,
+        DiffuseLayer,
+        ViewMatrix,
+        ProjectionMatrix,
+        CommonCount
+    };
+
+    struct Uniform {
+        std::string name; // Arrays of basic types are listed once, as "name[0]"
+        GLint location;
+        GLenum type;
+        GLint size;       // Array length, 1 otherwise
+    };
+
+    static ProgramUniforms& get(GLuint program);
+
+    // Drops the table of a deleted program, whose name the GL may hand out again
+    static void release(GLuint program);
+
+    // Handle for a uniform name; names that are not active get a handle whose sets do
+    // nothing. Scans the registered names without allocating once the name is known;
+    // loops keep the handle.
+    Handle find(const char* name);
+
+    // Element of an array, optionally a struct member: ("pointLights", 3, "Position")
+    // finds "pointLights[3].Position". Builds the name, so setup time only.
+    Handle find(const char* array, size_t index, const char* member = nullptr);
+
+    void set(Handle handle, int value);
+    void set(Handle handle, GLuint value);
+    void set(Handle handle, float value);
+    void set(Handle handle, const glm::vec2& value);
+    void set(Handle handle, const glm::vec3& value);
+    void set(Handle handle, const glm::vec4& value);
+    void set(Handle handle, const glm::mat4& value);
+
+    const std::vector<Uniform>& getActiveUniforms();
+
+    GLuint getProgram() const { return program; }
+
+private:
+    struct Slot {
+        std::string name;
+        GLint location = -1;
+        bool hasValue = false;
+        float value[16]; // Last upload, compared bytewise
+    };
+
+    explicit ProgramUniforms(GLuint program);
+
+    void reflect();
+    void resolve(Slot& slot) const;
+    bool update(Handle handle, const void* value, size_t size);
+
+    GLuint program;
+    bool reflected = false;
+    std::vector<Uniform> active; // Sorted by name
+    std::vector<Slot> slots;
+};
+
+#endif
@@ -0,0 +1,52 @@
+// LightManager's light buffer at binding 1: a storage buffer holding any number of point
+// lights, or a uniform block of MAX_POINT_LIGHTS (LIGHT_UBO) where fragment shaders have
+// no storage buffers. Include after #version.
+
+// Uniform block size; a specialization constant when loaded as SPIR-V (see SpirvCache)
+#ifdef LIGHT_UBO
+#ifdef GL_SPIRV
+layout(constant_id = 0) const int MAX_POINT_LIGHTS = 256;
+#elif !defined(MAX_POINT_LIGHTS)
+#define MAX_POINT_LIGHTS 256
+#endif
+#endif
+
+struct PointLight {
+    vec4 PositionLinear;   // xyz: position, w: linear attenuation
+    vec4 ColorQuadratic;   // rgb: colour, w: quadratic attenuation
+};
+
+#ifdef LIGHT_UBO
+layout(std140, binding = 1) uniform LightBlock {
+#else
+layout(std430, binding = 1) readonly buffer LightBlock {
+#endif
+    ivec4 lightCounts;          // x: point lights
+    vec4 dirLightDirection;
+    vec4 dirLightColor;
+    vec4 spotLightPosition;     // w: cutOff
+    vec4 spotLightDirection;    // w: outerCutOff
+    vec4 spotLightColor;
+#ifdef LIGHT_UBO
+    PointLight pointLights[MAX_POINT_LIGHTS];
+#else
+    PointLight pointLights[];
+#endif
+};
+
+// Distance at which a point light's attenuation takes its brightest channel below 1/256;
+// LightManager::getLightRange on the CPU
+float pointLightRange(PointLight light)
+{
+    float brightness = max(light.ColorQuadratic.r, max(light.ColorQuadratic.g, light.ColorQuadratic.b));
+    float linear = light.PositionLinear.w;
+    float quadratic = light.ColorQuadratic.w;
+    float c = 1.0 - 256.0 * brightness;
+    if (c >= 0.0) {
+        return 0.0;
+    }
+    if (quadratic > 0.0) {
+        return (-linear + sqrt(linear * linear - 4.0 * quadratic * c)) / (2.0 * quadratic);
+    }
+    return linear > 0.0 ? -c / linear : 1e30;
+}
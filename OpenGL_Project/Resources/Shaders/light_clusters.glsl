@@ -0,0 +1,34 @@
+// Clustered lighting: the view frustum split into CLUSTER_X x CLUSTER_Y screen tiles and
+// CLUSTER_Z exponential depth slices, each with the list of point lights reaching it.
+// Written by light_cluster_compute, matches LightClusters. Include after light_buffer.glsl.
+
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_CLUSTER_LIGHTS 1024
+
+// View-space bounds of every cluster: min, then max
+layout(std430, binding = 2) readonly buffer ClusterBounds {
+    vec4 clusterBounds[];
+};
+
+// Light count of every cluster, then MAX_CLUSTER_LIGHTS light indices per cluster
+layout(std430, binding = 3) buffer ClusterLightGrid {
+    uint clusterLightCounts[CLUSTER_COUNT];
+    uint clusterLightIndices[];
+};
+
+uint getClusterIndex(uvec3 cluster)
+{
+    return cluster.x + CLUSTER_X * (cluster.y + CLUSTER_Y * cluster.z);
+}
+
+// Cluster of a pixel; tileScale is the grid size over the viewport size, and the depth
+// slice is log(viewDepth) * depthScaleBias.x + depthScaleBias.y
+uint getFragmentCluster(vec2 fragCoord, float viewDepth, vec2 tileScale, vec2 depthScaleBias)
+{
+    uvec2 tile = uvec2(clamp(fragCoord * tileScale, vec2(0.0), vec2(CLUSTER_X - 1, CLUSTER_Y - 1)));
+    int slice = clamp(int(log(max(viewDepth, 1e-6)) * depthScaleBias.x + depthScaleBias.y), 0, CLUSTER_Z - 1);
+    return getClusterIndex(uvec3(tile, uint(slice)));
+}
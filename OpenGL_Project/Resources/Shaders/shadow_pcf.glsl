@@ -0,0 +1,39 @@
+// Shadow factor from a directional light's depth map with a (2r+1)^2 PCF kernel.
+// Include after #version.
+
+// Kernel radius; a specialization constant when loaded as SPIR-V (see SpirvCache)
+#ifdef GL_SPIRV
+layout(constant_id = 1) const int PCF_RADIUS = 3;
+#elif !defined(PCF_RADIUS)
+#define PCF_RADIUS 3
+#endif
+
+float calculateShadow(vec4 fragPosLightSpace, sampler2D shadowMap)
+{
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    if(projCoords.z > 1.0)
+        return 0.0;
+
+    float closestDepth = texture(shadowMap, projCoords.xy).r;
+    float currentDepth = projCoords.z;
+    float bias = 0.005;
+
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+
+    // Using a rotated grid to reduce shadow aliasing
+    for(int x = -PCF_RADIUS; x <= PCF_RADIUS; ++x)
+    {
+        for(int y = -PCF_RADIUS; y <= PCF_RADIUS; ++y)
+        {
+            vec2 offset = vec2(x, y) * texelSize + vec2(0.5) * texelSize;
+            float pcfDepth = texture(shadowMap, projCoords.xy + offset).r; 
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
+        }    
+    }
+    shadow /= float((2 * PCF_RADIUS + 1) * (2 * PCF_RADIUS + 1));
+
+    return shadow;
+}
@@ -0,0 +1,6 @@
+// Packed mesh decode (see VertexLayout.h); the defaults leave float vertices untouched
+uniform vec3 posOffset = vec3(0.0);
+uniform vec3 posScale = vec3(1.0);
+uniform bool octNormals = false;
+
+#include "octahedral.glsl"
@@ -1,16 +1,52 @@
 #include "ShaderLoader.h"
+#include "ProgramCompiler.h"
+#include "SpirvCache.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
+namespace {
+    std::string getDirectory(const std::string& filename) {
+        const size_t slash = filename.find_last_of("/\\");
+        return slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+    }
+
+    bool startsWith(const std::string& line, const char* directive) {
+        const size_t start = line.find_first_not_of(" \t");
+        return start != std::string::npos && line.compare(start, std::char_traits<char>::length(directive), directive) == 0;
+    }
+
+    // "#define NAME VALUE" lines for a permutation key
+    std::string getDefineBlock(const ShaderDefines& defines) {
+        std::string block;
+        for (const std::string& define : defines) {
+            const size_t equals = define.find('=');
+            block += "#define " + (equals == std::string::npos ? define : define.substr(0, equals) + " " + define.substr(equals + 1)) + "\n";
+        }
+        return block;
+    }
+
+    ShaderDefines sortDefines(ShaderDefines defines) {
+        std::sort(defines.begin(), defines.end());
+        defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+        return defines;
+    }
+}
+
+std::map<std::string, GLuint> ShaderLoader::variants;
+
 ShaderLoader::ShaderLoader() {}
 ShaderLoader::~ShaderLoader() {}
 
 GLuint ShaderLoader::CreateShader(GLenum shaderType, const char* shaderName) {
-    std::string shaderSourceCode = ReadShaderFile(shaderName);
+    return CompileShader(shaderType, ReadShaderFile(shaderName), shaderName);
+}
+
+GLuint ShaderLoader::CompileShader(GLenum shaderType, const std::string& source, const char* name) {
     GLuint shaderID = glCreateShader(shaderType);
-    const char* shader_code_ptr = shaderSourceCode.c_str();
-    const int shader_code_size = (int)shaderSourceCode.size();
+    const char* shader_code_ptr = source.c_str();
+    const int shader_code_size = (int)source.size();
 
     glShaderSource(shaderID, 1, &shader_code_ptr, &shader_code_size);
     glCompileShader(shaderID);
@@ -18,31 +54,148 @@ GLuint ShaderLoader::CreateShader(GLenum shaderType, const char* shaderName) {
     int compile_result = 0;
     glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compile_result);
     if (compile_result == GL_FALSE) {
-        PrintErrorDetails(true, shaderID, shaderName);
+        PrintErrorDetails(true, shaderID, name);
+        glDeleteShader(shaderID);
         return 0;
     }
     return shaderID;
 }
 
 GLuint ShaderLoader::CreateProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename) {
-    GLuint vertexShaderID = CreateShader(GL_VERTEX_SHADER, vertexShaderFilename);
-    GLuint fragmentShaderID = CreateShader(GL_FRAGMENT_SHADER, fragmentShaderFilename);
-
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShaderID);
-    glAttachShader(program, fragmentShaderID);
-    glLinkProgram(program);
-
-    int link_result = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &link_result);
-    if (link_result == GL_FALSE) {
-        std::string programName = std::string(vertexShaderFilename) + fragmentShaderFilename;
-        PrintErrorDetails(false, program, programName.c_str());
-        return 0;
+    return CreateProgram({ { GL_VERTEX_SHADER, vertexShaderFilename }, { GL_FRAGMENT_SHADER, fragmentShaderFilename } });
+}
+
+GLuint ShaderLoader::CreateProgram(const std::vector<ShaderFile>& stages) {
+    return CreateProgram(stages, ShaderDefines());
+}
+
+GLuint ShaderLoader::CreateProgram(const std::vector<ShaderFile>& stages, const ShaderDefines& defines) {
+    std::vector<ShaderSource> sources;
+    std::string programName;
+    for (const ShaderFile& stage : stages) {
+        std::vector<std::string> files;
+        sources.push_back({ stage.type, PreprocessShaderFile(stage.filename, defines, files) });
+
+        // Name the includes so "1(12)" style error lines can be traced back
+        programName += (programName.empty() ? "" : " + ") + stage.filename;
+        for (size_t i = 1; i < files.size(); ++i) {
+            programName += (i == 1 ? " (" : ", ") + std::to_string(i) + ": " + files[i] + (i + 1 == files.size() ? ")" : "");
+        }
+    }
+    if (!defines.empty()) {
+        programName += " [";
+        for (size_t i = 0; i < defines.size(); ++i) {
+            programName += (i > 0 ? " " : "") + defines[i];
+        }
+        programName += "]";
     }
+
+    // Driver binary first, then precompiled SPIR-V, then the GLSL front end
+    GLuint program = ProgramBinaryCache::instance().load(sources);
+    if (program == 0) {
+        program = SpirvCache::instance().createProgram(stages, defines, programName);
+        if (program != 0) {
+            ProgramBinaryCache::instance().save(program, sources);
+        }
+    }
+    return program != 0 ? program : ProgramCompiler::instance().submit(sources, programName);
+}
+
+GLuint ShaderLoader::GetVariant(const char* vertexShaderFilename, const char* fragmentShaderFilename, const ShaderDefines& defines) {
+    return GetVariant({ { GL_VERTEX_SHADER, vertexShaderFilename }, { GL_FRAGMENT_SHADER, fragmentShaderFilename } }, defines);
+}
+
+GLuint ShaderLoader::GetVariant(const std::vector<ShaderFile>& stages, const ShaderDefines& defines) {
+    const ShaderDefines key = sortDefines(defines);
+    std::string name;
+    for (const ShaderFile& stage : stages) {
+        name += std::to_string(stage.type) + ":" + stage.filename + ";";
+    }
+    for (const std::string& define : key) {
+        name += "|" + define;
+    }
+
+    auto found = variants.find(name);
+    if (found != variants.end()) {
+        return found->second;
+    }
+    GLuint program = CreateProgram(stages, key);
+    variants[name] = program;
     return program;
 }
 
+std::string ShaderLoader::PreprocessShaderFile(const std::string& filename, const ShaderDefines& defines) {
+    std::vector<std::string> files;
+    return PreprocessShaderFile(filename, sortDefines(defines), files);
+}
+
+std::string ShaderLoader::PreprocessShaderFile(const std::string& filename, const ShaderDefines& defines, std::vector<std::string>& files) {
+    std::string source;
+    std::string defineBlock = getDefineBlock(defines);
+    AppendShaderFile(filename, defineBlock, files, source);
+    if (!defineBlock.empty()) {
+        // No #version line to put them after
+        source = defineBlock + "#line 1 0\n" + source;
+    }
+    return source;
+}
+
+bool ShaderLoader::AppendShaderFile(const std::string& filename, std::string& defineBlock,
+    std::vector<std::string>& files, std::string& output) {
+    if (std::find(files.begin(), files.end(), filename) != files.end()) {
+        return true; // Already pasted into this stage
+    }
+    const size_t fileIndex = files.size();
+    files.push_back(filename);
+    if (fileIndex > 0) {
+        output += "#line 1 " + std::to_string(fileIndex) + "\n";
+    }
+
+    std::ifstream file(filename, std::ios::in);
+    if (!file.good()) {
+        std::cerr << "Cannot read file: " << filename << std::endl;
+        return false;
+    }
+
+    bool success = true;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (fileIndex == 0 && !defineBlock.empty() && startsWith(line, "#version")) {
+            // Defines must follow #version, which has to come first
+            output += line + "\n" + defineBlock + "#line " + std::to_string(lineNumber + 1) + " 0\n";
+            defineBlock.clear();
+        } else if (startsWith(line, "#include")) {
+            const size_t open = line.find('"');
+            const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cerr << "Malformed #include in " << filename << "(" << lineNumber << "): " << line << std::endl;
+                success = false;
+                continue;
+            }
+            const std::string included = getDirectory(filename) + line.substr(open + 1, close - open - 1);
+            success = AppendShaderFile(included, defineBlock, files, output) && success;
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+        } else {
+            output += line + "\n";
+        }
+    }
+    return success;
+}
+
+GLuint ShaderLoader::CreateProgramFromSources(const std::vector<ShaderSource>& stages, const std::string& name) {
+    GLuint program = ProgramBinaryCache::instance().load(stages);
+    if (program != 0) {
+        return program;
+    }
+    return ProgramCompiler::instance().submit(stages, name);
+}
+
 std::string ShaderLoader::ReadShaderFile(const char* filename) {
     std::ifstream file(filename, std::ios::in);
     std::string shaderCode;
@@ -2,8 +2,27 @@
 #define SHADERLOADER_H
 
 #include <glew.h> 
+#include <map>
 #include <string>
+#include <vector>
+#include "ProgramBinaryCache.h"
 
+// One stage of a program, read from a file
+struct ShaderFile {
+    GLenum type;
+    std::string filename;
+};
+
+// Permutation key: "NAME" or "NAME=VALUE" entries, defined after the #version line of
+// every stage. Order and duplicates do not matter.
+typedef std::vector<std::string> ShaderDefines;
+
+// Shader files go through a small preprocessor before compiling:
+//  - #include "file" pastes the file in, relative to the including file. Each file is
+//    included once per stage, so include cycles and shared includes are harmless.
+//    Includes are pasted whatever #ifdef surrounds them; GLSL drops the inactive ones.
+//  - #line directives keep error lines right; the source string number is the file's
+//    index in the order files were first read (0 is the stage file itself).
 class ShaderLoader {
 public:
     ShaderLoader();
@@ -12,9 +31,34 @@ public:
     GLuint CreateShader(GLenum shaderType, const char* shaderName);
     GLuint CreateProgram(const char* vertexShaderFilename, const char* fragmentShaderFilename);
 
+    // Program with any set of stages (tessellation, compute). Programs come from the
+    // ProgramBinaryCache or the SpirvCache when they have them; otherwise the
+    // ProgramCompiler starts building them and errors are reported when it polls, so a
+    // failed program is not 0 (ProgramCompiler::hasFailed tells).
+    GLuint CreateProgram(const std::vector<ShaderFile>& stages);
+
+    // Variant of a program with a permutation key. Built on first request and cached by
+    // the stage files and the (sorted) defines, so later calls return the same program.
+    GLuint GetVariant(const std::vector<ShaderFile>& stages, const ShaderDefines& defines);
+    GLuint GetVariant(const char* vertexShaderFilename, const char* fragmentShaderFilename, const ShaderDefines& defines);
+
+    // Preprocessed source of one stage, ready to compile
+    std::string PreprocessShaderFile(const std::string& filename, const ShaderDefines& defines);
+
+    // Same for sources already in memory; the name is only used in error messages
+    GLuint CreateProgramFromSources(const std::vector<ShaderSource>& stages, const std::string& name);
+
 private:
     std::string ReadShaderFile(const char* filename);
+    std::string PreprocessShaderFile(const std::string& filename, const ShaderDefines& defines, std::vector<std::string>& files);
+    bool AppendShaderFile(const std::string& filename, std::string& defineBlock,
+        std::vector<std::string>& files, std::string& output);
+    GLuint CreateProgram(const std::vector<ShaderFile>& stages, const ShaderDefines& defines);
+    GLuint CompileShader(GLenum shaderType, const std::string& source, const char* name);
     void PrintErrorDetails(bool isShader, GLuint id, const char* name);
+
+    // Programs built by GetVariant, shared by every loader
+    static std::map<std::string, GLuint> variants;
 };
 
 #endif
@@ -6,12 +6,17 @@ ShadowScene::ShadowScene(ShaderLoader& shaderLoader, Camera& camera, Skybox& sky
     movableModelIndex(-1) // Initialize with invalid index
 {
     shadowShaderProgram = shaderLoader.CreateProgram("Resources/Shaders/shadow_vertex_shader.txt", "Resources/Shaders/shadow_fragment_shader.txt");
-    lightingShaderProgram = shaderLoader.CreateProgram("Resources/Shaders/lighting_vertex_shader.txt", "Resources/Shaders/lighting_fragment_shader.txt");
+    // Terrain and models share one lighting shader, specialized at compile time
+    terrainShaderProgram = shaderLoader.GetVariant("Resources/Shaders/lighting_vertex_shader.txt", "Resources/Shaders/lighting_fragment_shader.txt", { "TERRAIN" });
+    lightingShaderProgram = shaderLoader.GetVariant("Resources/Shaders/lighting_vertex_shader.txt", "Resources/Shaders/lighting_fragment_shader.txt", {});
 
     // Initialize models with distinct positions
     models.emplace_back("Resources/Models/AncientEmpire/SM_Wep_Axe_02.obj");
     models.emplace_back("Resources/Models/SciFiWorlds/SM_Wep_Sword_02.obj");
     models.emplace_back("Resources/Models/SciFiSpace/SM_Ship_Fighter_02.obj");
+    modelTexturePaths.push_back("Resources/Textures/PolygonAncientWorlds_Texture_01_A.png");
+    modelTexturePaths.push_back("Resources/Textures/PolygonScifiWorlds_Texture_01_A.png");
+    modelTexturePaths.push_back("Resources/Textures/PolygonSciFiSpace_Texture_01_A.png");
 
     // Designate the third model as movable
     movableModelIndex = 2;
@@ -26,6 +31,13 @@ ShadowScene::ShadowScene(ShaderLoader& shaderLoader, Camera& camera, Skybox& sky
     // Set light directions
     lightDirections.emplace_back(glm::vec3(-0.5f, -1.0f, -0.5f)); // Light 1 direction
     lightDirections.emplace_back(glm::vec3(0.5f, -1.0f, 0.5f));   // Light 2 direction
+
+    // Uniform handles, resolved once the programs have linked
+    terrainUniforms = getLightingUniforms(terrainShaderProgram);
+    modelUniforms = getLightingUniforms(lightingShaderProgram);
+    terrainMaxHeight = terrainUniforms.uniforms->find("maxHeight");
+    diffuseTextures = modelUniforms.uniforms->find("diffuseTextures");
+    shadowLightSpaceMatrix = ProgramUniforms::get(shadowShaderProgram).find("lightSpaceMatrix");
 }
 
 void ShadowScene::initialize()
@@ -38,9 +50,9 @@ void ShadowScene::initialize()
     terrain.translate(glm::vec3(-150.0f, -30.0f, -50.0f));
     terrain.scale(glm::vec3(20.0f, 5.0f, 20.0f));    // Reduced Y scaling
 
-    // Initialize models
+    // Initialize models (meshes arrive in the background)
     for (size_t i = 0; i < models.size(); ++i) {
-        models[i].loadModel();
+        models[i].loadModelAsync();
         if (i == static_cast<size_t>(movableModelIndex)) {
             // Initialize movable model's position
             models[i].translate(glm::vec3(0.0f, 0.0f, 20.0f));
@@ -60,6 +72,14 @@ void ShadowScene::initialize()
         }
     }
 
+    // Pack the model textures and the instances' one into shared arrays (one per size)
+    std::vector<std::string> texturePaths = modelTexturePaths;
+    texturePaths.push_back(renderer.getTexturePath());
+    std::vector<TextureLayer> layers = TextureCache::instance().loadPacked(texturePaths);
+    renderer.setDiffuse(layers.back());
+    layers.pop_back();
+    modelTextures = layers;
+
     // Initialize renderer if needed
     renderer.initialize();
 }
@@ -71,15 +91,18 @@ void ShadowScene::renderShadowPass(int lightIndex) {
     // Set light space matrix
     shadowMaps[lightIndex].setLightPosition(lightDirections[lightIndex]);
     glm::mat4 lightSpaceMatrix = shadowMaps[lightIndex].getLightSpaceMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(shadowShaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+    ProgramUniforms& shadowUniforms = ProgramUniforms::get(shadowShaderProgram);
+    shadowUniforms.set(shadowLightSpaceMatrix, lightSpaceMatrix);
 
     // Render terrain with shadow shader
     terrain.renderShadow(shadowShaderProgram);
 
-    // Render all models with shadow shader
+    // Render the models inside this light's frustum with shadow shader
     for (size_t i = 0; i < models.size(); ++i) {
-        glm::mat4 modelMatrix = models[i].getModelMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shadowShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        if (!isModelVisible(i, lightIndex + 1)) {
+            continue;
+        }
+        shadowUniforms.set(ProgramUniforms::Model, models[i].getModelMatrix());
         models[i].render(shadowShaderProgram, camera.GetViewMatrix(), camera.GetProjectionMatrix());
     }
 
@@ -92,44 +115,74 @@ void ShadowScene::renderSceneWithShadows() {
     glDepthFunc(GL_LEQUAL);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    glUseProgram(lightingShaderProgram);
+    // Render terrain first
+    setLightingUniforms(terrainShaderProgram, terrainUniforms);
+    terrainUniforms.uniforms->set(terrainMaxHeight, 20.0f); // Set to terrain's max height
+    terrainUniforms.uniforms->set(ProgramUniforms::View, camera.GetViewMatrix());
+    terrainUniforms.uniforms->set(ProgramUniforms::Projection, camera.GetProjectionMatrix());
+    terrain.renderNormal(terrainShaderProgram);
 
-    // Set light space matrices and shadow maps
-    for (size_t i = 0; i < shadowMaps.size(); ++i) {
-        // Set lightSpaceMatrixi
-        std::string lightSpaceUniform = "lightSpaceMatrix" + std::to_string(i + 1);
-        glUniformMatrix4fv(glGetUniformLocation(lightingShaderProgram, lightSpaceUniform.c_str()), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrices[i]));
+    // Render models after terrain
+    setLightingUniforms(lightingShaderProgram, modelUniforms);
+    ProgramUniforms& uniforms = *modelUniforms.uniforms;
+
+    // Diffuse arrays go on the unit after the shadow maps; a draw whose texture shares
+    // the bound array only changes the layer
+    const GLint diffuseUnit = static_cast<GLint>(shadowMaps.size());
+    glActiveTexture(GL_TEXTURE0 + diffuseUnit);
+    uniforms.set(diffuseTextures, diffuseUnit);
+    GLuint boundArray = 0;
+    for (size_t i = 0; i < models.size(); ++i) {
+        if (!isModelVisible(i, 0)) {
+            continue;
+        }
+        const TextureLayer& diffuse = modelTextures[i];
+        if (diffuse.isValid()) {
+            if (diffuse.array->getID() != boundArray) {
+                boundArray = diffuse.array->getID();
+                glBindTexture(GL_TEXTURE_2D_ARRAY, boundArray);
+            }
+            uniforms.set(ProgramUniforms::DiffuseLayer, static_cast<float>(diffuse.layer));
+        }
 
-        // Set shadowMapi to texture unit i
-        std::string shadowMapUniform = "shadowMap" + std::to_string(i + 1);
-        glUniform1i(glGetUniformLocation(lightingShaderProgram, shadowMapUniform.c_str()), static_cast<int>(i));
-        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-        glBindTexture(GL_TEXTURE_2D, shadowMaps[i].getDepthMap());
+        models[i].render(lightingShaderProgram, camera.GetViewMatrix(), camera.GetProjectionMatrix());
+    }
+
+    // Render instances (binding their array on the diffuse unit)
+    renderer.render(lightingShaderProgram, camera.GetViewMatrix() * camera.GetProjectionMatrix());
+    glActiveTexture(GL_TEXTURE0);
+}
 
-        // Set lightDiri
-        std::string lightDirUniform = "lightDir" + std::to_string(i + 1);
-        glUniform3fv(glGetUniformLocation(lightingShaderProgram, lightDirUniform.c_str()), 1, &lightDirections[i][0]);
+ShadowScene::LightingUniforms ShadowScene::getLightingUniforms(GLuint program) const {
+    LightingUniforms handles;
+    handles.uniforms = &ProgramUniforms::get(program);
+    for (size_t i = 0; i < shadowMaps.size(); ++i) {
+        const std::string suffix = std::to_string(i + 1);
+        handles.lightSpaceMatrices.push_back(handles.uniforms->find(("lightSpaceMatrix" + suffix).c_str()));
+        handles.shadowMaps.push_back(handles.uniforms->find(("shadowMap" + suffix).c_str()));
+        handles.lightDirs.push_back(handles.uniforms->find(("lightDir" + suffix).c_str()));
     }
+    handles.viewPos = handles.uniforms->find("viewPos");
+    return handles;
+}
 
-    glUniform3fv(glGetUniformLocation(lightingShaderProgram, "viewPos"), 1, glm::value_ptr(camera.getPosition()));
+void ShadowScene::setLightingUniforms(GLuint program, const LightingUniforms& handles) {
+    glUseProgram(program);
+    ProgramUniforms& uniforms = *handles.uniforms;
 
-    // Render terrain first
-    glUniform1i(glGetUniformLocation(lightingShaderProgram, "isTerrain"), 1);
-    glUniform1f(glGetUniformLocation(lightingShaderProgram, "maxHeight"), 20.0f); // Set to terrain's max height
-    terrain.renderNormal(lightingShaderProgram);
+    // Set light space matrices and shadow maps
+    for (size_t i = 0; i < shadowMaps.size(); ++i) {
+        uniforms.set(handles.lightSpaceMatrices[i], lightSpaceMatrices[i]);
 
-    // Render models after terrain
-    glUniform1i(glGetUniformLocation(lightingShaderProgram, "isTerrain"), 0);
-    glUniform1f(glGetUniformLocation(lightingShaderProgram, "maxHeight"), 1.0f); // Default for models
-    for (size_t i = 0; i < models.size(); ++i) {
-        glm::mat4 modelMatrix = models[i].getModelMatrix();
+        // Set shadowMapi to texture unit i
+        uniforms.set(handles.shadowMaps[i], static_cast<int>(i));
+        glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        glBindTexture(GL_TEXTURE_2D, shadowMaps[i].getDepthMap());
 
-        glUniformMatrix4fv(glGetUniformLocation(lightingShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        models[i].render(lightingShaderProgram, camera.GetViewMatrix(), camera.GetProjectionMatrix());
+        uniforms.set(handles.lightDirs[i], lightDirections[i]);
     }
 
-    // Render instances 
-    renderer.render(lightingShaderProgram, camera.GetViewMatrix() * camera.GetProjectionMatrix());
+    uniforms.set(handles.viewPos, camera.getPosition());
 }
 
 void ShadowScene::setupLights() {
@@ -140,10 +193,43 @@ void ShadowScene::setupLights() {
     }
 }
 
+void ShadowScene::cullModels() {
+    culler.clear();
+    for (const ModelLoader& model : models) {
+        culler.add(model.getWorldAabb());
+    }
+
+    // Camera and every shadow light in one pass over the boxes
+    std::vector<Frustum> frusta;
+    frusta.push_back(Frustum::fromMatrix(camera.GetProjectionMatrix() * camera.GetViewMatrix()));
+    for (const glm::mat4& lightSpaceMatrix : lightSpaceMatrices) {
+        frusta.push_back(Frustum::fromMatrix(lightSpaceMatrix));
+    }
+    culler.cull(frusta.data(), frusta.size(), modelVisibility);
+
+    mainCullStats = FrustumCuller::countVisible(modelVisibility, 0);
+    FrustumCuller::logIfChanged("Shadow scene main pass", mainCullStats, loggedMainCullStats);
+
+    shadowCullStats.resize(lightSpaceMatrices.size());
+    loggedShadowCullStats.resize(lightSpaceMatrices.size());
+    for (size_t i = 0; i < lightSpaceMatrices.size(); ++i) {
+        shadowCullStats[i] = FrustumCuller::countVisible(modelVisibility, i + 1);
+        FrustumCuller::logIfChanged("Shadow scene light " + std::to_string(i + 1) + " pass", shadowCullStats[i], loggedShadowCullStats[i]);
+    }
+}
+
+bool ShadowScene::isModelVisible(size_t modelIndex, size_t frustumIndex) const {
+    // Everything draws until the first cull
+    return modelIndex >= modelVisibility.size() || (modelVisibility[modelIndex] & (1u << frustumIndex)) != 0;
+}
+
 void ShadowScene::render() {
     // Setup lights and update light space matrices
     setupLights();
 
+    // Find which models each pass needs
+    cullModels();
+
     // Render shadow pass for each light source
     for (size_t i = 0; i < shadowMaps.size(); ++i) {
         renderShadowPass(static_cast<int>(i));
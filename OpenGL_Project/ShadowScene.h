@@ -9,6 +9,8 @@
 #include "ShadowMap.h"
 #include "TerrainMap.h"
 #include "ModelLoader.h"
+#include "FrustumCuller.h"
+#include "ProgramUniforms.h"
 #include <glew.h>
 #include <vector>
 #include "Dependencies/glm/glm.hpp"
@@ -24,6 +26,10 @@ public:
     // Add getter for movable model
     ModelLoader& getMovableModel() { return models[movableModelIndex]; }
 
+    // Models tested and left visible by the last frame's passes
+    const CullStats& getMainCullStats() const { return mainCullStats; }
+    const CullStats& getShadowCullStats(int lightIndex) const { return shadowCullStats[lightIndex]; }
+
 private:
     ShaderLoader& shaderLoader;
     Camera& camera;
@@ -37,15 +43,37 @@ private:
 
     TerrainMap terrain;
     std::vector<ModelLoader> models; // List of loaded models
+    std::vector<std::string> modelTexturePaths; // Diffuse texture per model
+    std::vector<TextureLayer> modelTextures;    // Packed with the instanced renderer's texture in initialize
 
     GLuint shadowShaderProgram;
-    GLuint lightingShaderProgram;
+    GLuint lightingShaderProgram; // Model variant of the lighting shader
+    GLuint terrainShaderProgram;  // TERRAIN variant: untextured, no packed vertex decode
+
+    // Handles of the uniforms both lighting variants take
+    struct LightingUniforms {
+        ProgramUniforms* uniforms;
+        std::vector<ProgramUniforms::Handle> lightSpaceMatrices, shadowMaps, lightDirs;
+        ProgramUniforms::Handle viewPos;
+    };
+    LightingUniforms terrainUniforms, modelUniforms;
+    ProgramUniforms::Handle terrainMaxHeight, diffuseTextures, shadowLightSpaceMatrix;
 
     // Movable model index
     int movableModelIndex;
 
+    // Model visibility masks: bit 0 for the camera, bit 1 + i for shadow light i
+    FrustumCuller culler;
+    std::vector<unsigned char> modelVisibility;
+    CullStats mainCullStats, loggedMainCullStats;
+    std::vector<CullStats> shadowCullStats, loggedShadowCullStats;
+
     void renderSceneWithShadows();
+    LightingUniforms getLightingUniforms(GLuint program) const;
+    void setLightingUniforms(GLuint program, const LightingUniforms& handles);
     void setupLights();
+    void cullModels();
+    bool isModelVisible(size_t modelIndex, size_t frustumIndex) const;
 };
 
 #endif
@@ -1,6 +1,6 @@
 #include "Skybox.h"
+#include "ProgramUniforms.h"
 #include "ShaderLoader.h"
-#include "Dependencies/stb_image.h"
 #include <iostream>
 
 Skybox::Skybox(const std::vector<std::string>& faces) {
@@ -8,30 +8,13 @@ Skybox::Skybox(const std::vector<std::string>& faces) {
     initSkybox();
 }
 
-GLuint Skybox::loadCubemap(const std::vector<std::string>& faces) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else {
-            std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+std::shared_ptr<const CachedTexture> Skybox::loadCubemap(const std::vector<std::string>& faces) {
+    // Grey until every face has decoded, then all six are swapped in together
+    TextureParams params;
+    params.wrap = GL_CLAMP_TO_EDGE;
+    params.minFilter = GL_LINEAR;
+    params.generateMipmaps = false;
+    return TextureCache::instance().loadCubemap(faces, params);
 }
 
 void Skybox::initSkybox() {
@@ -94,9 +77,9 @@ void Skybox::initSkybox() {
 void Skybox::render(const glm::mat4& viewProjectionMatrix) {
     glDepthFunc(GL_LEQUAL);
     glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "viewProjectionMatrix"), 1, GL_FALSE, &viewProjectionMatrix[0][0]);
+    ProgramUniforms::get(shaderProgram).set(ProgramUniforms::ViewProjectionMatrix, viewProjectionMatrix);
     glBindVertexArray(VAO);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    cubemapTexture->bind();
     glDrawArrays(GL_TRIANGLES, 0, 36);
     glBindVertexArray(0);
     glDepthFunc(GL_LESS);
@@ -1,10 +1,12 @@
 #ifndef SKYBOX_H
 #define SKYBOX_H
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <glew.h>
 #include "Dependencies/glm/glm.hpp"
+#include "TextureCache.h"
 
 class Skybox {
 public:
@@ -13,10 +15,10 @@ public:
     GLuint shaderProgram;
 
 private:
-    GLuint cubemapTexture;
+    std::shared_ptr<const CachedTexture> cubemapTexture;
     GLuint VAO, VBO;
 
-    GLuint loadCubemap(const std::vector<std::string>& faces);
+    std::shared_ptr<const CachedTexture> loadCubemap(const std::vector<std::string>& faces);
     void initSkybox();
 };
 
@@ -0,0 +1,378 @@
+#include "SpirvCache.h"
+#include "FileUtils.h"
+#include "HashUtils.h"
+#include "ProgramBinaryCache.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const char* SpirvDirectory = "Resources/Cache/SpirV";
+
+    // Each switch doubles the modules compiled for a shader; the lighting pass has five
+    const size_t MaxSwitches = 6;
+
+    bool readFile(const std::string& path, std::vector<char>& data) {
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        return static_cast<bool>(file.read(data.data(), data.size()));
+    }
+
+    // Ids of the OpDecorate ... SpecId decorations in a module
+    std::vector<GLuint> getSpecializationIds(const std::vector<char>& module) {
+        const size_t HeaderWords = 5;
+        const uint32_t OpDecorate = 71;
+        const uint32_t DecorationSpecId = 1;
+
+        std::vector<GLuint> ids;
+        const size_t wordCount = module.size() / sizeof(uint32_t);
+        std::vector<uint32_t> words(wordCount);
+        std::copy(module.begin(), module.begin() + wordCount * sizeof(uint32_t), reinterpret_cast<char*>(words.data()));
+        for (size_t i = HeaderWords; i < wordCount;) {
+            const uint32_t length = words[i] >> 16;
+            if (length == 0) {
+                break;
+            }
+            if ((words[i] & 0xFFFF) == OpDecorate && length >= 4 && i + 3 < wordCount && words[i + 2] == DecorationSpecId) {
+                ids.push_back(words[i + 3]);
+            }
+            i += length;
+        }
+        return ids;
+    }
+
+    // Stage from names such as "shadow_vertex_shader.txt", "sobel.frag" or "quad_tess_eval.txt"
+    GLenum getStageFromName(const std::string& path) {
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (name.find("tess_control") != std::string::npos) return GL_TESS_CONTROL_SHADER;
+        if (name.find("tess_eval") != std::string::npos) return GL_TESS_EVALUATION_SHADER;
+        if (name.find("compute") != std::string::npos) return GL_COMPUTE_SHADER;
+        if (name.find("vert") != std::string::npos) return GL_VERTEX_SHADER;
+        if (name.find("frag") != std::string::npos) return GL_FRAGMENT_SHADER;
+        return 0;
+    }
+
+    const char* getStageName(GLenum type) {
+        switch (type) {
+        case GL_VERTEX_SHADER: return "vert";
+        case GL_TESS_CONTROL_SHADER: return "tesc";
+        case GL_TESS_EVALUATION_SHADER: return "tese";
+        case GL_COMPUTE_SHADER: return "comp";
+        default: return "frag";
+        }
+    }
+
+    bool isConstant(const std::string& name) {
+        for (size_t i = 0; i < SpirvCache::ConstantCount; ++i) {
+            if (name == SpirvCache::Constants[i].name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Names tested with #ifdef / #ifndef or defined() in #if / #elif, except the ones the
+    // source defines unconditionally (outside any conditional block)
+    std::vector<std::string> getSwitches(const std::string& source) {
+        std::vector<std::string> tested, defined;
+        std::istringstream lines(source);
+        std::string directive, name;
+        int depth = 0;
+        for (std::string line; std::getline(lines, line);) {
+            std::istringstream words(line);
+            if (!(words >> directive)) {
+                continue;
+            }
+            if (directive == "#if" || directive == "#elif") {
+                // defined(NAME) or defined NAME, anywhere in the expression
+                for (size_t at = line.find("defined"); at != std::string::npos; at = line.find("defined", at + 7)) {
+                    size_t begin = line.find_first_not_of(" \t(", at + 7);
+                    size_t end = begin == std::string::npos ? begin : line.find_first_not_of(
+                        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_", begin);
+                    if (begin != std::string::npos && begin != end) {
+                        tested.push_back(line.substr(begin, end == std::string::npos ? end : end - begin));
+                    }
+                }
+            } else if ((directive == "#ifdef" || directive == "#ifndef") && words >> name) {
+                tested.push_back(name);
+            } else if (directive == "#define" && depth == 0 && words >> name) {
+                defined.push_back(name);
+            }
+
+            if (directive == "#if" || directive == "#ifdef" || directive == "#ifndef") {
+                ++depth;
+            } else if (directive == "#endif" && depth > 0) {
+                --depth;
+            }
+        }
+
+        std::vector<std::string> switches;
+        for (const std::string& candidate : tested) {
+            if (candidate != "GL_SPIRV" && !isConstant(candidate) &&
+                std::find(defined.begin(), defined.end(), candidate) == defined.end() &&
+                std::find(switches.begin(), switches.end(), candidate) == switches.end()) {
+                switches.push_back(candidate);
+            }
+        }
+        return switches;
+    }
+
+    std::string findValidator() {
+        if (const char* sdk = std::getenv("VULKAN_SDK")) {
+#ifdef _WIN32
+            const std::string path = std::string(sdk) + "/Bin/glslangValidator.exe";
+#else
+            const std::string path = std::string(sdk) + "/bin/glslangValidator";
+#endif
+            if (fileExists(path)) {
+                return path;
+            }
+        }
+        return "glslangValidator";
+    }
+}
+
+const SpirvCache::Constant SpirvCache::Constants[] = {
+    { "MAX_POINT_LIGHTS", 0 },
+    { "PCF_RADIUS", 1 },
+};
+const size_t SpirvCache::ConstantCount = sizeof(SpirvCache::Constants) / sizeof(SpirvCache::Constants[0]);
+
+SpirvCache& SpirvCache::instance() {
+    static SpirvCache cache;
+    return cache;
+}
+
+bool SpirvCache::isAvailable() {
+    if (!initialized) {
+        initialized = true;
+        available = GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv;
+    }
+    return available;
+}
+
+void SpirvCache::splitDefines(const ShaderDefines& defines, ShaderDefines& moduleDefines,
+    std::vector<GLuint>& constantIds, std::vector<GLuint>& constantValues) {
+    for (const std::string& define : defines) {
+        const size_t equals = define.find('=');
+        const std::string name = define.substr(0, equals);
+        bool matched = false;
+        for (size_t i = 0; i < ConstantCount && equals != std::string::npos; ++i) {
+            if (name == Constants[i].name) {
+                constantIds.push_back(Constants[i].id);
+                constantValues.push_back(static_cast<GLuint>(std::strtol(define.c_str() + equals + 1, nullptr, 10)));
+                matched = true;
+            }
+        }
+        if (!matched) {
+            moduleDefines.push_back(define);
+        }
+    }
+}
+
+std::string SpirvCache::getModulePath(GLenum type, const std::string& source) {
+    const uint32_t version = Version;
+    uint64_t key = hashBytes(&version, sizeof(version));
+    key = hashBytes(&type, sizeof(type), key);
+    key = hashString(source, key);
+
+    std::ostringstream name;
+    name << SpirvDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+    return name.str();
+}
+
+GLuint SpirvCache::loadShader(GLenum type, const std::string& path, const std::vector<GLuint>& constantIds,
+    const std::vector<GLuint>& constantValues) {
+    std::vector<char> module;
+    if (!readFile(path, module) || module.size() < 5 * sizeof(uint32_t)) {
+        return 0;
+    }
+
+    // Specializing a constant the module does not declare is an error, and the
+    // constants are shared by every stage
+    const std::vector<GLuint> declared = getSpecializationIds(module);
+    std::vector<GLuint> ids, values;
+    for (size_t i = 0; i < constantIds.size(); ++i) {
+        if (std::find(declared.begin(), declared.end(), constantIds[i]) != declared.end()) {
+            ids.push_back(constantIds[i]);
+            values.push_back(constantValues[i]);
+        }
+    }
+
+    GLuint shader = glCreateShader(type);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.data(), static_cast<GLsizei>(module.size()));
+    if (GLEW_VERSION_4_6) {
+        glSpecializeShader(shader, "main", static_cast<GLuint>(ids.size()), ids.data(), values.data());
+    } else {
+        glSpecializeShaderARB(shader, "main", static_cast<GLuint>(ids.size()), ids.data(), values.data());
+    }
+
+    GLint specialized = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &specialized);
+    if (specialized == GL_FALSE) {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool SpirvCache::hasUniformNames(GLuint program) const {
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        char name[256];
+        GLsizei length = 0;
+        glGetActiveUniformName(program, static_cast<GLuint>(i), sizeof(name), &length, name);
+        if (length == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+GLuint SpirvCache::createProgram(const std::vector<ShaderFile>& stages, const ShaderDefines& defines, const std::string& name) {
+    if (!isAvailable()) {
+        return 0;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    ShaderDefines moduleDefines;
+    std::vector<GLuint> constantIds, constantValues;
+    splitDefines(defines, moduleDefines, constantIds, constantValues);
+
+    ShaderLoader loader;
+    std::vector<GLuint> shaders;
+    for (const ShaderFile& stage : stages) {
+        const std::string source = loader.PreprocessShaderFile(stage.filename, moduleDefines);
+        GLuint shader = loadShader(stage.type, getModulePath(stage.type, source), constantIds, constantValues);
+        if (shader == 0) {
+            break;
+        }
+        shaders.push_back(shader);
+    }
+
+    GLuint program = 0;
+    if (shaders.size() == stages.size()) {
+        program = glCreateProgram();
+        for (GLuint shader : shaders) {
+            glAttachShader(program, shader);
+        }
+        if (ProgramBinaryCache::instance().isAvailable()) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program);
+        for (GLuint shader : shaders) {
+            glDetachShader(program, shader);
+        }
+
+        // Modules link by location rather than name, so a mismatch only shows up here
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_FALSE) {
+            std::cerr << "SPIR-V modules did not link, using GLSL: " << name << std::endl;
+            glDeleteProgram(program);
+            program = 0;
+        } else if (!namesChecked) {
+            namesChecked = true;
+            if (!hasUniformNames(program)) {
+                std::cout << "Driver does not reflect SPIR-V uniform names, using GLSL shaders" << std::endl;
+                available = false;
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    }
+    for (GLuint shader : shaders) {
+        glDeleteShader(shader);
+    }
+
+    ProgramBinaryCache::instance().recordCompile(millisecondsSince(start));
+    return program;
+}
+
+bool SpirvCache::runCompileTool(const std::vector<std::string>& directories) {
+    std::vector<std::string> files;
+    for (const std::string& directory : directories) {
+        for (const char* extension : { ".vert", ".frag", ".txt", ".glsl" }) {
+            std::vector<std::string> found = listFiles(directory, extension, false);
+            files.insert(files.end(), found.begin(), found.end());
+        }
+    }
+
+    const std::string validator = findValidator();
+    makeDirectory(SpirvDirectory);
+
+    ShaderLoader loader;
+    size_t shaderCount = 0, moduleCount = 0, failureCount = 0;
+    for (const std::string& path : files) {
+        const GLenum type = getStageFromName(path);
+        const std::string baseSource = loader.PreprocessShaderFile(path, ShaderDefines());
+        if (type == 0 || baseSource.find("void main") == std::string::npos) {
+            continue; // Includes and non-shader text files
+        }
+        ++shaderCount;
+
+        std::vector<std::string> switches = getSwitches(baseSource);
+        if (switches.size() > MaxSwitches) {
+            std::cerr << "  " << path << ": only the first " << MaxSwitches << " of " << switches.size() << " preprocessor switches are compiled" << std::endl;
+            switches.resize(MaxSwitches);
+        }
+
+        for (size_t mask = 0; mask < (size_t(1) << switches.size()); ++mask) {
+            ShaderDefines defines;
+            for (size_t i = 0; i < switches.size(); ++i) {
+                if (mask & (size_t(1) << i)) {
+                    defines.push_back(switches[i]);
+                }
+            }
+            const std::string source = loader.PreprocessShaderFile(path, defines);
+            const std::string modulePath = getModulePath(type, source);
+            const std::string sourcePath = modulePath + ".glsl";
+            const std::string tempPath = modulePath + ".tmp";
+
+            std::ofstream file(sourcePath, std::ios::out | std::ios::binary | std::ios::trunc);
+            file << source;
+            file.close();
+
+            std::string command = "\"" + validator + "\" -G -S " + getStageName(type) + " --aml --amb -o \"" + tempPath + "\" \"" + sourcePath + "\"";
+#ifdef _WIN32
+            command = "\"" + command + "\""; // cmd.exe strips the outer quotes
+#endif
+            const bool compiled = std::system(command.c_str()) == 0;
+            std::remove(sourcePath.c_str());
+
+            std::string variant;
+            for (const std::string& define : defines) {
+                variant += " " + define;
+            }
+            if (compiled) {
+                std::remove(modulePath.c_str());
+                std::rename(tempPath.c_str(), modulePath.c_str());
+                ++moduleCount;
+            } else {
+                std::remove(tempPath.c_str());
+                std::cerr << "  " << path << (variant.empty() ? "" : " [" + variant.substr(1) + "]") << ": failed, GLSL will be used" << std::endl;
+                ++failureCount;
+            }
+        }
+    }
+
+    std::cout << "Compiled " << moduleCount << " SPIR-V modules from " << shaderCount << " shaders";
+    if (failureCount > 0) {
+        std::cout << ", " << failureCount << " failed";
+    }
+    std::cout << std::endl;
+    return failureCount == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef SPIRVCACHE_H
+#define SPIRVCACHE_H
+
+#include <glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ShaderLoader.h"
+
+// Precompiled SPIR-V modules for ARB_gl_spirv (core in GL 4.6), stored under
+// Resources/Cache/SpirV by the --compile-spirv tool (glslangValidator). A module is named
+// by a hash of its stage and preprocessed source, so an edited shader or include simply
+// has no module and is compiled from GLSL as before.
+// Values listed in Constants are specialization constants: on the SPIR-V path they are
+// taken out of the permutation key and passed to glSpecializeShader, so one module
+// serves every value. GLSL still gets them as defines.
+class SpirvCache {
+public:
+    static const uint32_t Version = 1;
+
+    // Shaders declare these as layout(constant_id = id) under #ifdef GL_SPIRV
+    struct Constant {
+        const char* name;
+        GLuint id;
+    };
+    static const Constant Constants[];
+    static const size_t ConstantCount;
+
+    static SpirvCache& instance();
+
+    // ARB_gl_spirv or GL 4.6, and the driver still reflects uniform names (checked on the
+    // first program, since the renderer looks every uniform up by name). GL thread.
+    bool isAvailable();
+
+    // Splits a permutation key into the defines that pick the module and the
+    // specialization constant ids and values
+    static void splitDefines(const ShaderDefines& defines, ShaderDefines& moduleDefines,
+        std::vector<GLuint>& constantIds, std::vector<GLuint>& constantValues);
+
+    static std::string getModulePath(GLenum type, const std::string& source);
+
+    // Linked program from the modules of every stage, or 0 when one is missing or the
+    // driver refuses them. Links right away so a failure can still fall back to GLSL.
+    // GL thread.
+    GLuint createProgram(const std::vector<ShaderFile>& stages, const ShaderDefines& defines, const std::string& name);
+
+    // Compiles every shader (files with a main) in the directories, in each combination
+    // of the #ifdef switches it tests. Needs glslangValidator on the PATH or in the
+    // Vulkan SDK. No GL context.
+    static bool runCompileTool(const std::vector<std::string>& directories);
+
+private:
+    SpirvCache() = default;
+
+    GLuint loadShader(GLenum type, const std::string& path, const std::vector<GLuint>& constantIds,
+        const std::vector<GLuint>& constantValues);
+    bool hasUniformNames(GLuint program) const;
+
+    bool initialized = false;
+    bool available = false;
+    bool namesChecked = false;
+};
+
+#endif
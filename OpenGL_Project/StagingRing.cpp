@@ -0,0 +1,120 @@
+#include "StagingRing.h"
+#include <iostream>
+
+namespace {
+    const size_t AllocationAlignment = 16;
+}
+
+StagingRing::StagingRing()
+    : buffer(0), mapped(nullptr), capacity(0), head(0), nextId(1) {}
+
+StagingRing::~StagingRing() {
+    for (Region& region : regions) {
+        if (region.fence) {
+            glDeleteSync(region.fence);
+        }
+    }
+    if (buffer != 0) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+bool StagingRing::initialize(size_t ringCapacity) {
+    if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+        return false;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringCapacity, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringCapacity, flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!mapped) {
+        std::cerr << "Failed to map the texture staging buffer" << std::endl;
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        return false;
+    }
+    capacity = ringCapacity;
+    return true;
+}
+
+bool StagingRing::allocate(size_t size, Allocation& allocation) {
+    size = (size + AllocationAlignment - 1) & ~(AllocationAlignment - 1);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!mapped || size == 0 || size > capacity) {
+        return false;
+    }
+
+    // Free space runs from head to the oldest live region (the tail), wrapping at the end.
+    // Head never catches up with the tail, so head == tail only when the ring is empty.
+    size_t begin;
+    if (regions.empty()) {
+        begin = 0;
+    } else {
+        const size_t tail = regions.front().begin;
+        if (head >= tail) {
+            if (head + size <= capacity) {
+                begin = head;
+            } else if (size < tail) {
+                begin = 0;
+            } else {
+                return false;
+            }
+        } else if (head + size < tail) {
+            begin = head;
+        } else {
+            return false;
+        }
+    }
+
+    Region region = { nextId++, begin, begin + size, nullptr, false };
+    regions.push_back(region);
+    head = region.end;
+
+    allocation.id = region.id;
+    allocation.offset = begin;
+    allocation.size = size;
+    allocation.data = mapped + begin;
+    return true;
+}
+
+void StagingRing::release(const Allocation& allocation, bool copiesIssued) {
+    GLsync fence = copiesIssued ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Region& region : regions) {
+        if (region.id == allocation.id) {
+            region.fence = fence;
+            region.released = true;
+            return;
+        }
+    }
+    if (fence) {
+        glDeleteSync(fence);
+    }
+}
+
+void StagingRing::retire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!regions.empty() && regions.front().released) {
+        GLsync fence = regions.front().fence;
+        if (fence) {
+            const GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            glDeleteSync(fence);
+        }
+        regions.pop_front();
+    }
+    if (regions.empty()) {
+        head = 0;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef STAGINGRING_H
+#define STAGINGRING_H
+
+#include <glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Pixel unpack buffer that stays persistently mapped, so workers can copy decoded
+// texels straight into memory the GL reads from and the GL thread only issues the
+// buffer-to-texture copies. Space is handed out as a ring; each region returns to the
+// ring once the fence placed after its copies has signalled. Needs GL 4.4 or
+// ARB_buffer_storage; callers fall back to client memory when it is unavailable.
+class StagingRing {
+public:
+    struct Allocation {
+        uint64_t id = 0;
+        size_t offset = 0; // Into the buffer, for the gl*Tex*Image calls
+        size_t size = 0;
+        unsigned char* data = nullptr; // Mapped memory for the worker to fill
+
+        bool isValid() const { return data != nullptr; }
+    };
+
+    StagingRing();
+    ~StagingRing();
+
+    // Creates and maps the buffer; false when persistent mapping is unsupported. GL thread.
+    bool initialize(size_t capacity);
+
+    bool isAvailable() const { return mapped != nullptr; }
+    GLuint getBuffer() const { return buffer; }
+    size_t getCapacity() const { return capacity; }
+
+    // Reserves contiguous space, failing rather than waiting when the ring is full. Any thread.
+    bool allocate(size_t size, Allocation& allocation);
+
+    // Fences the copies issued from the allocation (or frees it straight away when none
+    // were issued); its space is reused once the fence has passed. GL thread.
+    void release(const Allocation& allocation, bool copiesIssued = true);
+
+    // Returns the space of released regions whose fences have signalled. GL thread.
+    void retire();
+
+private:
+    struct Region {
+        uint64_t id;
+        size_t begin, end;
+        GLsync fence;
+        bool released;
+    };
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    GLuint buffer;
+    unsigned char* mapped;
+    size_t capacity;
+
+    std::mutex mutex;
+    std::deque<Region> regions; // In allocation order; the front is the oldest
+    size_t head;                // Where the next allocation starts
+    uint64_t nextId;
+};
+
+#endif
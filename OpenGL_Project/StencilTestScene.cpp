@@ -1,4 +1,5 @@
 #include "StencilTestScene.h"
+#include "ProgramUniforms.h"
 #include "Dependencies/glm/gtc/matrix_transform.hpp"
 
 StencilTestScene::StencilTestScene(ShaderLoader& shaderLoader, Camera& camera, Skybox& skybox, InstancedRenderer& renderer)
@@ -35,7 +36,7 @@ void StencilTestScene::render()
     //glm::mat4 projectionMatrix = camera.getProjectionMatrix();
 
     // Set uniforms for the regular object
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
+    ProgramUniforms::get(shaderProgram).set(ProgramUniforms::Model, modelMatrix);
     //glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, &viewMatrix[0][0]);
     //glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projectionMatrix[0][0]);
 
@@ -52,7 +53,7 @@ void StencilTestScene::render()
     float outlineScale = 1.05f; // Adjust this scale to control the outline thickness
     glm::mat4 outlineModelMatrix = glm::scale(modelMatrix, glm::vec3(outlineScale));
 
-    glUniformMatrix4fv(glGetUniformLocation(outlineShaderProgram, "model"), 1, GL_FALSE, &outlineModelMatrix[0][0]);
+    ProgramUniforms::get(outlineShaderProgram).set(ProgramUniforms::Model, outlineModelMatrix);
     //glUniformMatrix4fv(glGetUniformLocation(outlineShaderProgram, "view"), 1, GL_FALSE, &viewMatrix[0][0]);
     //glUniformMatrix4fv(glGetUniformLocation(outlineShaderProgram, "projection"), 1, GL_FALSE, &projectionMatrix[0][0]);
 
@@ -3,26 +3,25 @@
 #include "TerrainMap.h"
 #include <fstream>
 #include <iostream>
-#include "Dependencies/stb_image.h" 
 #include "Dependencies/glm/gtc/matrix_transform.hpp"
 #include "ShaderLoader.h" 
+#include "VertexLayout.h"
 #include "Dependencies/glm/gtc/type_ptr.hpp"
 
 // Constructor
 TerrainMap::TerrainMap(const std::string& heightmapFile, int width, int height, float maxHeight)
     : heightmapFile(heightmapFile), width(width), height(height), maxHeight(maxHeight), vao(0), vbo(0), ebo(0),
-    grassTexture(0), dirtTexture(0), rockTexture(0), snowTexture(0), shaderProgram(0) {}
+    shaderProgram(0) {}
 
 // Destructor
 TerrainMap::~TerrainMap() {
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ebo);
-    glDeleteTextures(1, &grassTexture);
-    glDeleteTextures(1, &dirtTexture);
-    glDeleteTextures(1, &rockTexture);
-    glDeleteTextures(1, &snowTexture);
-    if (shaderProgram) glDeleteProgram(shaderProgram);
+    if (shaderProgram) {
+        ProgramUniforms::release(shaderProgram);
+        glDeleteProgram(shaderProgram);
+    }
 }
 
 // Initialize the terrain map
@@ -118,33 +117,9 @@ void TerrainMap::loadTextures() {
     snowTexture = loadTexture("Resources/Textures/PolygonAncientWorlds_Texture_01_B.png");
 }
 
-// Helper function to load a texture
-GLuint TerrainMap::loadTexture(const std::string& filePath) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format = (nrComponents == 3) ? GL_RGB : GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else {
-        std::cerr << "Texture failed to load at path: " << filePath << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+// Helper function to load a texture (repeating, mipmapped) through the shared cache
+std::shared_ptr<const CachedTexture> TerrainMap::loadTexture(const std::string& filePath) {
+    return TextureCache::instance().load(filePath);
 }
 
 // Render the terrain for the shadow pass
@@ -152,7 +127,10 @@ void TerrainMap::renderShadow(GLuint shadowShaderProgram) {
     glUseProgram(shadowShaderProgram);
 
     // Pass the model matrix to the shadow shader
-    glUniformMatrix4fv(glGetUniformLocation(shadowShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+    ProgramUniforms::get(shadowShaderProgram).set(ProgramUniforms::Model, modelMatrix);
+
+    // Terrain vertices are plain floats; undo any packed-mesh decode left on the program
+    applyVertexDecode(shadowShaderProgram);
 
     // Render the terrain mesh
     glBindVertexArray(vao);
@@ -163,11 +141,8 @@ void TerrainMap::renderShadow(GLuint shadowShaderProgram) {
 void TerrainMap::renderNormal(GLuint lightingShaderProgram) {
     glUseProgram(lightingShaderProgram);
 
-    // Set the 'isTerrain' uniform to true
-    glUniform1i(glGetUniformLocation(lightingShaderProgram, "isTerrain"), 1);
-
     // Pass the model matrix to the lighting shader
-    glUniformMatrix4fv(glGetUniformLocation(lightingShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+    ProgramUniforms::get(lightingShaderProgram).set(ProgramUniforms::Model, modelMatrix);
 
     // Render the terrain mesh
     glBindVertexArray(vao);
@@ -4,7 +4,9 @@
 #include <string>
 #include <vector>
 #include <glew.h>
+#include <memory>
 #include "Dependencies/glm/glm.hpp"
+#include "TextureCache.h"
 
 class TerrainMap {
 public:
@@ -13,7 +15,7 @@ public:
 
     void initialize();
     void renderShadow(GLuint shadowShaderProgram); // For shadow pass
-    void renderNormal(GLuint lightingShaderProgram); // For normal rendering
+    void renderNormal(GLuint lightingShaderProgram); // For normal rendering, with a TERRAIN lighting variant
 
     // Transformation methods
     void resetTransformation();
@@ -21,7 +23,7 @@ public:
     void scale(const glm::vec3& scaleFactor);
 
     glm::mat4 getModelMatrix() const { return modelMatrix; } // Ensure this returns a glm::mat4
-    GLuint getHeightmapTextureID() const { return grassTexture; }  // Replace with the actual texture ID variable
+    GLuint getHeightmapTextureID() const { return grassTexture->getID(); }  // Replace with the actual texture ID variable
 
 
 private:
@@ -34,7 +36,7 @@ private:
     std::vector<GLuint> indices;
 
     GLuint vao, vbo, ebo;
-    GLuint grassTexture, dirtTexture, rockTexture, snowTexture;
+    std::shared_ptr<const CachedTexture> grassTexture, dirtTexture, rockTexture, snowTexture;
     GLuint shaderProgram;
 
     glm::mat4 modelMatrix; // Transformation matrix
@@ -43,7 +45,7 @@ private:
     void createTerrainMesh();
     void computeNormals();
     void loadTextures();
-    GLuint loadTexture(const std::string& filePath);
+    std::shared_ptr<const CachedTexture> loadTexture(const std::string& filePath);
 };
 
 #endif // TERRAINMAP_H
@@ -1,29 +1,14 @@
 #include "Texture.h"
-#include "Dependencies/stb_image.h"
-#include <iostream>
 
-Texture::Texture(const std::string& filePath) {
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+Texture::Texture(const std::string& filePath)
+    : texture(TextureCache::instance().load(filePath)) {}
 
-    unsigned char* data = stbi_load(filePath.c_str(), &width, &height, &channels, 0);
-    if (data) {
-        GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
-        std::cerr << "Failed to load texture: " << filePath << std::endl;
-    }
-    stbi_image_free(data);
-}
-
-Texture::~Texture() {
-    glDeleteTextures(1, &textureID);
+void Texture::bind() {
+    texture->bind();
 }
 
-void Texture::bind() {
-    glBindTexture(GL_TEXTURE_2D, textureID);
+void Texture::requestDetail(float screenFraction, float uvRepeat) const {
+    texture->requestDetail(screenFraction, uvRepeat);
 }
 
 void Texture::unbind() {
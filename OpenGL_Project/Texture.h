@@ -3,20 +3,24 @@
 #define TEXTURE_H
 
 #include <glew.h>
+#include <memory>
 #include <string>
+#include "TextureCache.h"
 
 
+// Handle on a shared TextureCache texture (grey placeholder until decoded)
 class Texture {
 public:
     Texture(const std::string& filePath);
-    ~Texture();
 
     void bind();
     void unbind();
 
+    // Streaming hint for this frame (see CachedTexture::requestDetail)
+    void requestDetail(float screenFraction, float uvRepeat = 1.0f) const;
+
 private:
-    GLuint textureID;
-    int width, height, channels;
+    std::shared_ptr<const CachedTexture> texture;
 };
 
 #endif
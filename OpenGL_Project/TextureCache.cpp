@@ -0,0 +1,731 @@
+#include "TextureCache.h"
+#include "MipGenerator.h"
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+#include "Dependencies/stb_image.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+const size_t TextureCache::StagingBytes = 64 * 1024 * 1024;
+const size_t TextureCache::DefaultStreamingBudget = 256 * 1024 * 1024;
+const int TextureCache::StreamingTailSize = 256;
+const size_t TextureCache::UnusedFrames = 120;
+const int TextureCache::MaxLevelUploadsPerFrame = 2;
+
+namespace {
+    const float MinLodStep = 0.125f;      // Per frame while a new level blends in
+    const double StreamingReportSeconds = 2.0;
+
+    double toMegabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    GLenum formatForChannels(int channels) {
+        switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+        }
+    }
+
+    GLenum faceTarget(GLenum target, size_t face) {
+        return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(face) : target;
+    }
+
+    // The whole chain, or just the top level when the texture has no mipmaps
+    GLint getUploadLevelCount(const TextureParams& params, const ImageData& image) {
+        const size_t chainLength = image.isCompressed() ? image.compressedLevels.size() : image.mipLevels.size() + 1;
+        return params.generateMipmaps ? static_cast<GLint>(chainLength) : 1;
+    }
+
+    const std::vector<unsigned char>& getLevel(const ImageData& image, GLint level) {
+        if (image.isCompressed()) {
+            return image.compressedLevels[level];
+        }
+        return level == 0 ? image.pixels : image.mipLevels[level - 1];
+    }
+
+    // Estimated VRAM of one level; drivers pad 3-channel texels to 4 bytes
+    size_t getLevelBytes(const ImageData& image, GLint level) {
+        if (image.isCompressed()) {
+            return image.compressedLevels[level].size();
+        }
+        return static_cast<size_t>(std::max(1, image.width >> level)) * std::max(1, image.height >> level) *
+            (image.channels == 3 ? 4 : image.channels);
+    }
+
+    // Finest level no larger than the streaming tail size; everything from it down is
+    // uploaded on load
+    GLint getTailLevel(const TextureParams& params, const ImageData& image) {
+        const GLint levelCount = getUploadLevelCount(params, image);
+        GLint level = 0;
+        while (level + 1 < levelCount && (std::max(image.width, image.height) >> level) > TextureCache::StreamingTailSize) {
+            ++level;
+        }
+        return level;
+    }
+
+    // Copies one level from client memory, or from the bound unpack buffer into a level
+    // defined beforehand, where source is an offset into the buffer
+    void uploadLevel(GLenum target, const ImageData& image, GLint level, const void* source, bool fromBuffer) {
+        const GLsizei width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        const GLenum format = formatForChannels(image.channels);
+        if (image.isCompressed()) {
+            // Cooked mip chains upload as they are
+            glCompressedTexImage2D(target, level, image.compressedFormat, width, height, 0,
+                static_cast<GLsizei>(getLevel(image, level).size()), source);
+        } else if (fromBuffer) {
+            glTexSubImage2D(target, level, 0, 0, width, height, format, GL_UNSIGNED_BYTE, source);
+        } else {
+            glTexImage2D(target, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, source);
+        }
+    }
+
+    // Faces and layers must match in size and format to share one texture
+    bool haveSameLayout(const std::vector<ImageData>& images) {
+        for (const ImageData& image : images) {
+            if (!image.isValid() || image.width != images[0].width || image.height != images[0].height ||
+                image.channels != images[0].channels || image.compressedFormat != images[0].compressedFormat ||
+                image.compressedLevels.size() != images[0].compressedLevels.size()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Storage for one level of every layer, filled per layer by uploadLayer
+    void defineArrayLevel(const ImageData& image, GLint level, GLsizei layers) {
+        const GLsizei width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        if (image.isCompressed()) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, image.compressedFormat, width, height, layers, 0,
+                static_cast<GLsizei>(getLevel(image, level).size() * layers), nullptr);
+        } else {
+            const GLenum format = formatForChannels(image.channels);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, width, height, layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+
+    void uploadLayer(const ImageData& image, GLint level, GLint layer, const void* source) {
+        const GLsizei width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        if (image.isCompressed()) {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, image.compressedFormat,
+                static_cast<GLsizei>(getLevel(image, level).size()), source);
+        } else {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, formatForChannels(image.channels),
+                GL_UNSIGNED_BYTE, source);
+        }
+    }
+
+    // Cooked block-compressed entry if there is a current one, otherwise the source image,
+    // which is then cooked in the background for the next run
+    bool loadImage(const std::string& path, bool flipVertically, ImageData& image) {
+        if (TextureCooker::loadCooked(path, flipVertically, image)) {
+            return true;
+        }
+        if (!AssetLoader::decodeImage(path, flipVertically, image)) {
+            return false;
+        }
+        TextureCooker::cookInBackground(path, flipVertically, image);
+        return true;
+    }
+}
+
+std::string TextureParams::getKey() const {
+    std::ostringstream key;
+    key << wrap << ',' << minFilter << ',' << magFilter << ',' << flipVertically << ',' << generateMipmaps << ',' << streamable << '|';
+    return key.str();
+}
+
+CachedTexture::CachedTexture(const std::string& key, const std::string& name, GLenum target)
+    : key(key), name(name), target(target), textureID(0), width(1), height(1), channels(4), loaded(false), byteSize(0),
+    streamed(false), levelCount(1), tailLevel(0), residentLevel(0), neededLevel(0), minLod(0.0f), reloading(false),
+    lastUseFrame(0), requestedTexels(0.0f), lastRequestFrame(static_cast<size_t>(-1)) {}
+
+CachedTexture::~CachedTexture() {
+    glDeleteTextures(1, &textureID);
+    TextureCache::instance().release(*this);
+}
+
+void CachedTexture::requestDetail(float screenFraction, float uvRepeat) const {
+    if (!streamed) {
+        return;
+    }
+
+    // Each repeat of the texture covers that share of the object's pixels
+    const TextureCache& cache = TextureCache::instance();
+    const float texels = screenFraction * cache.viewportHeight / std::max(uvRepeat, 0.001f);
+    if (lastRequestFrame != cache.frame) {
+        lastRequestFrame = cache.frame;
+        requestedTexels = 0.0f;
+    }
+    requestedTexels = std::max(requestedTexels, texels);
+}
+
+TextureCache& TextureCache::instance() {
+    static TextureCache cache;
+    return cache;
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::load(const std::string& path, const TextureParams& params) {
+    // Colour images with a mip chain stream their finer levels; data textures such as
+    // heightmaps are sampled at full resolution and load whole
+    const bool flip = params.flipVertically;
+    const bool streamable = params.streamable && params.generateMipmaps && !TextureCooker::isLinearData(path, 4);
+    return request(params.getKey() + path, path, GL_TEXTURE_2D, 1, params, [path, flip](std::vector<ImageData>& faces) {
+        return loadImage(path, flip, faces[0]);
+    }, streamable);
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::loadCubemap(const std::vector<std::string>& faces, const TextureParams& params) {
+    std::string key = "cube:" + params.getKey();
+    for (const std::string& face : faces) {
+        key += face + ";";
+    }
+
+    const bool flip = params.flipVertically;
+    return request(key, faces.empty() ? key : faces[0] + " (cubemap)", GL_TEXTURE_CUBE_MAP, faces.size(), params, [faces, flip](std::vector<ImageData>& images) {
+        // Decode the faces side by side on the pool
+        ThreadPool::shared().parallelFor(faces.size(), [&faces, &images, flip](size_t i) {
+            loadImage(faces[i], flip, images[i]);
+        });
+        return haveSameLayout(images);
+    });
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::loadGenerated(const std::string& name, const TextureParams& params, Generator generate) {
+    return request(params.getKey() + "generated:" + name, name, GL_TEXTURE_2D, 1, params, generate);
+}
+
+std::vector<TextureLayer> TextureCache::loadPacked(const std::vector<std::string>& paths, const TextureParams& params) {
+    struct Group {
+        int width, height, channels;
+        std::vector<std::string> paths;
+    };
+
+    // Group by header; a path listed twice shares its layer
+    std::vector<Group> groups;
+    std::vector<size_t> groupOf(paths.size(), 0);
+    std::vector<int> layerOf(paths.size(), -1);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        int width, height, channels;
+        if (!stbi_info(paths[i].c_str(), &width, &height, &channels)) {
+            std::cerr << "Texture not packed, unreadable: " << paths[i] << std::endl;
+            continue;
+        }
+
+        size_t group = 0;
+        while (group < groups.size() && (groups[group].width != width || groups[group].height != height || groups[group].channels != channels)) {
+            ++group;
+        }
+        if (group == groups.size()) {
+            groups.push_back({ width, height, channels, {} });
+        }
+        std::vector<std::string>& members = groups[group].paths;
+        const auto found = std::find(members.begin(), members.end(), paths[i]);
+        groupOf[i] = group;
+        layerOf[i] = static_cast<int>(found - members.begin());
+        if (found == members.end()) {
+            members.push_back(paths[i]);
+        }
+    }
+
+    std::vector<std::shared_ptr<const CachedTexture>> arrays;
+    const bool flip = params.flipVertically;
+    for (const Group& group : groups) {
+        std::string key = "array:" + params.getKey();
+        for (const std::string& path : group.paths) {
+            key += path + ";";
+        }
+
+        const std::vector<std::string> members = group.paths;
+        const std::string name = members[0] + " (array of " + std::to_string(members.size()) + ")";
+        arrays.push_back(request(key, name, GL_TEXTURE_2D_ARRAY, members.size(), params, [members, flip](std::vector<ImageData>& images) {
+            ThreadPool::shared().parallelFor(members.size(), [&members, &images, flip](size_t i) {
+                loadImage(members[i], flip, images[i]);
+            });
+            if (haveSameLayout(images)) {
+                return true;
+            }
+
+            // Only some layers are cooked so far (or in different formats): decode every
+            // source so the layers match
+            ThreadPool::shared().parallelFor(members.size(), [&members, &images, flip](size_t i) {
+                images[i] = ImageData();
+                AssetLoader::decodeImage(members[i], flip, images[i]);
+            });
+            return haveSameLayout(images);
+        }));
+    }
+
+    std::vector<TextureLayer> layers(paths.size());
+    size_t packed = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (layerOf[i] >= 0) {
+            layers[i].array = arrays[groupOf[i]];
+            layers[i].layer = layerOf[i];
+            ++packed;
+        }
+    }
+    std::cout << "Packed " << packed << " textures into " << groups.size() << " texture arrays" << std::endl;
+    return layers;
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::request(const std::string& key, const std::string& name, GLenum target, size_t faceCount,
+    const TextureParams& params, Generator generate, bool streamable) {
+    auto found = textures.find(key);
+    if (found != textures.end()) {
+        std::shared_ptr<CachedTexture> live = found->second.lock();
+        if (live) {
+            ++stats.hits;
+            return live;
+        }
+    }
+    ++stats.misses;
+
+    if (!stagingInitialized) {
+        stagingInitialized = true;
+        if (!staging.initialize(StagingBytes)) {
+            std::cout << "Texture staging ring unavailable (needs GL 4.4 or ARB_buffer_storage), uploading from client memory" << std::endl;
+        }
+    }
+
+    std::shared_ptr<CachedTexture> texture(new CachedTexture(key, name, target));
+    glGenTextures(1, &texture->textureID);
+    glBindTexture(target, texture->textureID);
+
+    // Sampler state is final now; the placeholder is swapped for the image later
+    if (target == GL_TEXTURE_2D_ARRAY) {
+        AssetLoader::uploadPlaceholderTexel(target, static_cast<GLsizei>(faceCount));
+    } else {
+        for (size_t face = 0; face < faceCount; ++face) {
+            AssetLoader::uploadPlaceholderTexel(faceTarget(target, face));
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, params.wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, params.wrap);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, params.wrap);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, params.minFilter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, params.magFilter);
+    glBindTexture(target, 0);
+
+    texture->byteSize = 4 * faceCount;
+    addVram(texture->byteSize);
+    ++stats.liveTextures;
+    textures[key] = texture;
+
+    // Only a weak reference travels with the job, so dropping the texture cancels the upload
+    std::weak_ptr<CachedTexture> weak = texture;
+    AssetLoader::instance().load(name, [weak, name, faceCount, params, generate, streamable]() -> AssetLoader::Upload {
+        if (weak.expired()) {
+            return AssetLoader::Upload();
+        }
+
+        auto faces = std::make_shared<std::vector<ImageData>>(faceCount);
+        const bool generated = generate(*faces);
+
+        // Mips are built here rather than by glGenerateMipmap on the GL thread; cooked
+        // images already carry theirs
+        if (generated && params.generateMipmaps) {
+            for (ImageData& face : *faces) {
+                MipGenerator::generate(face, !TextureCooker::isLinearData(name, face.channels), MipFilter::Box);
+            }
+        }
+
+        // Copy into the staging ring here so the GL thread only issues the buffer copies
+        auto staged = std::make_shared<StagedUpload>();
+        if (generated && streamable && !TextureCooker::isLinearData(name, (*faces)[0].channels)) {
+            staged->firstLevel = getTailLevel(params, (*faces)[0]);
+        }
+        if (generated) {
+            TextureCache::instance().stage(params, *faces, *staged);
+        }
+
+        return [weak, name, params, faces, generated, staged]() {
+            std::shared_ptr<CachedTexture> texture = weak.lock();
+            if (!texture) {
+                if (staged->allocation.isValid()) {
+                    TextureCache::instance().staging.release(staged->allocation, false);
+                }
+                return;
+            }
+            if (!generated) {
+                std::cerr << "Texture failed to load: " << name << std::endl;
+                return;
+            }
+            TextureCache::instance().upload(*texture, params, faces, *staged);
+        };
+    });
+
+    return texture;
+}
+
+bool TextureCache::stage(const TextureParams& params, const std::vector<ImageData>& faces, StagedUpload& staged) {
+    if (!staging.isAvailable()) {
+        return false;
+    }
+
+    // Levels are packed at 16-byte offsets, matching the ring's own alignment
+    const GLint levelCount = getUploadLevelCount(params, faces[0]);
+    size_t totalBytes = 0;
+    for (const ImageData& image : faces) {
+        for (GLint level = staged.firstLevel; level < levelCount; ++level) {
+            totalBytes += (getLevel(image, level).size() + 15) & ~static_cast<size_t>(15);
+        }
+    }
+    if (!staging.allocate(totalBytes, staged.allocation)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    for (const ImageData& image : faces) {
+        for (GLint level = staged.firstLevel; level < levelCount; ++level) {
+            const std::vector<unsigned char>& data = getLevel(image, level);
+            std::memcpy(staged.allocation.data + offset, data.data(), data.size());
+            staged.offsets.push_back(staged.allocation.offset + offset);
+            offset += (data.size() + 15) & ~static_cast<size_t>(15);
+        }
+    }
+    return true;
+}
+
+void TextureCache::upload(CachedTexture& texture, const TextureParams& params, const std::shared_ptr<std::vector<ImageData>>& source,
+    const StagedUpload& staged) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const std::vector<ImageData>& faces = *source;
+    const bool fromStaging = staged.allocation.isValid();
+    staging.retire();
+
+    glBindTexture(texture.target, texture.textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Tightly packed rows of any width
+
+    const bool compressed = faces[0].isCompressed();
+    const GLint levelCount = getUploadLevelCount(params, faces[0]);
+    const GLint firstLevel = staged.firstLevel;
+    const bool layered = texture.target == GL_TEXTURE_2D_ARRAY;
+    if (layered) {
+        // Every layer's storage first, then each layer's texels
+        for (GLint level = firstLevel; level < levelCount; ++level) {
+            defineArrayLevel(faces[0], level, static_cast<GLsizei>(faces.size()));
+        }
+    }
+    if (fromStaging) {
+        // Define the levels first: with the ring bound, a null pointer would mean offset 0
+        if (!compressed && !layered) {
+            for (size_t face = 0; face < faces.size(); ++face) {
+                const GLenum format = formatForChannels(faces[face].channels);
+                for (GLint level = firstLevel; level < levelCount; ++level) {
+                    glTexImage2D(faceTarget(texture.target, face), level, format, std::max(1, faces[face].width >> level),
+                        std::max(1, faces[face].height >> level), 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.getBuffer());
+    }
+
+    size_t bytes = 0;
+    size_t stagedLevel = 0;
+    for (size_t face = 0; face < faces.size(); ++face) {
+        const ImageData& image = faces[face];
+        for (GLint level = firstLevel; level < levelCount; ++level) {
+            // From the ring the pointer argument is an offset into the bound buffer
+            const void* data = fromStaging ? reinterpret_cast<const void*>(staged.offsets[stagedLevel++]) : getLevel(image, level).data();
+            if (layered) {
+                uploadLayer(image, level, static_cast<GLint>(face), data);
+            } else {
+                uploadLevel(faceTarget(texture.target, face), image, level, data, fromStaging);
+            }
+            bytes += getLevelBytes(image, level);
+        }
+    }
+
+    // Levels above the base are missing until streamed in
+    glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, firstLevel);
+    glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    if (fromStaging) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        staging.release(staged.allocation);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(texture.target, 0);
+
+    const double uploadMilliseconds = millisecondsSince(start);
+    if (fromStaging) {
+        ++stats.stagedUploads;
+        stats.stagedUploadMilliseconds += uploadMilliseconds;
+    } else {
+        ++stats.directUploads;
+        stats.directUploadMilliseconds += uploadMilliseconds;
+    }
+
+    stats.vramBytes -= texture.byteSize;
+    texture.byteSize = bytes;
+    addVram(bytes);
+
+    texture.width = faces[0].width;
+    texture.height = faces[0].height;
+    texture.channels = faces[0].channels;
+    texture.loaded = true;
+
+    if (firstLevel > 0) {
+        texture.streamed = true;
+        texture.params = params;
+        texture.levelCount = levelCount;
+        texture.tailLevel = texture.residentLevel = texture.neededLevel = firstLevel;
+        texture.lastUseFrame = frame;
+        texture.levelBytes.clear();
+        for (GLint level = 0; level < levelCount; ++level) {
+            texture.levelBytes.push_back(getLevelBytes(faces[0], level));
+        }
+
+        // The decoded chain stays around for the first requests; once dropped, the same
+        // kind of source is read again (a cook finishing meanwhile would not match the levels)
+        texture.sourceLevels = source;
+        const std::string path = texture.name;
+        const bool flip = params.flipVertically;
+        texture.reload = [path, flip, compressed](std::vector<ImageData>& images) {
+            return compressed ? TextureCooker::loadCooked(path, flip, images[0]) : AssetLoader::decodeImage(path, flip, images[0]);
+        };
+    }
+
+    std::cout << "Loaded texture: " << texture.name << " (" << texture.width << "x" << texture.height << ", "
+        << texture.channels << " channels, " << (compressed ? "cooked, " : "") << bytes / 1024 << " KB";
+    if (firstLevel > 0) {
+        std::cout << " from level " << firstLevel << " of " << levelCount;
+    }
+    std::cout << ", " << uploadMilliseconds << " ms on GL thread " << (fromStaging ? "from staging ring" : "from client memory") << "), "
+        << toMegabytes(stats.vramBytes) << " MB of textures live" << std::endl;
+}
+
+void TextureCache::updateStreaming(double time) {
+    std::vector<std::shared_ptr<CachedTexture>> streamed;
+    for (const auto& entry : textures) {
+        std::shared_ptr<CachedTexture> texture = entry.second.lock();
+        if (texture && texture->streamed) {
+            streamed.push_back(texture);
+        }
+    }
+
+    // Level whose texels match the largest on-screen size requested this frame; textures
+    // nobody asked for in a while only need their tail
+    for (const std::shared_ptr<CachedTexture>& texture : streamed) {
+        if (texture->lastRequestFrame == frame) {
+            const float texels = std::max(texture->requestedTexels, 1.0f);
+            const float level = std::floor(std::log2(std::max(texture->width, texture->height) / texels));
+            texture->neededLevel = static_cast<int>(std::min(std::max(level, 0.0f), static_cast<float>(texture->tailLevel)));
+            texture->lastUseFrame = frame;
+        } else if (frame - texture->lastUseFrame > UnusedFrames) {
+            texture->neededLevel = texture->tailLevel;
+        }
+    }
+
+    // Surplus levels stay while they fit; when space is short the finest ones of the
+    // least recently used textures go first
+    auto evictSurplus = [&streamed, this](const CachedTexture* keep) {
+        CachedTexture* victim = nullptr;
+        for (const std::shared_ptr<CachedTexture>& texture : streamed) {
+            if (texture.get() == keep || texture->residentLevel >= texture->neededLevel) {
+                continue;
+            }
+            if (!victim || texture->lastUseFrame < victim->lastUseFrame || (texture->lastUseFrame == victim->lastUseFrame &&
+                texture->levelBytes[texture->residentLevel] > victim->levelBytes[victim->residentLevel])) {
+                victim = texture.get();
+            }
+        }
+        if (victim) {
+            evictLevel(*victim);
+        }
+        return victim != nullptr;
+    };
+    while (stats.vramBytes > streamingBudget && evictSurplus(nullptr)) {}
+
+    // Largest shortfall first, one level at a time, a few levels per frame
+    std::vector<std::shared_ptr<CachedTexture>> wanting;
+    for (const std::shared_ptr<CachedTexture>& texture : streamed) {
+        if (texture->neededLevel < texture->residentLevel) {
+            wanting.push_back(texture);
+        }
+    }
+    std::sort(wanting.begin(), wanting.end(), [](const std::shared_ptr<CachedTexture>& a, const std::shared_ptr<CachedTexture>& b) {
+        return a->residentLevel - a->neededLevel > b->residentLevel - b->neededLevel;
+    });
+
+    int uploads = 0;
+    for (const std::shared_ptr<CachedTexture>& texture : wanting) {
+        if (uploads >= MaxLevelUploadsPerFrame) {
+            break;
+        }
+        if (!texture->sourceLevels) {
+            if (!texture->reloading && texture->reload) {
+                reloadSource(texture);
+            }
+            continue;
+        }
+
+        const size_t bytes = texture->levelBytes[texture->residentLevel - 1];
+        while (stats.vramBytes + bytes > streamingBudget && evictSurplus(texture.get())) {}
+        if (stats.vramBytes + bytes > streamingBudget) {
+            continue;
+        }
+        streamInLevel(*texture);
+        ++uploads;
+    }
+
+    size_t residentBytes = 0, requestedBytes = 0;
+    for (const std::shared_ptr<CachedTexture>& texture : streamed) {
+        if (texture->minLod > 0.0f) {
+            texture->minLod = std::max(texture->minLod - MinLodStep, 0.0f);
+            glBindTexture(GL_TEXTURE_2D, texture->textureID);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, texture->minLod);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        // The decoded chain is only worth its memory while finer levels may still be wanted
+        if (texture->sourceLevels && (texture->residentLevel == 0 ||
+            (texture->residentLevel <= texture->neededLevel && frame - texture->lastUseFrame > UnusedFrames))) {
+            texture->sourceLevels.reset();
+        }
+
+        residentBytes += texture->byteSize;
+        for (int level = texture->neededLevel; level < texture->levelCount; ++level) {
+            requestedBytes += texture->levelBytes[level];
+        }
+    }
+    stats.streamedTextures = streamed.size();
+    stats.residentStreamedBytes = residentBytes;
+    stats.requestedStreamedBytes = requestedBytes;
+
+    if ((residentBytes != reportedResidentBytes || requestedBytes != reportedRequestedBytes) &&
+        time - lastStreamingReport >= StreamingReportSeconds) {
+        lastStreamingReport = time;
+        reportedResidentBytes = residentBytes;
+        reportedRequestedBytes = requestedBytes;
+        std::cout << "Texture streaming: " << toMegabytes(residentBytes) << " MB resident of " << toMegabytes(requestedBytes)
+            << " MB requested across " << streamed.size() << " textures (" << toMegabytes(stats.vramBytes) << " MB of "
+            << toMegabytes(streamingBudget) << " MB budget in use)" << std::endl;
+    }
+    ++frame;
+}
+
+void TextureCache::streamInLevel(CachedTexture& texture) {
+    const GLint level = texture.residentLevel - 1;
+    const ImageData& image = (*texture.sourceLevels)[0];
+
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    uploadLevel(GL_TEXTURE_2D, image, level, getLevel(image, level).data(), false);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+    // Keep sampling the previous level and let updateStreaming ease towards the new one
+    texture.minLod = 1.0f;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, texture.minLod);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.residentLevel = level;
+    texture.byteSize += texture.levelBytes[level];
+    addVram(texture.levelBytes[level]);
+    ++stats.levelsStreamedIn;
+}
+
+void TextureCache::evictLevel(CachedTexture& texture) {
+    const GLint level = texture.residentLevel;
+
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+
+    // Redefining the level as 0x0 releases its storage; it lies below the base level, so
+    // the texture stays complete
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    if (texture.minLod > 0.0f) {
+        texture.minLod = 0.0f;
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, 0.0f);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.residentLevel = level + 1;
+    texture.byteSize -= texture.levelBytes[level];
+    stats.vramBytes -= texture.levelBytes[level];
+    ++stats.levelsEvicted;
+}
+
+void TextureCache::reloadSource(const std::shared_ptr<CachedTexture>& texture) {
+    texture->reloading = true;
+
+    std::weak_ptr<CachedTexture> weak = texture;
+    const std::string name = texture->name;
+    const TextureParams params = texture->params;
+    const Generator reload = texture->reload;
+    AssetLoader::instance().load(name + " (mip levels)", [weak, name, params, reload]() -> AssetLoader::Upload {
+        if (weak.expired()) {
+            return AssetLoader::Upload();
+        }
+
+        auto faces = std::make_shared<std::vector<ImageData>>(1);
+        const bool generated = reload(*faces);
+        if (generated && !(*faces)[0].isCompressed()) {
+            MipGenerator::generate((*faces)[0], !TextureCooker::isLinearData(name, (*faces)[0].channels), MipFilter::Box);
+        }
+
+        return [weak, name, params, faces, generated]() {
+            std::shared_ptr<CachedTexture> texture = weak.lock();
+            if (!texture) {
+                return;
+            }
+            texture->reloading = false;
+
+            const ImageData& image = (*faces)[0];
+            if (!generated || image.width != texture->width || image.height != texture->height ||
+                getUploadLevelCount(params, image) != texture->levelCount) {
+                // Stays at its current resolution rather than retrying every frame
+                std::cerr << "Texture failed to reload for streaming: " << name << std::endl;
+                texture->reload = nullptr;
+                return;
+            }
+            texture->sourceLevels = faces;
+        };
+    });
+}
+
+void TextureCache::release(const CachedTexture& texture) {
+    ++stats.evictions;
+    stats.evictedBytes += texture.byteSize;
+    stats.vramBytes -= texture.byteSize;
+    --stats.liveTextures;
+
+    auto found = textures.find(texture.key);
+    if (found != textures.end() && found->second.expired()) {
+        textures.erase(found);
+    }
+}
+
+void TextureCache::addVram(size_t bytes) {
+    stats.vramBytes += bytes;
+    stats.peakVramBytes = std::max(stats.peakVramBytes, stats.vramBytes);
+}
+
+void TextureCache::printStats() const {
+    std::cout << "Texture cache: " << stats.liveTextures << " live (" << toMegabytes(stats.vramBytes) << " MB, peak "
+        << toMegabytes(stats.peakVramBytes) << " MB), " << stats.hits << " hits, " << stats.misses << " misses, "
+        << stats.evictions << " evicted (" << toMegabytes(stats.evictedBytes) << " MB)" << std::endl;
+
+    // Average GL-thread stall per texture for each upload path
+    std::cout << "Texture uploads: " << stats.stagedUploads << " from staging ring ("
+        << (stats.stagedUploads > 0 ? stats.stagedUploadMilliseconds / stats.stagedUploads : 0.0) << " ms each), "
+        << stats.directUploads << " from client memory ("
+        << (stats.directUploads > 0 ? stats.directUploadMilliseconds / stats.directUploads : 0.0) << " ms each)" << std::endl;
+
+    if (stats.streamedTextures > 0) {
+        std::cout << "Texture streaming: " << stats.streamedTextures << " textures, " << toMegabytes(stats.residentStreamedBytes)
+            << " MB resident of " << toMegabytes(stats.requestedStreamedBytes) << " MB requested, " << stats.levelsStreamedIn
+            << " levels streamed in, " << stats.levelsEvicted << " evicted" << std::endl;
+    }
+}
@@ -0,0 +1,215 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <glew.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetLoader.h"
+#include "StagingRing.h"
+
+// Sampler state and upload options. The same file loaded with different parameters
+// is a different texture.
+struct TextureParams {
+    GLenum wrap = GL_REPEAT;
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+    bool flipVertically = false;
+    bool generateMipmaps = true;
+    bool streamable = false; // Only for users that call requestDetail; others load whole
+
+    std::string getKey() const;
+};
+
+// GPU texture shared by everything that loads the same source with the same parameters.
+// Holds a grey placeholder texel until the image has been decoded and uploaded. Large
+// 2D colour textures read from files with streamable set arrive with only their coarse
+// mips resident and gain finer levels as draws ask for them (see requestDetail).
+class CachedTexture {
+public:
+    ~CachedTexture();
+
+    GLuint getID() const { return textureID; }
+    GLenum getTarget() const { return target; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    bool isLoaded() const { return loaded; }
+
+    // Estimated VRAM of every face and mip level (3-channel texels count as 4 bytes)
+    size_t getByteSize() const { return byteSize; }
+
+    const std::string& getKey() const { return key; }
+
+    // Source path or generated name, for logging
+    const std::string& getName() const { return name; }
+
+    void bind() const { glBindTexture(target, textureID); }
+
+    // Finest mip level in VRAM (GL_TEXTURE_BASE_LEVEL); above 0 while a streamed texture
+    // is at reduced resolution
+    int getResidentLevel() const { return residentLevel; }
+
+    // Streaming hint from a draw using the texture this frame: the object's on-screen size
+    // as a fraction of the viewport height (as LodSelector::screenSize returns it) and how
+    // many times the texture repeats across the object
+    void requestDetail(float screenFraction, float uvRepeat = 1.0f) const;
+
+private:
+    friend class TextureCache;
+
+    CachedTexture(const std::string& key, const std::string& name, GLenum target);
+    CachedTexture(const CachedTexture&) = delete;
+    CachedTexture& operator=(const CachedTexture&) = delete;
+
+    std::string key;
+    std::string name;
+    GLenum target;
+    GLuint textureID;
+    int width, height, channels;
+    bool loaded;
+    size_t byteSize;
+
+    // Mip streaming state, GL thread only
+    bool streamed;
+    TextureParams params;
+    std::function<bool(std::vector<ImageData>&)> reload; // Decodes the image again after its source was dropped
+    int levelCount;
+    int tailLevel;     // Uploaded on load and never evicted
+    int residentLevel;
+    int neededLevel;   // From the latest requests, or the tail when unused
+    float minLod;      // Eased back to 0 after a finer level arrives, so it blends in
+    bool reloading;
+    size_t lastUseFrame;
+    std::vector<size_t> levelBytes;
+    std::shared_ptr<std::vector<ImageData>> sourceLevels; // Decoded chain, kept while finer levels are missing
+
+    mutable float requestedTexels; // Largest on-screen size asked for this frame, in texels across the texture
+    mutable size_t lastRequestFrame;
+};
+
+// One image of a packed texture array
+struct TextureLayer {
+    std::shared_ptr<const CachedTexture> array;
+    int layer = 0;
+
+    bool isValid() const { return array != nullptr; }
+};
+
+// Hands out shared textures keyed by path (or a generated name) plus TextureParams, so
+// each image is decoded and uploaded once however many loaders ask for it. Decoding
+// runs on the AssetLoader's workers, which also copy the texels into a persistently
+// mapped staging ring when the GL supports one, so the GL thread only issues copies
+// out of that buffer. Entries are weak like the MeshRegistry's: the texture is evicted
+// with its last handle. GL thread only.
+class TextureCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t liveTextures = 0;
+        size_t vramBytes = 0;
+        size_t peakVramBytes = 0;
+        size_t evictedBytes = 0;
+
+        // GL-thread time spent uploading, split by where the texels came from
+        size_t stagedUploads = 0;
+        size_t directUploads = 0;
+        double stagedUploadMilliseconds = 0.0;
+        double directUploadMilliseconds = 0.0;
+
+        // Mip streaming: what streamed textures hold in VRAM against what their draws asked for
+        size_t streamedTextures = 0;
+        size_t residentStreamedBytes = 0;
+        size_t requestedStreamedBytes = 0;
+        size_t levelsStreamedIn = 0;
+        size_t levelsEvicted = 0;
+    };
+
+    // Size of the staging ring; larger images upload from client memory
+    static const size_t StagingBytes;
+
+    // VRAM all textures may use before streamed ones give up their finest levels
+    static const size_t DefaultStreamingBudget;
+
+    // Streamed textures load levels no larger than this first
+    static const int StreamingTailSize;
+
+    // Frames without a request after which a texture counts as unused
+    static const size_t UnusedFrames;
+
+    // Finer levels uploaded per frame, to spread the copies out
+    static const int MaxLevelUploadsPerFrame;
+
+    // Fills one image per face; runs on a worker
+    typedef std::function<bool(std::vector<ImageData>& faces)> Generator;
+
+    static TextureCache& instance();
+
+    std::shared_ptr<const CachedTexture> load(const std::string& path, const TextureParams& params = TextureParams());
+
+    // Six faces in GL order (+X, -X, +Y, -Y, +Z, -Z), uploaded together once all have decoded
+    std::shared_ptr<const CachedTexture> loadCubemap(const std::vector<std::string>& faces, const TextureParams& params = TextureParams());
+
+    // 2D texture whose image is produced by code instead of read from a file
+    std::shared_ptr<const CachedTexture> loadGenerated(const std::string& name, const TextureParams& params, Generator generate);
+
+    // Packs images of equal size and channel count (read from their file headers) into
+    // shared GL_TEXTURE_2D_ARRAY textures, so draws using any of them need one bind and a
+    // layer index. Returns each path's layer in order; unreadable files get none.
+    std::vector<TextureLayer> loadPacked(const std::vector<std::string>& paths, const TextureParams& params = TextureParams());
+
+    void setStreamingBudget(size_t bytes) { streamingBudget = bytes; }
+    size_t getStreamingBudget() const { return streamingBudget; }
+
+    // Converts the screen fractions passed to requestDetail into pixels
+    void setViewportHeight(int height) { viewportHeight = height; }
+
+    // Turns this frame's requests into wanted levels, then streams finer levels in and
+    // evicts surplus ones within the budget. Once per frame, after drawing.
+    void updateStreaming(double time);
+
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    friend class CachedTexture;
+
+    // Where each face's levels were copied in the staging ring (face-major)
+    struct StagedUpload {
+        GLint firstLevel = 0; // Above 0 when a streamed texture uploads only its tail
+        StagingRing::Allocation allocation;
+        std::vector<size_t> offsets;
+    };
+
+    TextureCache() = default;
+
+    std::shared_ptr<const CachedTexture> request(const std::string& key, const std::string& name, GLenum target, size_t faceCount,
+        const TextureParams& params, Generator generate, bool streamable = false);
+    bool stage(const TextureParams& params, const std::vector<ImageData>& faces, StagedUpload& staged);
+    void upload(CachedTexture& texture, const TextureParams& params, const std::shared_ptr<std::vector<ImageData>>& faces,
+        const StagedUpload& staged);
+    void release(const CachedTexture& texture);
+    void addVram(size_t bytes);
+
+    void streamInLevel(CachedTexture& texture);
+    void evictLevel(CachedTexture& texture);
+    void reloadSource(const std::shared_ptr<CachedTexture>& texture);
+
+    std::unordered_map<std::string, std::weak_ptr<CachedTexture>> textures;
+    Stats stats;
+    StagingRing staging;
+    bool stagingInitialized = false;
+
+    size_t streamingBudget = DefaultStreamingBudget;
+    int viewportHeight = 1080;
+    size_t frame = 0;
+    double lastStreamingReport = -1.0;
+    size_t reportedResidentBytes = 0;
+    size_t reportedRequestedBytes = 0;
+};
+
+#endif
@@ -0,0 +1,479 @@
+#include "TextureCooker.h"
+#include "FileUtils.h"
+#include "HashUtils.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include "TimeUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+
+namespace {
+    const char* CookedDirectory = "Resources/Cache/Textures";
+
+    struct DdsPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t bitMasks[4];
+    };
+
+    struct DdsHeader {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11]; // Holds the SourceStamp
+        DdsPixelFormat pixelFormat;
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+
+    struct DdsHeaderDx10 {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    // Identity of the source image the entry was cooked from
+    struct SourceStamp {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t modifiedTime;
+        uint64_t size;
+        uint64_t contentHash;
+        uint32_t pathHash; // Of the path and flip, guards against cache name collisions
+        uint32_t channels;
+    };
+
+    static_assert(sizeof(DdsHeader) == 124, "DDS header must be 124 bytes");
+    static_assert(sizeof(SourceStamp) <= sizeof(DdsHeader::reserved1), "Source stamp must fit the reserved words");
+
+    const size_t DdsDataOffset = 4 + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+    const uint32_t StampMagic = 0x314B4354; // "TCK1"
+    const uint32_t FourCCDx10 = 0x30315844; // "DX10"
+
+    // DDS flags
+    const uint32_t DdsdCaps = 0x1, DdsdHeight = 0x2, DdsdWidth = 0x4, DdsdPixelFormat = 0x1000;
+    const uint32_t DdsdMipMapCount = 0x20000, DdsdLinearSize = 0x80000;
+    const uint32_t DdpfFourCC = 0x4;
+    const uint32_t DdsCapsComplex = 0x8, DdsCapsTexture = 0x1000, DdsCapsMipMap = 0x400000;
+    const uint32_t Dx10Texture2D = 3;
+
+    // DXGI_FORMAT values of the UNORM block formats
+    const uint32_t DxgiBC1 = 71, DxgiBC3 = 77, DxgiBC4 = 80, DxgiBC7 = 98;
+
+    double toKilobytes(size_t bytes) {
+        return bytes / 1024.0;
+    }
+
+    uint32_t toDxgi(BlockFormat format) {
+        switch (format) {
+        case BlockFormat::BC1: return DxgiBC1;
+        case BlockFormat::BC3: return DxgiBC3;
+        case BlockFormat::BC4: return DxgiBC4;
+        case BlockFormat::BC7: return DxgiBC7;
+        }
+        return 0;
+    }
+
+    bool fromDxgi(uint32_t dxgiFormat, BlockFormat& format) {
+        switch (dxgiFormat) {
+        case DxgiBC1: format = BlockFormat::BC1; return true;
+        case DxgiBC3: format = BlockFormat::BC3; return true;
+        case DxgiBC4: format = BlockFormat::BC4; return true;
+        case DxgiBC7: format = BlockFormat::BC7; return true;
+        default: return false;
+        }
+    }
+
+    uint32_t hashPath(const std::string& sourcePath, bool flipVertically) {
+        return static_cast<uint32_t>(hashString(flipVertically ? "flip:" : "", hashString(sourcePath)));
+    }
+
+    bool stampSource(const std::string& sourcePath, bool flipVertically, SourceStamp& stamp) {
+        std::memset(&stamp, 0, sizeof(stamp));
+        stamp.magic = StampMagic;
+        stamp.version = TextureCooker::Version;
+        stamp.pathHash = hashPath(sourcePath, flipVertically);
+        if (!getFileStat(sourcePath, stamp.modifiedTime, stamp.size)) {
+            return false;
+        }
+
+        MappedFile source;
+        if (!source.open(sourcePath)) {
+            return false;
+        }
+        stamp.contentHash = hashBytes(source.data(), source.size());
+        return true;
+    }
+
+    bool hasExtension(const std::string& path, const std::string& extension) {
+        return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    }
+
+    // Reads the entry's header and levels; the GL support check is left to the caller
+    bool readCooked(const std::string& sourcePath, bool flipVertically, ImageData& image, BlockFormat& format) {
+        MappedFile mapping;
+        if (!mapping.open(TextureCooker::getCookedPath(sourcePath, flipVertically))) {
+            return false;
+        }
+        if (mapping.size() < DdsDataOffset || std::memcmp(mapping.data(), "DDS ", 4) != 0) {
+            return false;
+        }
+
+        DdsHeader header;
+        DdsHeaderDx10 dx10;
+        SourceStamp stored;
+        std::memcpy(&header, mapping.data() + 4, sizeof(DdsHeader));
+        std::memcpy(&dx10, mapping.data() + 4 + sizeof(DdsHeader), sizeof(DdsHeaderDx10));
+        std::memcpy(&stored, header.reserved1, sizeof(SourceStamp));
+
+        if (stored.magic != StampMagic || stored.version != TextureCooker::Version ||
+            stored.pathHash != hashPath(sourcePath, flipVertically) ||
+            header.pixelFormat.fourCC != FourCCDx10 || !fromDxgi(dx10.dxgiFormat, format) ||
+            header.width == 0 || header.height == 0 || header.mipMapCount == 0 || header.mipMapCount > 32) {
+            return false;
+        }
+
+        // The level sizes must account for the whole file
+        size_t totalSize = DdsDataOffset;
+        for (uint32_t level = 0; level < header.mipMapCount; ++level) {
+            totalSize += BlockCompressor::getCompressedSize(format, std::max(1u, header.width >> level), std::max(1u, header.height >> level));
+        }
+        if (mapping.size() != totalSize) {
+            return false;
+        }
+
+        // Only hash the source when the cheap checks already pass
+        uint64_t modifiedTime = 0, size = 0;
+        SourceStamp current;
+        if (!getFileStat(sourcePath, modifiedTime, size) ||
+            modifiedTime != stored.modifiedTime || size != stored.size ||
+            !stampSource(sourcePath, flipVertically, current) || current.contentHash != stored.contentHash) {
+            std::cout << "Cooked texture stale for " << sourcePath << std::endl;
+            return false;
+        }
+
+        image = ImageData();
+        image.width = static_cast<int>(header.width);
+        image.height = static_cast<int>(header.height);
+        image.channels = static_cast<int>(stored.channels);
+        image.compressedFormat = TextureCooker::getGLFormat(format);
+        image.compressedLevels.resize(header.mipMapCount);
+
+        size_t offset = DdsDataOffset;
+        for (uint32_t level = 0; level < header.mipMapCount; ++level) {
+            const size_t levelSize = BlockCompressor::getCompressedSize(format, std::max(1u, header.width >> level), std::max(1u, header.height >> level));
+            image.compressedLevels[level].assign(mapping.data() + offset, mapping.data() + offset + levelSize);
+            offset += levelSize;
+        }
+        return true;
+    }
+
+    // Entries being cooked in the background. Never destroyed, so cooks still queued on
+    // the pool when statics are torn down at exit can finish safely.
+    struct BackgroundCooks {
+        std::mutex mutex;
+        std::unordered_set<std::string> inFlight;
+    };
+
+    BackgroundCooks& backgroundCooks() {
+        static BackgroundCooks* cooks = new BackgroundCooks();
+        return *cooks;
+    }
+}
+
+bool TextureCooker::isLinearData(const std::string& sourcePath, int channels) {
+    return channels == 1 || sourcePath.find("Heightmap") != std::string::npos;
+}
+
+BlockFormat TextureCooker::chooseFormat(const std::string& sourcePath, int channels, bool preferBC7) {
+    if (isLinearData(sourcePath, channels)) {
+        return BlockFormat::BC4;
+    }
+    if (preferBC7) {
+        return BlockFormat::BC7;
+    }
+    return channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+GLenum TextureCooker::getGLFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool TextureCooker::isSupported(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3:
+        return GLEW_EXT_texture_compression_s3tc != 0;
+    case BlockFormat::BC4:
+        return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+    case BlockFormat::BC7:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    }
+    return false;
+}
+
+std::string TextureCooker::getCookedPath(const std::string& sourcePath, bool flipVertically) {
+    std::ostringstream name;
+    name << CookedDirectory << "/" << std::hex << std::setw(16) << std::setfill('0')
+        << hashString(flipVertically ? "flip:" : "", hashString(sourcePath)) << ".dds";
+    return name.str();
+}
+
+bool TextureCooker::loadCooked(const std::string& sourcePath, bool flipVertically, ImageData& image) {
+    BlockFormat format;
+    if (!readCooked(sourcePath, flipVertically, image, format)) {
+        return false;
+    }
+    if (!isSupported(format)) {
+        image = ImageData();
+        return false;
+    }
+    return true;
+}
+
+bool TextureCooker::cook(const std::string& sourcePath, bool flipVertically, const ImageData& image, bool preferBC7) {
+    // Two-channel images have no block format here and keep loading uncompressed
+    if (!image.isValid() || image.isCompressed() || image.channels == 2) {
+        return false;
+    }
+
+    SourceStamp stamp;
+    if (!stampSource(sourcePath, flipVertically, stamp)) {
+        return false;
+    }
+    stamp.channels = static_cast<uint32_t>(image.channels);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const BlockFormat format = chooseFormat(sourcePath, image.channels, preferBC7);
+
+    ImageData rgba;
+    toRgba(image, rgba);
+    MipGenerator::generate(rgba, !isLinearData(sourcePath, image.channels), MipFilter::Kaiser);
+
+    std::vector<std::vector<unsigned char>> blocks(rgba.mipLevels.size() + 1);
+    size_t totalBytes = 0;
+    for (size_t level = 0; level < blocks.size(); ++level) {
+        const unsigned char* pixels = level == 0 ? rgba.pixels.data() : rgba.mipLevels[level - 1].data();
+        const int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        BlockCompressor::compress(format, pixels, width, height, blocks[level], &ThreadPool::shared());
+        totalBytes += blocks[level].size();
+    }
+
+    DdsHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.size = sizeof(DdsHeader);
+    header.flags = DdsdCaps | DdsdHeight | DdsdWidth | DdsdPixelFormat | DdsdMipMapCount | DdsdLinearSize;
+    header.height = static_cast<uint32_t>(image.height);
+    header.width = static_cast<uint32_t>(image.width);
+    header.pitchOrLinearSize = static_cast<uint32_t>(blocks[0].size());
+    header.mipMapCount = static_cast<uint32_t>(blocks.size());
+    std::memcpy(header.reserved1, &stamp, sizeof(SourceStamp));
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DdpfFourCC;
+    header.pixelFormat.fourCC = FourCCDx10;
+    header.caps[0] = DdsCapsTexture | DdsCapsComplex | DdsCapsMipMap;
+
+    DdsHeaderDx10 dx10 = { toDxgi(format), Dx10Texture2D, 0, 1, 0 };
+
+    makeDirectory(CookedDirectory);
+
+    std::ostringstream buffer(std::ios::out | std::ios::binary);
+    buffer.write("DDS ", 4);
+    buffer.write(reinterpret_cast<const char*>(&header), sizeof(DdsHeader));
+    buffer.write(reinterpret_cast<const char*>(&dx10), sizeof(DdsHeaderDx10));
+    for (const std::vector<unsigned char>& level : blocks) {
+        buffer.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+
+    const std::string cookedPath = getCookedPath(sourcePath, flipVertically);
+    if (!writeFileAtomically(cookedPath, buffer.str())) {
+        std::cerr << "Failed to write cooked texture: " << cookedPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Cooked texture: " << sourcePath << " (" << BlockCompressor::getName(format) << ", " << image.width << "x"
+        << image.height << ", " << blocks.size() << " mips, " << totalBytes / 1024 << " KB, " << millisecondsSince(start)
+        << " ms)" << std::endl;
+    return true;
+}
+
+void TextureCooker::cookInBackground(const std::string& sourcePath, bool flipVertically, const ImageData& image) {
+    if (!image.isValid() || image.isCompressed() || image.channels == 2) {
+        return;
+    }
+
+    const std::string cookedPath = getCookedPath(sourcePath, flipVertically);
+    {
+        BackgroundCooks& cooks = backgroundCooks();
+        std::lock_guard<std::mutex> lock(cooks.mutex);
+        if (!cooks.inFlight.insert(cookedPath).second) {
+            return;
+        }
+    }
+
+    auto copy = std::make_shared<ImageData>(image);
+    ThreadPool::shared().submit([sourcePath, flipVertically, copy, cookedPath]() {
+        cook(sourcePath, flipVertically, *copy, false);
+
+        BackgroundCooks& cooks = backgroundCooks();
+        std::lock_guard<std::mutex> lock(cooks.mutex);
+        cooks.inFlight.erase(cookedPath);
+    });
+}
+
+void TextureCooker::toRgba(const ImageData& image, ImageData& rgba) {
+    rgba.width = image.width;
+    rgba.height = image.height;
+    rgba.channels = 4;
+    rgba.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+
+    const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        const unsigned char* source = &image.pixels[i * image.channels];
+        unsigned char* target = &rgba.pixels[i * 4];
+        if (image.channels < 3) {
+            target[0] = target[1] = target[2] = source[0];
+            target[3] = image.channels == 2 ? source[1] : 255;
+        } else {
+            target[0] = source[0];
+            target[1] = source[1];
+            target[2] = source[2];
+            target[3] = image.channels == 4 ? source[3] : 255;
+        }
+    }
+}
+
+bool TextureCooker::runCookTool(const std::vector<CookSource>& sources, bool preferBC7) {
+    std::vector<CookSource> files;
+    for (const CookSource& source : sources) {
+        if (hasExtension(source.path, ".png") || hasExtension(source.path, ".jpg")) {
+            files.push_back(source);
+            continue;
+        }
+        for (const char* extension : { ".png", ".jpg" }) {
+            for (const std::string& found : listFiles(source.path, extension, true)) {
+                files.push_back({ found, source.flipVertically });
+            }
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "No images found to cook" << std::endl;
+        return false;
+    }
+
+    size_t totalSourceBytes = 0, totalCookedBytes = 0, totalRawVram = 0, totalCookedVram = 0;
+    double totalDecodeMilliseconds = 0.0, totalCookedLoadMilliseconds = 0.0, totalEncodeMilliseconds = 0.0;
+    size_t cookedCount = 0, failedCount = 0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const CookSource& file : files) {
+        const std::string& path = file.path;
+        const bool flip = file.flipVertically;
+        uint64_t modifiedTime = 0, sourceSize = 0;
+        getFileStat(path, modifiedTime, sourceSize);
+
+        // The path the loaders take without a cooked entry
+        ImageData image;
+        auto start = std::chrono::high_resolution_clock::now();
+        const bool decoded = AssetLoader::decodeImage(path, flip, image);
+        const double decodeMilliseconds = millisecondsSince(start);
+        if (!decoded) {
+            std::cerr << "  " << path << ": failed to decode" << std::endl;
+            ++failedCount;
+            continue;
+        }
+
+        start = std::chrono::high_resolution_clock::now();
+        if (!cook(path, flip, image, preferBC7)) {
+            std::cerr << "  " << path << ": not cooked (" << image.channels << " channels)" << std::endl;
+            ++failedCount;
+            continue;
+        }
+        const double encodeMilliseconds = millisecondsSince(start);
+
+        ImageData cooked;
+        BlockFormat format;
+        start = std::chrono::high_resolution_clock::now();
+        if (!readCooked(path, flip, cooked, format)) {
+            std::cerr << "  " << path << ": cooked entry failed to load" << std::endl;
+            ++failedCount;
+            continue;
+        }
+        const double cookedLoadMilliseconds = millisecondsSince(start);
+
+        uint64_t cookedSize = 0;
+        getFileStat(getCookedPath(path, flip), modifiedTime, cookedSize);
+
+        size_t cookedVram = 0;
+        for (const std::vector<unsigned char>& level : cooked.compressedLevels) {
+            cookedVram += level.size();
+        }
+        // Uncompressed upload plus its mip chain, 3-channel texels padded to 4 bytes
+        const size_t rawLevelBytes = static_cast<size_t>(image.width) * image.height * (image.channels == 3 ? 4 : image.channels);
+        const size_t rawVram = rawLevelBytes + rawLevelBytes / 3;
+
+        // Quality of the top level, over the channels the format keeps
+        ImageData rgba;
+        toRgba(image, rgba);
+        std::vector<unsigned char> decompressed;
+        BlockCompressor::decompress(format, cooked.compressedLevels[0].data(), cooked.width, cooked.height, decompressed);
+        const int comparedChannels = format == BlockFormat::BC4 ? 1 : (format == BlockFormat::BC1 ? 3 : 4);
+        double squaredError = 0.0;
+        for (size_t i = 0; i < decompressed.size(); i += 4) {
+            for (int c = 0; c < comparedChannels; ++c) {
+                const double difference = static_cast<double>(decompressed[i + c]) - rgba.pixels[i + c];
+                squaredError += difference * difference;
+            }
+        }
+        const double meanSquaredError = squaredError / (static_cast<double>(image.width) * image.height * comparedChannels);
+        const double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+        std::cout << "  " << path << (flip ? " flipped" : "") << " (" << image.width << "x" << image.height << ", " << BlockCompressor::getName(format) << ")\n"
+            << "    file " << toKilobytes(static_cast<size_t>(sourceSize)) << " KB -> " << toKilobytes(static_cast<size_t>(cookedSize)) << " KB"
+            << ", load " << decodeMilliseconds << " ms -> " << cookedLoadMilliseconds << " ms"
+            << ", VRAM " << toKilobytes(rawVram) << " KB -> " << toKilobytes(cookedVram) << " KB"
+            << ", encode " << encodeMilliseconds << " ms, PSNR " << psnr << " dB" << std::endl;
+
+        totalSourceBytes += static_cast<size_t>(sourceSize);
+        totalCookedBytes += static_cast<size_t>(cookedSize);
+        totalRawVram += rawVram;
+        totalCookedVram += cookedVram;
+        totalDecodeMilliseconds += decodeMilliseconds;
+        totalCookedLoadMilliseconds += cookedLoadMilliseconds;
+        totalEncodeMilliseconds += encodeMilliseconds;
+        ++cookedCount;
+    }
+
+    // Totals cover only the images that cooked
+    std::cout << "Cooked " << cookedCount << " images: files " << toKilobytes(totalSourceBytes) / 1024.0 << " MB -> "
+        << toKilobytes(totalCookedBytes) / 1024.0 << " MB, load " << totalDecodeMilliseconds << " ms -> "
+        << totalCookedLoadMilliseconds << " ms, VRAM " << toKilobytes(totalRawVram) / 1024.0 << " MB -> "
+        << toKilobytes(totalCookedVram) / 1024.0 << " MB, " << totalEncodeMilliseconds << " ms encoding" << std::endl;
+    if (failedCount > 0) {
+        std::cerr << failedCount << " of " << files.size() << " images failed to cook" << std::endl;
+    }
+    return failedCount == 0;
+}
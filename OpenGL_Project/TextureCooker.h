@@ -0,0 +1,58 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AssetLoader.h"
+#include "BlockCompressor.h"
+
+// Offline cooking of source images into block-compressed DDS files (DX10 header) with
+// a full mip chain, stored under Resources/Cache/Textures. Like the MeshCache, an entry
+// is only used while the source file's modification time, size and content hash match
+// the stamp kept in the header's reserved words. Images without a cooked entry are
+// decoded as before and cooked in the background for the next run.
+class TextureCooker {
+public:
+    static const uint32_t Version = 2;
+
+    // Heightmaps and single-channel images hold data rather than colour, so they are
+    // filtered without gamma and stored as BC4
+    static bool isLinearData(const std::string& sourcePath, int channels);
+
+    // BC4 for linear data, BC1 for RGB and BC3 for RGBA; BC7 replaces BC1/BC3 when preferred
+    static BlockFormat chooseFormat(const std::string& sourcePath, int channels, bool preferBC7);
+    static GLenum getGLFormat(BlockFormat format);
+
+    // Whether the current context can sample the format (S3TC is an extension)
+    static bool isSupported(BlockFormat format);
+
+    static std::string getCookedPath(const std::string& sourcePath, bool flipVertically);
+
+    // Reads the cooked mip chain into image (compressed levels, no pixels). Fails when
+    // there is no entry, it is stale, or the GL cannot use its format. Any thread.
+    static bool loadCooked(const std::string& sourcePath, bool flipVertically, ImageData& image);
+
+    // Compresses a decoded image and its Kaiser-filtered mip chain and writes the entry. Any thread.
+    static bool cook(const std::string& sourcePath, bool flipVertically, const ImageData& image, bool preferBC7);
+
+    // Cooks a copy of the image on the shared pool; repeated requests for one entry are dropped
+    static void cookInBackground(const std::string& sourcePath, bool flipVertically, const ImageData& image);
+
+    // An image file or a directory of them, in the orientation the loaders request; the
+    // cooked entry is keyed by both
+    struct CookSource {
+        std::string path;
+        bool flipVertically;
+    };
+
+    // Cooks every image under the directories (or the listed files) and prints file size,
+    // load time, VRAM and PSNR of the cooked path against decoding the PNG/JPG
+    static bool runCookTool(const std::vector<CookSource>& sources, bool preferBC7);
+
+private:
+    static void toRgba(const ImageData& image, ImageData& rgba);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.emplace_back([packaged]() { (*packaged)(); });
+    }
+    queueCondition.notify_one();
+    return result;
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body, size_t maxParallelism) {
+    if (count == 0) {
+        return;
+    }
+
+    // Shared so helpers that start after the caller returned still see valid state
+    struct State {
+        std::function<void(size_t)> body;
+        size_t count;
+        std::atomic<size_t> next;
+        std::atomic<size_t> completed;
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+    auto state = std::make_shared<State>();
+    state->body = body;
+    state->count = count;
+    state->next = 0;
+    state->completed = 0;
+
+    auto drain = [](State& work) {
+        for (;;) {
+            size_t item = work.next.fetch_add(1);
+            if (item >= work.count) {
+                return;
+            }
+            work.body(item);
+            if (work.completed.fetch_add(1) + 1 == work.count) {
+                std::lock_guard<std::mutex> lock(work.doneMutex);
+                work.doneCondition.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers.size(), count - 1);
+    if (maxParallelism > 0) {
+        helpers = std::min(helpers, maxParallelism - 1);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (size_t i = 0; i < helpers; ++i) {
+            tasks.emplace_back([state, drain]() { drain(*state); });
+        }
+    }
+    queueCondition.notify_all();
+
+    drain(*state);
+
+    std::unique_lock<std::mutex> lock(state->doneMutex);
+    state->doneCondition.wait(lock, [&state]() { return state->completed.load() == state->count; });
+}
@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for CPU-side asset work
+class ThreadPool {
+public:
+    // A thread count of 0 uses one worker per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    std::future<void> submit(std::function<void()> task);
+
+    // Runs body(0..count-1) across the pool and the calling thread and returns when all
+    // items are done. The caller always makes progress itself, so this is safe to call
+    // from inside a pool task. maxParallelism of 0 means "as many threads as available".
+    void parallelFor(size_t count, const std::function<void(size_t)>& body, size_t maxParallelism = 0);
+
+    size_t getThreadCount() const { return workers.size(); }
+
+    // Process-wide pool shared by the loaders
+    static ThreadPool& shared();
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+
+    void workerLoop();
+};
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef TIMEUTILS_H
+#define TIMEUTILS_H
+
+#include <chrono>
+
+// Elapsed wall time for the load, cook and compile timing logs
+inline double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+#endif
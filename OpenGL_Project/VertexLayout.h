@@ -0,0 +1,229 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <glew.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Dependencies/glm/glm.hpp"
+#include "Dependencies/glm/gtc/packing.hpp"
+#include "ProgramUniforms.h"
+
+// Compile-time interleaved vertex formats. A layout such as
+//   VertexLayout<Pos16Quantized, NormalOct16, UvHalf2>
+// generates the CPU packing loop and the matching glVertexAttribPointer calls.
+// Every attribute format keeps its semantic location (position 0, normal 1,
+// texcoord 2) so shaders work with any layout.
+
+// Float attribute streams to pack from
+struct VertexSource {
+    const glm::vec3* positions;
+    const glm::vec3* normals;
+    const glm::vec2* texCoords;
+    size_t vertexCount;
+};
+
+// Per-mesh position dequantization: position = offset + scale * stored
+struct QuantizationBounds {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// Sets the decode uniforms the mesh vertex shaders understand; the defaults are
+// right for plain float vertex data
+inline void applyVertexDecode(GLuint program, const QuantizationBounds& bounds = QuantizationBounds(), bool octNormals = false) {
+    ProgramUniforms& uniforms = ProgramUniforms::get(program);
+    uniforms.set(ProgramUniforms::PosOffset, bounds.offset);
+    uniforms.set(ProgramUniforms::PosScale, bounds.scale);
+    uniforms.set(ProgramUniforms::OctNormals, octNormals ? 1 : 0);
+}
+
+// Position as three unsigned normalized 16-bit values across the mesh bounds (8 bytes, padded)
+struct Pos16Quantized {
+    struct Storage { uint16_t value[4]; };
+    static const GLuint Location = 0;
+    static const GLint Components = 3;
+    static const GLenum Type = GL_UNSIGNED_SHORT;
+    static const GLboolean Normalized = GL_TRUE;
+    static const bool OctNormals = false;
+
+    static void prepare(const VertexSource& source, QuantizationBounds& bounds) {
+        if (source.vertexCount == 0) {
+            return;
+        }
+
+        glm::vec3 minimum = source.positions[0];
+        glm::vec3 maximum = source.positions[0];
+        for (size_t i = 1; i < source.vertexCount; ++i) {
+            minimum = glm::min(minimum, source.positions[i]);
+            maximum = glm::max(maximum, source.positions[i]);
+        }
+        bounds.offset = minimum;
+        bounds.scale = maximum - minimum;
+    }
+
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds& bounds) {
+        Storage packed;
+        for (int axis = 0; axis < 3; ++axis) {
+            const float extent = bounds.scale[axis];
+            const float normalized = extent > 0.0f ? (source.positions[vertex][axis] - bounds.offset[axis]) / extent : 0.0f;
+            packed.value[axis] = glm::packUnorm1x16(normalized);
+        }
+        packed.value[3] = 0;
+        return packed;
+    }
+};
+
+// Unit normal in octahedral encoding as two signed normalized 16-bit values (4 bytes)
+struct NormalOct16 {
+    struct Storage { int16_t value[2]; };
+    static const GLuint Location = 1;
+    static const GLint Components = 2;
+    static const GLenum Type = GL_SHORT;
+    static const GLboolean Normalized = GL_TRUE;
+    static const bool OctNormals = true;
+
+    static void prepare(const VertexSource&, QuantizationBounds&) {}
+
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds&) {
+        const glm::vec3& n = source.normals[vertex];
+        const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+
+        // Missing normals (all zero) encode as +Z
+        glm::vec2 encoded(0.0f);
+        if (l1 > 0.0f) {
+            encoded = glm::vec2(n.x, n.y) / l1;
+            if (n.z < 0.0f) {
+                const glm::vec2 folded = glm::vec2(1.0f - std::fabs(encoded.y), 1.0f - std::fabs(encoded.x));
+                encoded = glm::vec2(encoded.x >= 0.0f ? folded.x : -folded.x, encoded.y >= 0.0f ? folded.y : -folded.y);
+            }
+        }
+
+        Storage packed;
+        packed.value[0] = static_cast<int16_t>(glm::packSnorm1x16(encoded.x));
+        packed.value[1] = static_cast<int16_t>(glm::packSnorm1x16(encoded.y));
+        return packed;
+    }
+};
+
+// Texture coordinate as two half floats (4 bytes); keeps tiling values such as 50.0 exact
+struct UvHalf2 {
+    struct Storage { uint16_t value[2]; };
+    static const GLuint Location = 2;
+    static const GLint Components = 2;
+    static const GLenum Type = GL_HALF_FLOAT;
+    static const GLboolean Normalized = GL_FALSE;
+    static const bool OctNormals = false;
+
+    static void prepare(const VertexSource&, QuantizationBounds&) {}
+
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds&) {
+        Storage packed;
+        packed.value[0] = glm::packHalf1x16(source.texCoords[vertex].x);
+        packed.value[1] = glm::packHalf1x16(source.texCoords[vertex].y);
+        return packed;
+    }
+};
+
+// Uncompressed formats, for layouts that need full precision
+struct PosFloat3 {
+    typedef glm::vec3 Storage;
+    static const GLuint Location = 0;
+    static const GLint Components = 3;
+    static const GLenum Type = GL_FLOAT;
+    static const GLboolean Normalized = GL_FALSE;
+    static const bool OctNormals = false;
+
+    static void prepare(const VertexSource&, QuantizationBounds&) {}
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds&) { return source.positions[vertex]; }
+};
+
+struct NormalFloat3 {
+    typedef glm::vec3 Storage;
+    static const GLuint Location = 1;
+    static const GLint Components = 3;
+    static const GLenum Type = GL_FLOAT;
+    static const GLboolean Normalized = GL_FALSE;
+    static const bool OctNormals = false;
+
+    static void prepare(const VertexSource&, QuantizationBounds&) {}
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds&) { return source.normals[vertex]; }
+};
+
+struct UvFloat2 {
+    typedef glm::vec2 Storage;
+    static const GLuint Location = 2;
+    static const GLint Components = 2;
+    static const GLenum Type = GL_FLOAT;
+    static const GLboolean Normalized = GL_FALSE;
+    static const bool OctNormals = false;
+
+    static void prepare(const VertexSource&, QuantizationBounds&) {}
+    static Storage pack(const VertexSource& source, size_t vertex, const QuantizationBounds&) { return source.texCoords[vertex]; }
+};
+
+namespace VertexLayoutDetail {
+    // Recursion over the attribute list (no fold expressions in C++14)
+    template <typename... Formats>
+    struct AttributeList;
+
+    template <>
+    struct AttributeList<> {
+        static const size_t Size = 0;
+        static const bool OctNormals = false;
+
+        static void prepare(const VertexSource&, QuantizationBounds&) {}
+        static void packVertex(const VertexSource&, size_t, const QuantizationBounds&, unsigned char*) {}
+        static void setupAttributes(GLsizei, size_t) {}
+    };
+
+    template <typename First, typename... Rest>
+    struct AttributeList<First, Rest...> {
+        static const size_t Size = sizeof(typename First::Storage) + AttributeList<Rest...>::Size;
+        static const bool OctNormals = First::OctNormals || AttributeList<Rest...>::OctNormals;
+
+        static void prepare(const VertexSource& source, QuantizationBounds& bounds) {
+            First::prepare(source, bounds);
+            AttributeList<Rest...>::prepare(source, bounds);
+        }
+
+        static void packVertex(const VertexSource& source, size_t vertex, const QuantizationBounds& bounds, unsigned char* out) {
+            const typename First::Storage packed = First::pack(source, vertex, bounds);
+            std::memcpy(out, &packed, sizeof(packed));
+            AttributeList<Rest...>::packVertex(source, vertex, bounds, out + sizeof(packed));
+        }
+
+        static void setupAttributes(GLsizei stride, size_t offset) {
+            glVertexAttribPointer(First::Location, First::Components, First::Type, First::Normalized, stride, (void*)offset);
+            glEnableVertexAttribArray(First::Location);
+            AttributeList<Rest...>::setupAttributes(stride, offset + sizeof(typename First::Storage));
+        }
+    };
+}
+
+template <typename... Formats>
+struct VertexLayout {
+    typedef VertexLayoutDetail::AttributeList<Formats...> List;
+
+    static const size_t Stride = List::Size;
+    static const bool OctNormals = List::OctNormals;
+
+    // Packs the float streams into one interleaved buffer and fills in the dequantization bounds
+    static void pack(const VertexSource& source, std::vector<unsigned char>& out, QuantizationBounds& bounds) {
+        bounds = QuantizationBounds();
+        List::prepare(source, bounds);
+
+        out.resize(source.vertexCount * Stride);
+        for (size_t i = 0; i < source.vertexCount; ++i) {
+            List::packVertex(source, i, bounds, out.data() + i * Stride);
+        }
+    }
+
+    // Describes the interleaved buffer bound to GL_ARRAY_BUFFER to the current VAO
+    static void setupAttributes() {
+        List::setupAttributes(static_cast<GLsizei>(Stride), 0);
+    }
+};
+
+#endif